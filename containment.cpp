@@ -0,0 +1,363 @@
+#include "containment.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <pthread.h>
+
+namespace
+{
+
+// Number of histogram buckets in each pass of the selection.
+const int selectionBuckets = 4096;
+
+// Cells left in question when they're sorted rather than counted again.
+const size_t sortLimit = 4096;
+
+inline int bucket(double value, double low, double scale)
+{
+    int idx = int((value - low) * scale);
+    return std::max(0, std::min(selectionBuckets - 1, idx));
+}
+
+// One thread's share of a pass: the number and sum of the values in each
+// bucket and, once the bucket holding the level is known, the values in it.
+struct PassJob
+{
+    const double*       values;
+    size_t              begin;
+    size_t              end;
+    double              low;
+    double              scale;
+    int                 wanted; // bucket to gather, or -1 to count
+    std::vector<double> counts;
+    std::vector<double> sums;
+    std::vector<double> gathered;
+};
+
+void* passThread(void* params)
+{
+    PassJob* job = reinterpret_cast<PassJob*>(params);
+    if(job->wanted < 0)
+    {
+        job->counts.assign(selectionBuckets, 0.0);
+        job->sums.assign(selectionBuckets, 0.0);
+        for(size_t i = job->begin; i < job->end; ++i)
+        {
+            double v = job->values[i];
+            if(v > 0.0)
+            {
+                int b = bucket(v, job->low, job->scale);
+                job->counts[b] += 1.0;
+                job->sums[b]   += v;
+            }
+        }
+    }
+    else
+    {
+        job->gathered.clear();
+        for(size_t i = job->begin; i < job->end; ++i)
+        {
+            double v = job->values[i];
+            if((v > 0.0) && (bucket(v, job->low, job->scale) == job->wanted))
+            {
+                job->gathered.push_back(v);
+            }
+        }
+    }
+    return NULL;
+}
+
+void runPass(std::vector<PassJob>& jobs)
+{
+    if(jobs.size() == 1)
+    {
+        passThread(&jobs[0]);
+        return;
+    }
+    std::vector<pthread_t> ids(jobs.size());
+    for(size_t i = 0; i < jobs.size(); ++i)
+    {
+        pthread_create(&ids[i], NULL, passThread, &jobs[i]);
+    }
+    for(size_t i = 0; i < jobs.size(); ++i)
+    {
+        pthread_join(ids[i], NULL);
+    }
+}
+
+} // namespace
+
+ContainmentLevel containmentLevel(const std::vector<double>& grid, double fraction, int numThreads)
+{
+    ContainmentLevel retval = { 0.0, 0.0, 0 };
+
+    double total = 0.0;
+    double high  = 0.0;
+    for(size_t i = 0; i < grid.size(); ++i)
+    {
+        if(grid[i] > 0.0)
+        {
+            total += grid[i];
+            high   = std::max(high, grid[i]);
+        }
+    }
+    // A hair under, so that rounding in the sums can't add a cell where the
+    // fraction falls exactly on a cell boundary.
+    const double target = fraction * total * (1.0 - 1e-12);
+    if(target <= 0.0)
+        return retval;
+
+    // The fullest cells are taken first; sumAbove and countAbove are for
+    // the cells known to be in the set.
+    double sumAbove   = 0.0;
+    double countAbove = 0.0;
+    double low        = 0.0;
+    std::vector<double> candidates;
+    const double* values = grid.data();
+    size_t numValues     = grid.size();
+    int threads          = std::max(1, numThreads);
+    for(;;)
+    {
+        if(low == high)
+        {
+            // The rest are all the same.
+            double needed      = (target - sumAbove) / high;
+            retval.threshold   = high;
+            retval.cells       = countAbove + needed;
+            retval.atThreshold = std::min(numValues, size_t(std::max(1.0, ceil(needed - 1e-9))));
+            return retval;
+        }
+        if(numValues <= sortLimit)
+        {
+            if(values != candidates.data())
+            {
+                candidates.assign(values, values + numValues);
+            }
+            std::sort(candidates.begin(), candidates.end(), std::greater<double>());
+            for(size_t i = 0; i < candidates.size(); ++i)
+            {
+                if(sumAbove + candidates[i] >= target)
+                {
+                    size_t first = i;
+                    while((first > 0) && (candidates[first - 1] == candidates[i]))
+                    {
+                        --first;
+                    }
+                    retval.threshold   = candidates[i];
+                    retval.cells       = countAbove + i + ((target - sumAbove) / candidates[i]);
+                    retval.atThreshold = i + 1 - first;
+                    return retval;
+                }
+                sumAbove += candidates[i];
+            }
+            retval.threshold = candidates.empty() ? low : candidates.back();
+            retval.cells     = countAbove + candidates.size();
+            for(size_t i = candidates.size(); (i > 0) && (candidates[i - 1] == retval.threshold); --i)
+            {
+                ++retval.atThreshold;
+            }
+            return retval;
+        }
+
+        std::vector<PassJob> jobs(threads);
+        const double scale = selectionBuckets / (high - low);
+        for(int t = 0; t < threads; ++t)
+        {
+            jobs[t].values = values;
+            jobs[t].begin  = (numValues * t) / threads;
+            jobs[t].end    = (numValues * (t + 1)) / threads;
+            jobs[t].low    = low;
+            jobs[t].scale  = scale;
+            jobs[t].wanted = -1;
+        }
+        runPass(jobs);
+
+        // Walk down from the fullest bucket to the one that completes the
+        // set.
+        int wanted = 0;
+        for(int b = selectionBuckets - 1; b >= 0; --b)
+        {
+            double count = 0.0;
+            double sum   = 0.0;
+            for(int t = 0; t < threads; ++t)
+            {
+                count += jobs[t].counts[b];
+                sum   += jobs[t].sums[b];
+            }
+            if((sumAbove + sum >= target) || (b == 0))
+            {
+                wanted = b;
+                break;
+            }
+            sumAbove   += sum;
+            countAbove += count;
+        }
+
+        for(int t = 0; t < threads; ++t)
+        {
+            jobs[t].wanted = wanted;
+        }
+        runPass(jobs);
+        std::vector<double> next;
+        for(int t = 0; t < threads; ++t)
+        {
+            next.insert(next.end(), jobs[t].gathered.begin(), jobs[t].gathered.end());
+        }
+        candidates.swap(next);
+        values    = candidates.data();
+        numValues = candidates.size();
+        if(numValues == 0)
+        {
+            // Rounding left the target just out of reach.
+            retval.threshold = low;
+            retval.cells     = countAbove;
+            return retval;
+        }
+        low  = *std::min_element(candidates.begin(), candidates.end());
+        high = *std::max_element(candidates.begin(), candidates.end());
+
+        // The cells left in question are few enough for one thread.
+        threads = 1;
+    }
+}
+
+double containmentCells(const std::vector<double>& grid, double fraction)
+{
+    return containmentLevel(grid, fraction).cells;
+}
+
+size_t containmentMask(const std::vector<double>& grid, const ContainmentLevel& level, std::vector<char>& inside)
+{
+    inside.assign(grid.size(), 0);
+    size_t count       = 0;
+    size_t atThreshold = 0;
+    for(size_t i = 0; i < grid.size(); ++i)
+    {
+        double v = grid[i];
+        if(v <= 0.0)
+            continue;
+
+        if((v > level.threshold) || ((v == level.threshold) && (atThreshold++ < level.atThreshold)))
+        {
+            inside[i] = 1;
+            ++count;
+        }
+    }
+    return count;
+}
+
+void containmentOutlines(
+        const std::vector<char>&           marked,
+        int                                cellsX,
+        int                                cellsY,
+        std::vector<std::vector<Point2D> >& rings
+        )
+{
+    rings.clear();
+    auto inside = [&](int col, int row)
+    {
+        if((col < 0) || (row < 0) || (col >= cellsX) || (row >= cellsY))
+            return false;
+        return marked[(row * cellsX) + col] != 0;
+    };
+
+    // The edges between cells in and out of the set, directed with the
+    // cells on the left, as (start corner, end corner) indexes.
+    const long corners = cellsX + 1;
+    std::vector<std::pair<long, long> > edges;
+    for(int row = 0; row < cellsY; ++row)
+    {
+        for(int col = 0; col < cellsX; ++col)
+        {
+            if(!inside(col, row))
+                continue;
+
+            long sw = (row * corners) + col;
+            long se = sw + 1;
+            long nw = sw + corners;
+            long ne = nw + 1;
+            if(!inside(col, row - 1))
+            {
+                edges.push_back(std::make_pair(sw, se));
+            }
+            if(!inside(col + 1, row))
+            {
+                edges.push_back(std::make_pair(se, ne));
+            }
+            if(!inside(col, row + 1))
+            {
+                edges.push_back(std::make_pair(ne, nw));
+            }
+            if(!inside(col - 1, row))
+            {
+                edges.push_back(std::make_pair(nw, sw));
+            }
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+
+    // Chain the edges into rings. Where two cells touch only at a corner
+    // there are two ways on; turning left keeps each cell's ring separate.
+    std::vector<bool> used(edges.size(), false);
+    for(size_t first = 0; first < edges.size(); ++first)
+    {
+        if(used[first])
+            continue;
+
+        std::vector<long> ring;
+        size_t edge = first;
+        while(!used[edge])
+        {
+            used[edge] = true;
+            long from = edges[edge].first;
+            long to   = edges[edge].second;
+            ring.push_back(from);
+
+            auto range = std::equal_range(edges.begin(), edges.end(), std::make_pair(to, 0L),
+                                          [](const std::pair<long, long>& a, const std::pair<long, long>& b)
+            {
+                return a.first < b.first;
+            });
+            long dx = (to % corners) - (from % corners);
+            long dy = (to / corners) - (from / corners);
+            size_t next = edge;
+            for(auto i = range.first; i != range.second; ++i)
+            {
+                size_t idx = i - edges.begin();
+                if(used[idx])
+                    continue;
+                long nx = (i->second % corners) - (to % corners);
+                long ny = (i->second / corners) - (to / corners);
+                next = idx;
+                if((dx * ny) - (dy * nx) > 0)
+                    break; // left turn
+            }
+            if(next == edge)
+                break;
+            edge = next;
+        }
+
+        // Leave out the corners along straight runs.
+        std::vector<Point2D> points;
+        for(size_t i = 0; i < ring.size(); ++i)
+        {
+            long prev = ring[(i + ring.size() - 1) % ring.size()];
+            long cur  = ring[i];
+            long next = ring[(i + 1) % ring.size()];
+            long ax = (cur % corners) - (prev % corners);
+            long ay = (cur / corners) - (prev / corners);
+            long bx = (next % corners) - (cur % corners);
+            long by = (next / corners) - (cur / corners);
+            if((ax * by) - (ay * bx) != 0)
+            {
+                points.push_back(Point2D(cur % corners, cur / corners));
+            }
+        }
+        if(!points.empty())
+        {
+            points.push_back(points.front());
+            rings.push_back(points);
+        }
+    }
+}
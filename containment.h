@@ -0,0 +1,43 @@
+#ifndef CONTAINMENT_H
+#define CONTAINMENT_H
+
+#include <vector>
+#include "point2d.h"
+
+// The smallest set of cells that holds a given fraction of the grid's total.
+struct ContainmentLevel
+{
+    double threshold;   // value of the emptiest cell in the set
+    double cells;       // size of the set (see containmentCells())
+    size_t atThreshold; // cells holding exactly threshold that are in the set
+};
+
+// Finds the containment level without sorting the grid: the cell values are
+// counted into histograms over narrower and narrower ranges (each pass on
+// numThreads threads over the cells still in question) until the few cells
+// left can be sorted.
+ContainmentLevel containmentLevel(const std::vector<double>& grid, double fraction, int numThreads = 1);
+
+// Returns the size, in cells, of the smallest set of cells that holds the
+// given fraction of the grid's total. The last cell needed is counted in
+// proportion to how much of it is needed, so the result changes smoothly as
+// the grid fills.
+double containmentCells(const std::vector<double>& grid, double fraction);
+
+// Marks the cells of a containment set: those holding more than the
+// threshold and, as many cells can tie at it, the first atThreshold of those
+// holding exactly the threshold, by index. Returns the number marked, which is
+// containmentCells() rounded up.
+size_t containmentMask(const std::vector<double>& grid, const ContainmentLevel& level, std::vector<char>& inside);
+
+// The outlines of the marked cells as closed rings of cell corners, in
+// columns and rows from the grid origin, with the cells on the left. Holes
+// come out as rings of their own, running the other way.
+void containmentOutlines(
+        const std::vector<char>&           inside,
+        int                                cellsX,
+        int                                cellsY,
+        std::vector<std::vector<Point2D> >& rings
+        );
+
+#endif // CONTAINMENT_H
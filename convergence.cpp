@@ -0,0 +1,78 @@
+#include "convergence.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "containment.h"
+
+namespace
+{
+
+// No checkpoints are taken before this many iterations.
+const int firstCheckpoint = 10000;
+
+// Each checkpoint is this much further into the run than the last.
+const double checkpointGrowth = 1.5;
+
+double relativeChange(double before, double after)
+{
+    return (before > 0.0) ? std::fabs(after - before) / before : 1.0;
+}
+
+} // namespace
+
+ConvergenceMonitor::ConvergenceMonitor(double tolerance) :
+    tolerance_(tolerance),
+    nextCheckpoint_(firstCheckpoint),
+    stableCount_(0),
+    area50_(0.0),
+    area90_(0.0),
+    distChange_(1.0),
+    area50Change_(1.0),
+    area90Change_(1.0)
+{
+}
+
+bool ConvergenceMonitor::checkpointDue(int completed) const
+{
+    return completed >= nextCheckpoint_;
+}
+
+bool ConvergenceMonitor::checkpoint(const std::vector<double>& grid, int completed)
+{
+    nextCheckpoint_ = std::max(nextCheckpoint_, int(completed * checkpointGrowth));
+
+    std::vector<double> current(grid);
+    double total = std::accumulate(current.begin(), current.end(), 0.0);
+    if(total <= 0.0)
+        return false;
+    for(auto i = current.begin(); i != current.end(); ++i)
+    {
+        *i /= total;
+    }
+
+    double area50 = containmentCells(current, 0.5);
+    double area90 = containmentCells(current, 0.9);
+    if(last_.size() == current.size())
+    {
+        double dist = 0.0;
+        for(size_t i = 0; i < current.size(); ++i)
+        {
+            dist += std::fabs(current[i] - last_[i]);
+        }
+        distChange_   = 0.5 * dist;
+        area50Change_ = relativeChange(area50_, area50);
+        area90Change_ = relativeChange(area90_, area90);
+
+        bool stable = (distChange_ <= tolerance_) &&
+                      (area50Change_ <= tolerance_) &&
+                      (area90Change_ <= tolerance_);
+        stableCount_ = stable ? (stableCount_ + 1) : 0;
+    }
+
+    last_.swap(current);
+    area50_ = area50;
+    area90_ = area90;
+    return converged();
+}
@@ -0,0 +1,47 @@
+#ifndef CONVERGENCE_H
+#define CONVERGENCE_H
+
+#include <vector>
+
+// Watches the grid as a run progresses and decides when more iterations would
+// no longer change it materially. The grid is compared at checkpoints spaced
+// geometrically in the number of iterations. Between checkpoints it measures
+// the total variation distance between the normalised grids and the relative
+// change in the areas holding 50% and 90% of the samples. The run has
+// converged once all of these have been within tolerance at two successive
+// checkpoints.
+class ConvergenceMonitor
+{
+public:
+    ConvergenceMonitor(double tolerance);
+
+    // True if enough iterations have been done since the last checkpoint.
+    bool checkpointDue(int completed) const;
+
+    // Records a checkpoint. Returns true if the run has converged.
+    bool checkpoint(const std::vector<double>& grid, int completed);
+
+    bool converged() const { return stableCount_ >= 2; }
+
+    // The changes measured at the last checkpoint, as fractions.
+    double distributionChange() const { return distChange_; }
+    double area50Change() const { return area50Change_; }
+    double area90Change() const { return area90Change_; }
+
+    // Containment areas at the last checkpoint, in cells.
+    double area50() const { return area50_; }
+    double area90() const { return area90_; }
+
+protected:
+    double tolerance_;
+    int    nextCheckpoint_;
+    int    stableCount_;
+    std::vector<double> last_;
+    double area50_;
+    double area90_;
+    double distChange_;
+    double area50Change_;
+    double area90Change_;
+};
+
+#endif // CONVERGENCE_H
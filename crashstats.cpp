@@ -0,0 +1,213 @@
+#include "crashstats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+#include "estimate.h"
+#include "kmlfile.h"
+#include "point3d.h"
+#include "track3d.h"
+
+namespace
+{
+
+// The bin of value in a histogram of bins bins from low to high. Values
+// outside the range go in the end bins.
+inline int bin(double value, double low, double high, int bins)
+{
+    int idx = int((value - low) / (high - low) * bins);
+    return std::max(0, std::min(bins - 1, idx));
+}
+
+double quantile(const std::vector<double>& hist, double total, double low, double high, double p)
+{
+    if(total <= 0.0)
+        return 0.0;
+
+    const double width = (high - low) / hist.size();
+    const double target = p * total;
+    double sum = 0.0;
+    for(size_t i = 0; i < hist.size(); ++i)
+    {
+        if((sum + hist[i] >= target) && (hist[i] > 0.0))
+            return low + (width * (i + ((target - sum) / hist[i])));
+        sum += hist[i];
+    }
+    return high;
+}
+
+} // namespace
+
+CrashStats::CrashStats() :
+    halfWidth_(0.0),
+    count_(0.0),
+    meanX_(0.0),
+    meanY_(0.0),
+    sumSqXX_(0.0),
+    sumSqXY_(0.0),
+    sumSqYY_(0.0)
+{
+}
+
+CrashStats::CrashStats(const Point2D& centre, double halfWidth) :
+    centre_(centre),
+    halfWidth_(halfWidth),
+    count_(0.0),
+    meanX_(0.0),
+    meanY_(0.0),
+    sumSqXX_(0.0),
+    sumSqXY_(0.0),
+    sumSqYY_(0.0)
+{
+    if(halfWidth_ > 0.0)
+    {
+        histX_.assign(histogramBins, 0.0);
+        histY_.assign(histogramBins, 0.0);
+        histRadius_.assign(histogramBins, 0.0);
+    }
+}
+
+void CrashStats::add(const Point2D& pos, double weight)
+{
+    if(weight <= 0.0)
+        return;
+
+    count_ += weight;
+    double dx = pos.x_ - meanX_;
+    double dy = pos.y_ - meanY_;
+    meanX_   += dx * (weight / count_);
+    meanY_   += dy * (weight / count_);
+    sumSqXX_ += weight * dx * (pos.x_ - meanX_);
+    sumSqXY_ += weight * dx * (pos.y_ - meanY_);
+    sumSqYY_ += weight * dy * (pos.y_ - meanY_);
+
+    if(!histX_.empty())
+    {
+        double x = pos.x_ - centre_.x_;
+        double y = pos.y_ - centre_.y_;
+        histX_[bin(x, -halfWidth_, halfWidth_, histogramBins)] += weight;
+        histY_[bin(y, -halfWidth_, halfWidth_, histogramBins)] += weight;
+        histRadius_[bin(sqrt((x * x) + (y * y)), 0.0, M_SQRT2 * halfWidth_, histogramBins)] += weight;
+    }
+}
+
+void CrashStats::merge(const CrashStats& other)
+{
+    if(other.count_ <= 0.0)
+        return;
+
+    double total = count_ + other.count_;
+    double dx    = other.meanX_ - meanX_;
+    double dy    = other.meanY_ - meanY_;
+    double scale = count_ * other.count_ / total;
+    meanX_   += dx * (other.count_ / total);
+    meanY_   += dy * (other.count_ / total);
+    sumSqXX_ += other.sumSqXX_ + (dx * dx * scale);
+    sumSqXY_ += other.sumSqXY_ + (dx * dy * scale);
+    sumSqYY_ += other.sumSqYY_ + (dy * dy * scale);
+    count_    = total;
+
+    for(size_t i = 0; (i < histX_.size()) && (i < other.histX_.size()); ++i)
+    {
+        histX_[i]      += other.histX_[i];
+        histY_[i]      += other.histY_[i];
+        histRadius_[i] += other.histRadius_[i];
+    }
+}
+
+double CrashStats::covXX() const
+{
+    return (count_ > 0.0) ? sumSqXX_ / count_ : 0.0;
+}
+
+double CrashStats::covXY() const
+{
+    return (count_ > 0.0) ? sumSqXY_ / count_ : 0.0;
+}
+
+double CrashStats::covYY() const
+{
+    return (count_ > 0.0) ? sumSqYY_ / count_ : 0.0;
+}
+
+double CrashStats::quantileX(double p) const
+{
+    return centre_.x_ + quantile(histX_, count_, -halfWidth_, halfWidth_, p);
+}
+
+double CrashStats::quantileY(double p) const
+{
+    return centre_.y_ + quantile(histY_, count_, -halfWidth_, halfWidth_, p);
+}
+
+double CrashStats::quantileRadius(double p) const
+{
+    return quantile(histRadius_, count_, 0.0, M_SQRT2 * halfWidth_, p);
+}
+
+void writeStatsEllipses(KmlFile& kml, const CrashStats& stats)
+{
+    if(stats.count() <= 0.0)
+        return;
+
+    kml.startFolder("Statistics");
+    Point3D mean(stats.mean().x_, stats.mean().y_, 0.0);
+    mean.convertAMG66toWGS84();
+    kml.addPoint(mean, "Mean crash location");
+
+    const struct
+    {
+        double      probability;
+        const char* name;
+    }
+    ellipses[] =
+    {
+        { 0.5,  "50% ellipse" } ,
+        { 0.9,  "90% ellipse" } ,
+        { 0.95, "95% ellipse" }
+    };
+    for(size_t i = 0; i < sizeof(ellipses) / sizeof(ellipses[0]); ++i)
+    {
+        Track3D track;
+        ellipseTrack(stats.mean(), stats.covXX(), stats.covXY(), stats.covYY(), ellipses[i].probability, track);
+        track.convertAMG66toWGS84();
+        kml.addPolygon(track, ellipses[i].name, "std_tracks", false);
+    }
+}
+
+void writeStatsSummary(const CrashStats& stats, const std::string& path)
+{
+    std::ofstream os(path.c_str());
+    os.setf(std::ios::fixed);
+    os.precision(1);
+
+    double sdX = sqrt(stats.covXX());
+    double sdY = sqrt(stats.covYY());
+    os << "Samples (weighted): " << stats.count() << std::endl;
+    os << "Mean crash position (AMG E, N): " << stats.mean().x_ << ", " << stats.mean().y_ << std::endl;
+    os << "Standard deviation (m, E, N): " << sdX << ", " << sdY << std::endl;
+    os.precision(3);
+    os << "Correlation: " << (((sdX > 0.0) && (sdY > 0.0)) ? stats.covXY() / (sdX * sdY) : 0.0) << std::endl;
+    os.precision(1);
+
+    const double percentiles[] = { 0.05, 0.25, 0.5, 0.75, 0.95 };
+    os << std::endl << "Percentile,Easting,Northing,Distance from nominal (m)" << std::endl;
+    for(size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); ++i)
+    {
+        double p = percentiles[i];
+        os << int(100 * p) << "," << stats.quantileX(p) << "," << stats.quantileY(p) << "," << stats.quantileRadius(p) << std::endl;
+    }
+
+    const double probabilities[] = { 0.5, 0.9, 0.95 };
+    os << std::endl << "Normal ellipse,Semi-major axis (m),Semi-minor axis (m),Major axis bearing (deg grid),Area (km2)" << std::endl;
+    for(size_t i = 0; i < sizeof(probabilities) / sizeof(probabilities[0]); ++i)
+    {
+        double major;
+        double minor;
+        double bearing;
+        ellipseAxes(stats.covXX(), stats.covXY(), stats.covYY(), probabilities[i], major, minor, bearing);
+        os << int(100 * probabilities[i]) << "%," << major << "," << minor << ","
+           << fmod((bearing * 180.0 / M_PI) + 180.0, 180.0) << "," << (M_PI * major * minor / 1e6) << std::endl;
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef CRASHSTATS_H
+#define CRASHSTATS_H
+
+#include <string>
+#include <vector>
+#include "point2d.h"
+class KmlFile;
+
+// Streaming statistics of the crash positions of a run, kept by each worker
+// and merged as the workers finish: the weighted count, mean and covariance
+// (by Welford's method, merged as by Chan, Golub and LeVeque) and histograms
+// of the easting, northing and distance from a centre point for percentiles.
+// The histograms span a square of the given half width about the centre in
+// histogramBins bins; positions beyond it count at the ends. There are no
+// histograms (and no percentiles) if the half width is zero.
+class CrashStats
+{
+public:
+    CrashStats();
+    CrashStats(const Point2D& centre, double halfWidth);
+
+    // Samples with no weight (reweighted to nothing, say) are ignored.
+    void add(const Point2D& pos, double weight = 1.0);
+    void merge(const CrashStats& other);
+
+    const Point2D& centre() const { return centre_; }
+    double halfWidth() const { return halfWidth_; }
+
+    double count() const { return count_; }
+    Point2D mean() const { return Point2D(meanX_, meanY_); }
+    double covXX() const;
+    double covXY() const;
+    double covYY() const;
+
+    // The p quantile (0 < p < 1) of the easting, northing or distance from
+    // the centre, interpolated within the histogram bins.
+    double quantileX(double p) const;
+    double quantileY(double p) const;
+    double quantileRadius(double p) const;
+
+private:
+    static const int histogramBins = 4096;
+
+    Point2D             centre_;
+    double              halfWidth_;
+    double              count_;
+    double              meanX_;
+    double              meanY_;
+    double              sumSqXX_; // about the mean
+    double              sumSqXY_;
+    double              sumSqYY_;
+    std::vector<double> histX_;
+    std::vector<double> histY_;
+    std::vector<double> histRadius_;
+};
+
+// Adds the mean and the 50%, 90% and 95% ellipses of the normal
+// distribution with the same mean and covariance to a KML file.
+void writeStatsEllipses(KmlFile& kml, const CrashStats& stats);
+
+// Writes the statistics to a text file.
+void writeStatsSummary(const CrashStats& stats, const std::string& path);
+
+#endif // CRASHSTATS_H
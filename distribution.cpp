@@ -1,7 +1,9 @@
 #include "distribution.h"
 
+#include <cmath>
 #include <iostream>
 #include <ctime>
+#include <limits>
 
 namespace
 {
@@ -20,7 +22,57 @@ double Distribution::offsetMean(double stdDevs) const
     return mean_ + (stdDev_ * stdDevs);
 }
 
+double Distribution::logDensity(double x) const
+{
+    if(stdDev_ == 0.0)
+    {
+        return (x == mean_) ? 0.0 : -std::numeric_limits<double>::infinity();
+    }
+    double z = (x - mean_) / stdDev_;
+    return -0.5 * z * z - std::log(stdDev_) - 0.918938533204672742; // log(sqrt(2 pi))
+}
+
 double Distribution::sample() const
 {
     return norm_(__rand);
 }
+
+double inverseNormalCdf(double p)
+{
+    // P. J. Acklam's rational approximation (relative error 1.15e-9)...
+    static const double a[] = { -3.969683028665376e+01,  2.209460984245205e+02, -2.759285104469687e+02,
+                                 1.383577518672690e+02, -3.066479806614716e+01,  2.506628277459239e+00 };
+    static const double b[] = { -5.447609879822406e+01,  1.615858368580409e+02, -1.556989798598866e+02,
+                                 6.680131188771972e+01, -1.328068155288572e+01 };
+    static const double c[] = { -7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+                                -2.549732539343734e+00,  4.374664141464968e+00,  2.938163982698783e+00 };
+    static const double d[] = {  7.784695709041462e-03,  3.224671290700398e-01,  2.445134137142996e+00,
+                                 3.754408661907416e+00 };
+    static const double pLow = 0.02425;
+
+    double x;
+    if(p < pLow)
+    {
+        double q = std::sqrt(-2 * std::log(p));
+        x = (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+            ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+    }
+    else if(p <= 1 - pLow)
+    {
+        double q = p - 0.5;
+        double r = q * q;
+        x = (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+            (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+    }
+    else
+    {
+        double q = std::sqrt(-2 * std::log(1 - p));
+        x = -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+             ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+    }
+
+    // ...refined with one step of Halley's method.
+    double e = 0.5 * std::erfc(-x / std::sqrt(2.0)) - p;
+    double u = e * 2.506628274631000502 * std::exp(x * x / 2); // sqrt(2 pi)
+    return x - u / (1 + x * u / 2);
+}
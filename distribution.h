@@ -11,8 +11,13 @@ public:
 
     bool isNull() const { return (mean_ == 1e99) && (stdDev_ == 1e99); }
     double mean() const { return mean_; }
+    double stdDev() const { return stdDev_; }
     double offsetMean(double stdDevs) const;
 
+    // Natural log of the probability density at x. A distribution with no
+    // spread is treated as a point mass: 0 at the mean, -infinity elsewhere.
+    double logDensity(double x) const;
+
     // Generate a random sample using gaussian distribution.
     double sample() const;
 
@@ -22,4 +27,8 @@ protected:
     mutable std::normal_distribution<> norm_;
 };
 
+// Inverse of the standard normal cumulative distribution function, for p in
+// the open interval (0,1). Accurate to about 1e-15.
+double inverseNormalCdf(double p);
+
 #endif // DISTRIBUTION_H
@@ -1,12 +1,17 @@
 #include "distributionset.h"
 
-DistributionSet::DistributionSet()
+#include <cmath>
+#include <limits>
+
+DistributionSet::DistributionSet() :
+    correlationLength_(0.0)
 {
 }
 
 void DistributionSet::clear()
 {
     items_.clear();
+    factorise();
 }
 
 void DistributionSet::addPoint(double x, double mean, double std)
@@ -15,6 +20,59 @@ void DistributionSet::addPoint(double x, double mean, double std)
     item.x = x;
     item.y = Distribution(mean, std);
     items_.push_back(item);
+    factorise();
+}
+
+void DistributionSet::setCorrelationLength(double length)
+{
+    correlationLength_ = length;
+    factorise();
+}
+
+void DistributionSet::factorise()
+{
+    varying_.clear();
+    factor_.clear();
+    if(correlationLength_ <= 0.0)
+        return;
+
+    // Items without spread stay at their means, so they are left out of the
+    // correlation.
+    for(size_t i = 0; i < items_.size(); ++i)
+    {
+        if(items_[i].y.stdDev() != 0.0)
+        {
+            varying_.push_back(i);
+        }
+    }
+
+    // Cholesky decomposition. Row i of the factor starts at i * (i + 1) / 2.
+    // Items at the same x are perfectly correlated, which leaves a zero on
+    // the diagonal; such an item just follows the earlier one.
+    const size_t n = varying_.size();
+    factor_.assign(n * (n + 1) / 2, 0.0);
+    for(size_t i = 0; i < n; ++i)
+    {
+        double* row = &factor_[i * (i + 1) / 2];
+        for(size_t j = 0; j <= i; ++j)
+        {
+            const double* other = &factor_[j * (j + 1) / 2];
+            double sum = std::exp(-std::fabs(items_[varying_[i]].x - items_[varying_[j]].x) / correlationLength_);
+            for(size_t k = 0; k < j; ++k)
+            {
+                sum -= row[k] * other[k];
+            }
+
+            if(j < i)
+            {
+                row[j] = (other[j] > 0.0) ? (sum / other[j]) : 0.0;
+            }
+            else
+            {
+                row[i] = (sum > 1e-12) ? std::sqrt(sum) : 0.0;
+            }
+        }
+    }
 }
 
 PointSet DistributionSet::mean() const
@@ -39,10 +97,93 @@ PointSet DistributionSet::offsetMean(double stdDevs) const
 
 PointSet DistributionSet::sample() const
 {
+    Distribution normal(0.0, 1.0);
+    std::vector<double> z(items_.size());
+    for(size_t i = 0; i < z.size(); ++i)
+    {
+        z[i] = normal.sample();
+    }
+
     PointSet retval;
-    for(auto i = items_.begin(); i != items_.end(); ++i)
+    fromNormals(z.data(), retval);
+    return retval;
+}
+
+void DistributionSet::fromNormals(const double* z, PointSet& points) const
+{
+    points.clear();
+    if(factor_.empty())
+    {
+        for(size_t i = 0; i < items_.size(); ++i)
+        {
+            points.addPoint(items_[i].x, items_[i].y.offsetMean(z[i]));
+        }
+        return;
+    }
+
+    for(size_t i = 0; i < items_.size(); ++i)
+    {
+        points.addPoint(items_[i].x, items_[i].y.mean());
+    }
+    const double* row = factor_.data();
+    for(size_t i = 0; i < varying_.size(); ++i)
+    {
+        double w = 0.0;
+        for(size_t j = 0; j <= i; ++j)
+        {
+            w += row[j] * z[varying_[j]];
+        }
+        row += i + 1;
+
+        size_t item = varying_[i];
+        points[item].y_ = items_[item].y.offsetMean(w);
+    }
+}
+
+double DistributionSet::logDensity(const double* y) const
+{
+    double retval = 0.0;
+    if(factor_.empty())
+    {
+        for(size_t i = 0; i < items_.size(); ++i)
+        {
+            retval += items_[i].y.logDensity(y[i]);
+        }
+        return retval;
+    }
+
+    for(size_t i = 0; i < items_.size(); ++i)
     {
-        retval.addPoint(i->x, i->y.sample());
+        if((items_[i].y.stdDev() == 0.0) && (y[i] != items_[i].y.mean()))
+            return -std::numeric_limits<double>::infinity();
+    }
+
+    // Undo the correlation by forward substitution, leaving independent
+    // standard normal deviates.
+    std::vector<double> z(varying_.size());
+    const double* row = factor_.data();
+    for(size_t i = 0; i < varying_.size(); ++i)
+    {
+        const Distribution& dist = items_[varying_[i]].y;
+        double w = (y[varying_[i]] - dist.mean()) / dist.stdDev();
+        for(size_t j = 0; j < i; ++j)
+        {
+            w -= row[j] * z[j];
+        }
+
+        if(row[i] > 0.0)
+        {
+            z[i] = w / row[i];
+            retval += -0.5 * z[i] * z[i] - std::log(row[i] * dist.stdDev()) - 0.918938533204672742; // log(sqrt(2 pi))
+        }
+        else
+        {
+            // Follows the items before it exactly.
+            z[i] = 0.0;
+            if(std::fabs(w) > 1e-9)
+                return -std::numeric_limits<double>::infinity();
+        }
+        row += i + 1;
     }
     return retval;
 }
@@ -12,17 +12,45 @@ public:
     void clear();
     void addPoint(double x, double mean, double std);
 
+    // Correlates the items with their neighbours: the correlation between two
+    // items is exp(-|x1 - x2| / length). Zero (the default) makes the items
+    // independent. The correlation matrix is factorised here and whenever a
+    // point is added, so sampling costs one triangular matrix-vector product.
+    void setCorrelationLength(double length);
+    double correlationLength() const { return correlationLength_; }
+
+    size_t size() const { return items_.size(); }
+    const Distribution& operator [] (size_t idx) const { return items_[idx].y; }
+    double x(size_t idx) const { return items_[idx].x; }
+
     PointSet mean() const;
     PointSet offsetMean(double stdDevs) const;
     PointSet sample() const;
 
+    // Creates a point set from one standard normal deviate per item. Without
+    // correlation item i is offset from its mean by z[i] standard deviations;
+    // with it the deviates are first combined by the correlation factor.
+    void fromNormals(const double* z, PointSet& points) const;
+
+    // Natural log of the joint probability density of the item values y.
+    double logDensity(const double* y) const;
+
 protected:
+    void factorise();
+
     struct Item
     {
         double x;
         Distribution y;
     };
     std::vector<Item> items_;
+    double correlationLength_;
+
+    // Lower triangular Cholesky factor of the correlation matrix of the items
+    // that have some spread (listed in varying_), packed by rows. Empty if the
+    // items are independent.
+    std::vector<size_t> varying_;
+    std::vector<double> factor_;
 };
 
 #endif // DISTRIBUTIONSET_H
@@ -0,0 +1,67 @@
+#include "ensemble.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+void setupScenarios(ThreadParams& params)
+{
+    params.chunkScenarios.clear();
+    params.scenarioCompleted.assign(params.scenarios.size(), 0);
+    if(params.scenarios.empty())
+        return;
+
+    double totalWeight = 0.0;
+    for(size_t s = 0; s < params.scenarioWeights.size(); ++s)
+    {
+        if(params.scenarioWeights[s] < 0.0)
+            throw std::runtime_error("Ensemble weights can't be negative");
+        totalWeight += params.scenarioWeights[s];
+    }
+    if(totalWeight <= 0.0)
+        throw std::runtime_error("The ensemble weights add up to zero");
+
+    const double runChunks = std::ceil(double(params.totalIterations) / chunkSize);
+    std::vector<int> chunks(params.scenarios.size());
+    std::vector<std::pair<double, int> > order;
+    for(size_t s = 0; s < params.scenarios.size(); ++s)
+    {
+        chunks[s] = int(std::round(runChunks * params.scenarioWeights[s] / totalWeight));
+        if(params.scenarioWeights[s] > 0.0)
+        {
+            chunks[s] = std::max(1, chunks[s]);
+        }
+
+        // Order the chunks by how far through its scenario each one is.
+        for(int c = 0; c < chunks[s]; ++c)
+        {
+            order.push_back(std::make_pair((c + 0.5) / chunks[s], int(s)));
+        }
+    }
+    std::sort(order.begin(), order.end());
+
+    params.chunkScenarios.resize(order.size());
+    for(size_t c = 0; c < order.size(); ++c)
+    {
+        params.chunkScenarios[c] = order[c].second;
+    }
+    params.totalIterations = int(order.size()) * chunkSize;
+
+    // Rounding to whole chunks shifts the shares a little, which the sample
+    // weights put right.
+    params.scenarioSampleWeights.assign(params.scenarios.size(), 0.0);
+    for(size_t s = 0; s < params.scenarios.size(); ++s)
+    {
+        if(chunks[s] > 0)
+        {
+            params.scenarioSampleWeights[s] = (params.scenarioWeights[s] / totalWeight) * order.size() / chunks[s];
+        }
+    }
+}
+
+const Scenario& chunkScenario(const ThreadParams& params, int begin)
+{
+    if(params.chunkScenarios.empty())
+        return params;
+    return params.scenarios[params.chunkScenarios[begin / chunkSize]];
+}
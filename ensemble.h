@@ -0,0 +1,18 @@
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include "thread.h"
+
+// Sets up the chunks of an ensemble run (see ThreadParams::scenarios). Each
+// scenario gets a share of params.totalIterations in proportion to its
+// weight, rounded to whole chunks, and a sample weight that corrects for the
+// rounding so the grid follows the weighted mixture. The chunks of the
+// scenarios are interleaved so that a run stopped early has sampled every
+// scenario in proportion. Sets totalIterations to the total over all
+// scenarios.
+void setupScenarios(ThreadParams& params);
+
+// The scenario used for the chunk starting at the given iteration.
+const Scenario& chunkScenario(const ThreadParams& params, int begin);
+
+#endif // ENSEMBLE_H
@@ -0,0 +1,178 @@
+#include "estimate.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "util.h"
+#include "point3d.h"
+#include "track3d.h"
+#include "kmlfile.h"
+
+namespace
+{
+
+// Offset of the sigma points in standard deviations. sqrt(3) matches the
+// fourth moment of the normal distribution.
+const double sigmaOffset = 1.7320508075688772;
+
+// Number of points around an ellipse.
+const int ellipsePoints = 72;
+
+// Adds the estimate for one scenario, scaled by weight, to the sums of the
+// mean and of the second moments about the origin.
+void addScenario(const ThreadParams& params, const Scenario& scenario, double weight, double sums[5], int& tracks)
+{
+    const size_t n = inputCount(scenario);
+    std::vector<std::string> names;
+    inputNames(scenario, names);
+
+    std::vector<double> z(n, 0.0);
+    SampleProfiles profiles;
+    Point3D centre;
+    try
+    {
+        centre = CalcSample(scenario, params.integrator, z.data(), profiles, params.timeStep);
+    }
+    catch(const std::exception& e)
+    {
+        throw std::runtime_error(std::string("Unable to calculate the nominal track: ") + e.what());
+    }
+    ++tracks;
+
+    double mean[2] = { centre.x_, centre.y_ };
+    double cov[3]  = { 0.0, 0.0, 0.0 };
+    for(size_t i = 0; i < n; ++i)
+    {
+        double h = sigmaOffset;
+        Point3D plus;
+        Point3D minus;
+        for(;;)
+        {
+            try
+            {
+                z[i]  = h;
+                plus  = CalcSample(scenario, params.integrator, z.data(), profiles, params.timeStep);
+                z[i]  = -h;
+                minus = CalcSample(scenario, params.integrator, z.data(), profiles, params.timeStep);
+                tracks += 2;
+                break;
+            }
+            catch(const std::exception& e)
+            {
+                if(h == 1.0)
+                    throw std::runtime_error("Unable to calculate the tracks for " + names[i] + ": " + e.what());
+                h = 1.0;
+            }
+        }
+        z[i] = 0.0;
+
+        // First and second differences along this input.
+        double d1[2] = { (plus.x_ - minus.x_) / (2.0 * h), (plus.y_ - minus.y_) / (2.0 * h) };
+        double d2[2] = { plus.x_ + minus.x_ - (2.0 * centre.x_), plus.y_ + minus.y_ - (2.0 * centre.y_) };
+        double c2 = ((h * h) - 1.0) / (4.0 * h * h * h * h);
+        mean[0] += d2[0] / (2.0 * h * h);
+        mean[1] += d2[1] / (2.0 * h * h);
+        cov[0]  += (d1[0] * d1[0]) + (c2 * d2[0] * d2[0]);
+        cov[1]  += (d1[0] * d1[1]) + (c2 * d2[0] * d2[1]);
+        cov[2]  += (d1[1] * d1[1]) + (c2 * d2[1] * d2[1]);
+    }
+
+    sums[0] += weight * mean[0];
+    sums[1] += weight * mean[1];
+    sums[2] += weight * (cov[0] + (mean[0] * mean[0]));
+    sums[3] += weight * (cov[1] + (mean[0] * mean[1]));
+    sums[4] += weight * (cov[2] + (mean[1] * mean[1]));
+}
+
+} // namespace
+
+CrashEstimate estimateCrash(const ThreadParams& params)
+{
+    double sums[5] = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+    int tracks = 0;
+    if(params.scenarios.empty())
+    {
+        addScenario(params, params, 1.0, sums, tracks);
+    }
+    else
+    {
+        double total = 0.0;
+        for(size_t s = 0; s < params.scenarios.size(); ++s)
+        {
+            total += params.scenarioWeights[s];
+        }
+        for(size_t s = 0; s < params.scenarios.size(); ++s)
+        {
+            addScenario(params, params.scenarios[s], params.scenarioWeights[s] / total, sums, tracks);
+        }
+    }
+
+    CrashEstimate retval;
+    retval.mean   = Point2D(sums[0], sums[1]);
+    retval.covXX  = sums[2] - (sums[0] * sums[0]);
+    retval.covXY  = sums[3] - (sums[0] * sums[1]);
+    retval.covYY  = sums[4] - (sums[1] * sums[1]);
+    retval.tracks = tracks;
+    return retval;
+}
+
+void ellipseAxes(double covXX, double covXY, double covYY, double probability, double& major, double& minor, double& bearing)
+{
+    // For a bivariate normal the squared Mahalanobis radius holding
+    // probability p is -2 ln(1 - p).
+    double scale = sqrt(-2.0 * log(1.0 - probability));
+
+    double mid  = 0.5 * (covXX + covYY);
+    double half = sqrt((0.25 * (covXX - covYY) * (covXX - covYY)) + (covXY * covXY));
+    major   = scale * sqrt(std::max(0.0, mid + half));
+    minor   = scale * sqrt(std::max(0.0, mid - half));
+    bearing = (0.5 * M_PI) - (0.5 * atan2(2.0 * covXY, covXX - covYY));
+}
+
+void ellipseTrack(const Point2D& mean, double covXX, double covXY, double covYY, double probability, Track3D& track)
+{
+    double major;
+    double minor;
+    double bearing;
+    ellipseAxes(covXX, covXY, covYY, probability, major, minor, bearing);
+
+    track.clear();
+    for(int i = 0; i <= ellipsePoints; ++i)
+    {
+        double a = (2.0 * M_PI * i) / ellipsePoints;
+        double u = major * cos(a);
+        double v = minor * sin(a);
+        track.addPoint(
+                    mean.x_ + (u * sin(bearing)) + (v * cos(bearing)),
+                    mean.y_ + (u * cos(bearing)) - (v * sin(bearing)),
+                    0.0
+                    );
+    }
+}
+
+void writeEstimate(const CrashEstimate& estimate, const std::string& path)
+{
+    KmlFile kml(path);
+    Point3D mean(estimate.mean.x_, estimate.mean.y_, 0.0);
+    mean.convertAMG66toWGS84();
+    kml.addPoint(mean, "Estimated mean crash location");
+
+    const struct
+    {
+        double      probability;
+        const char* name;
+    }
+    ellipses[] =
+    {
+        { 0.5, "Estimated 50% ellipse" } ,
+        { 0.9, "Estimated 90% ellipse" }
+    };
+    for(size_t i = 0; i < sizeof(ellipses) / sizeof(ellipses[0]); ++i)
+    {
+        Track3D track;
+        ellipseTrack(estimate.mean, estimate.covXX, estimate.covXY, estimate.covYY, ellipses[i].probability, track);
+        track.convertAMG66toWGS84();
+        kml.addPolygon(track, ellipses[i].name, "std_tracks", false);
+    }
+}
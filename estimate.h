@@ -0,0 +1,41 @@
+#ifndef ESTIMATE_H
+#define ESTIMATE_H
+
+#include <string>
+#include "thread.h"
+#include "point2d.h"
+class Track3D;
+
+// A normal approximation to the distribution of the crash position, found
+// from a few dozen tracks rather than a full run. The inputs are standard
+// normal deviates (see inputDistributions()), so each is moved in turn to
+// +/-sqrt(3) standard deviations about the nominal track and the tracks are
+// combined by the central difference form of the unscented transform
+// (Norgaard, Poulsen and Ravn 2000), which keeps the covariance positive. An
+// input whose offset tracks fail is retried at +/-1 standard deviation, where
+// this is a plain finite difference linearisation. An ensemble run mixes the
+// estimates of its data sets by weight.
+struct CrashEstimate
+{
+    Point2D mean;   // AMG
+    double  covXX;  // m^2
+    double  covXY;
+    double  covYY;
+    int     tracks;
+};
+
+// Throws std::runtime_error if a track can't be calculated.
+CrashEstimate estimateCrash(const ThreadParams& params);
+
+// The semi-axes (m) of the ellipse holding the given probability of a normal
+// distribution with the given covariance, and the bearing of the major axis
+// (radians clockwise from grid north).
+void ellipseAxes(double covXX, double covXY, double covYY, double probability, double& major, double& minor, double& bearing);
+
+// The same ellipse about mean as a closed AMG track at zero altitude.
+void ellipseTrack(const Point2D& mean, double covXX, double covXY, double covYY, double probability, Track3D& track);
+
+// Writes the mean and the 50% and 90% ellipses to a KML file.
+void writeEstimate(const CrashEstimate& estimate, const std::string& path);
+
+#endif // ESTIMATE_H
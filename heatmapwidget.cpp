@@ -0,0 +1,87 @@
+#include "heatmapwidget.h"
+
+#include <algorithm>
+#include <cmath>
+#include <QPainter>
+
+namespace
+{
+
+// Maps a value between 0 and 1 to a colour running from blue through green
+// to red.
+QRgb heatColour(double v)
+{
+    int r = std::round(255 * std::min(1.0, std::max(0.0, 2.0 * v - 1.0)));
+    int g = std::round(255 * (1.0 - std::fabs(2.0 * v - 1.0)));
+    int b = std::round(255 * std::min(1.0, std::max(0.0, 1.0 - 2.0 * v)));
+    return qRgb(r, g, b);
+}
+
+} // namespace
+
+HeatmapWidget::HeatmapWidget(QWidget* parent) : QWidget(parent)
+{
+    setMinimumSize(200, 200);
+}
+
+void HeatmapWidget::setGrid(const std::vector<double>& grid, int cellsX, int cellsY)
+{
+    // Work out how many cells go into each pixel.
+    int factor = std::max(1, std::max(
+                              (cellsX + width() - 1) / std::max(1, width()),
+                              (cellsY + height() - 1) / std::max(1, height())
+                              ));
+    int imageX = (cellsX + factor - 1) / factor;
+    int imageY = (cellsY + factor - 1) / factor;
+
+    std::vector<double> pixels(imageX * imageY, 0.0);
+    for(int row = 0; row < cellsY; ++row)
+    {
+        const double* cells = &grid[row * cellsX];
+        double* line = &pixels[(row / factor) * imageX];
+        for(int col = 0; col < cellsX; ++col)
+        {
+            line[col / factor] += cells[col];
+        }
+    }
+
+    double highest = *std::max_element(pixels.begin(), pixels.end());
+    image_ = QImage(imageX, imageY, QImage::Format_RGB32);
+    for(int y = 0; y < imageY; ++y)
+    {
+        // Flip so that north is up.
+        QRgb* line = reinterpret_cast<QRgb*>(image_.scanLine(imageY - 1 - y));
+        for(int x = 0; x < imageX; ++x)
+        {
+            double v = pixels[x + (y * imageX)];
+            line[x] = (v > 0.0) ? heatColour(v / highest) : qRgb(0, 0, 0);
+        }
+    }
+    update();
+}
+
+void HeatmapWidget::clear()
+{
+    image_ = QImage();
+    update();
+}
+
+QSize HeatmapWidget::sizeHint() const
+{
+    return QSize(300, 300);
+}
+
+void HeatmapWidget::paintEvent(QPaintEvent*)
+{
+    QPainter painter(this);
+    painter.fillRect(rect(), QColor(Qt::black));
+    if(!image_.isNull())
+    {
+        // Keep the cells square.
+        double scale = std::min(double(width()) / image_.width(), double(height()) / image_.height());
+        int w        = std::round(image_.width() * scale);
+        int h        = std::round(image_.height() * scale);
+        QRect target((width() - w) / 2, (height() - h) / 2, w, h);
+        painter.drawImage(target, image_);
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef HEATMAPWIDGET_H
+#define HEATMAPWIDGET_H
+
+#include <vector>
+#include <QWidget>
+#include <QImage>
+
+// Shows a grid of sample counts as a heat map. Grids with more cells than the
+// widget has pixels are downsampled by summing blocks of cells.
+class HeatmapWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    HeatmapWidget(QWidget* parent = NULL);
+
+    // Row 0 of the grid is the southern edge.
+    void setGrid(const std::vector<double>& grid, int cellsX, int cellsY);
+    void clear();
+
+    virtual QSize sizeHint() const;
+
+protected:
+    virtual void paintEvent(QPaintEvent*);
+
+    QImage image_;
+};
+
+#endif // HEATMAPWIDGET_H
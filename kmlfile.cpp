@@ -115,6 +115,38 @@ KmlFile::KmlFile(const std::string& path)
     os_ << "          <outline>1</outline>" << std::endl;
     os_ << "      </PolyStyle>" << std::endl;
     os_ << "    </Style>" << std::endl;
+
+    os_ << "    <Style id=\"containment_50\">" << std::endl;
+    os_ << "      <LineStyle>" << std::endl;
+    os_ << "          <color>ff0000ff</color>" << std::endl;
+    os_ << "          <colorMode>normal</colorMode>" << std::endl;
+    os_ << "          <width>3</width>" << std::endl;
+    os_ << "      </LineStyle>" << std::endl;
+    os_ << "    </Style>" << std::endl;
+
+    os_ << "    <Style id=\"containment_90\">" << std::endl;
+    os_ << "      <LineStyle>" << std::endl;
+    os_ << "          <color>ff0080ff</color>" << std::endl;
+    os_ << "          <colorMode>normal</colorMode>" << std::endl;
+    os_ << "          <width>3</width>" << std::endl;
+    os_ << "      </LineStyle>" << std::endl;
+    os_ << "    </Style>" << std::endl;
+
+    os_ << "    <Style id=\"containment_95\">" << std::endl;
+    os_ << "      <LineStyle>" << std::endl;
+    os_ << "          <color>ffff0000</color>" << std::endl;
+    os_ << "          <colorMode>normal</colorMode>" << std::endl;
+    os_ << "          <width>3</width>" << std::endl;
+    os_ << "      </LineStyle>" << std::endl;
+    os_ << "    </Style>" << std::endl;
+
+    os_ << "    <Style id=\"containment_99\">" << std::endl;
+    os_ << "      <LineStyle>" << std::endl;
+    os_ << "          <color>ff00ff00</color>" << std::endl;
+    os_ << "          <colorMode>normal</colorMode>" << std::endl;
+    os_ << "          <width>3</width>" << std::endl;
+    os_ << "      </LineStyle>" << std::endl;
+    os_ << "    </Style>" << std::endl;
 }
 
 KmlFile::~KmlFile()
@@ -127,7 +159,7 @@ KmlFile::~KmlFile()
     os_ << "</kml>" << std::endl;
 }
 
-void KmlFile::startFolder(const std::string& name)
+void KmlFile::startFolder(const std::string& name, const std::string& when)
 {
     if(!folderName_.empty())
     {
@@ -138,6 +170,12 @@ void KmlFile::startFolder(const std::string& name)
     {
         os_ << "  <Folder>" << std::endl;
         os_ << "    <name>" << folderName_ << "</name>" << std::endl;
+        if(!when.empty())
+        {
+            os_ << "    <TimeStamp>" << std::endl;
+            os_ << "      <when>" << when << "</when>" << std::endl;
+            os_ << "    </TimeStamp>" << std::endl;
+        }
     }
 }
 
@@ -12,7 +12,9 @@ public:
     KmlFile(const std::string& path);
     ~KmlFile();
 
-    void startFolder(const std::string& name);
+    // Closes any open folder and opens a new one. A folder with a time
+    // (an XML date and time) is shown only at that time.
+    void startFolder(const std::string& name, const std::string& when = std::string());
 
     void addPoint(const Point3D& pt, const char* name);
     void addTrack(const Track3D& track, const char* name, const char* style, bool useZ = true);
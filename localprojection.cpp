@@ -0,0 +1,36 @@
+#include "localprojection.h"
+
+#include <cmath>
+
+#include "util.h"
+
+LocalProjection::LocalProjection() :
+    lonOffset_(0.0),
+    lonPerEasting_(0.0),
+    lonPerNorthing_(0.0),
+    latOffset_(0.0),
+    latPerEasting_(0.0),
+    latPerNorthing_(0.0),
+    convergence_(0.0)
+{
+}
+
+void LocalProjection::setOrigin(const Point2D& origin)
+{
+    // Measure how longitude and latitude change over a kilometre each way.
+    const double delta = 1000.0;
+    Point2D p0 = origin;
+    Point2D pe = origin + Point2D(delta, 0.0);
+    Point2D pn = origin + Point2D(0.0, delta);
+    p0.convertAMG66toWGS84();
+    pe.convertAMG66toWGS84();
+    pn.convertAMG66toWGS84();
+
+    lonPerEasting_  = (pe.x_ - p0.x_) / delta;
+    lonPerNorthing_ = (pn.x_ - p0.x_) / delta;
+    lonOffset_      = p0.x_ - (lonPerEasting_ * origin.x_) - (lonPerNorthing_ * origin.y_);
+    latPerEasting_  = (pe.y_ - p0.y_) / delta;
+    latPerNorthing_ = (pn.y_ - p0.y_) / delta;
+    latOffset_      = p0.y_ - (latPerEasting_ * origin.x_) - (latPerNorthing_ * origin.y_);
+    convergence_    = atan2((pn.x_ - p0.x_) * cos(p0.y_ * M_PI / 180.0), pn.y_ - p0.y_);
+}
@@ -0,0 +1,39 @@
+#ifndef LOCALPROJECTION_H
+#define LOCALPROJECTION_H
+
+#include "point2d.h"
+
+// Longitude and latitude (WGS84) as linear functions of AMG position, fitted
+// about an origin. Over the few tens of kilometres of a search area this is
+// accurate to a few metres, and far quicker than the full conversion.
+class LocalProjection
+{
+public:
+    LocalProjection();
+
+    void setOrigin(const Point2D& origin);
+
+    double longitude(double easting, double northing) const
+    {
+        return lonOffset_ + (lonPerEasting_ * easting) + (lonPerNorthing_ * northing);
+    }
+
+    double latitude(double easting, double northing) const
+    {
+        return latOffset_ + (latPerEasting_ * easting) + (latPerNorthing_ * northing);
+    }
+
+    // The true bearing of grid north (radians).
+    double convergence() const { return convergence_; }
+
+private:
+    double lonOffset_;
+    double lonPerEasting_;
+    double lonPerNorthing_;
+    double latOffset_;
+    double latPerEasting_;
+    double latPerNorthing_;
+    double convergence_;
+};
+
+#endif // LOCALPROJECTION_H
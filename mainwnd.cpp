@@ -2,10 +2,16 @@
 
 #include <cassert>
 #include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <numeric>
 #include <QApplication>
+#include <QDate>
 #include <QGridLayout>
 #include <QGroupBox>
 #include <QHBoxLayout>
+#include <QMessageBox>
 #include <QVector2D>
 #include <QVector3D>
 
@@ -13,6 +19,17 @@
 #include "util.h"
 #include "point3d.h"
 #include "track3d.h"
+#include "reweight.h"
+#include "sampler.h"
+#include "multilevel.h"
+#include "ensemble.h"
+#include "sweep.h"
+#include "sensitivity.h"
+#include "estimate.h"
+#include "surrogate.h"
+#include "crashstats.h"
+#include "containment.h"
+#include "searchplan.h"
 
 namespace
 {
@@ -22,11 +39,30 @@ const QString ITERATIONS_KEY = "Iterations";
 const QString CELLSIZE_KEY   = "CellSize";
 const QString NUMCELLS_KEY   = "NumCells";
 const QString TIMESTEP_KEY   = "TimeStep";
+const QString STORESAMPLES_KEY = "StoreSamples";
+const QString TOLERANCE_KEY  = "ConvergenceTolerance";
+const QString SAMPLING_KEY   = "Sampling";
+const QString MLMCLEVELS_KEY = "MultilevelLevels";
+const QString INTEGRATOR_KEY = "Integrator";
+const QString ENSEMBLE_KEY   = "Ensemble";
+const QString SWEEP_KEY      = "Sweep";
+const QString SENSITIVITY_KEY = "Sensitivity";
+const QString QUICKESTIMATE_KEY = "QuickEstimate";
+const QString SURROGATE_KEY  = "SurrogateTracks";
+const QString SEARCH_KEY     = "SearchPlan";
+const QString SNAPSHOTS_KEY  = "Snapshots";
+const QString SWEPTPATH_KEY  = "SweptPath";
 
 const QString TOWEREAST_KEY         = "TowerEasting";
 const QString TOWERNORTH_KEY        = "TowerNorthing";
 const QString TOWERCELL_KEY         = "TowerGridCell";
 const QString GRIDTOMAG_KEY         = "GridToMagnetic";
+const QString SIGHTINGEAST_KEY      = "Sighting.Easting";
+const QString SIGHTINGNORTH_KEY     = "Sighting.Northing";
+const QString SIGHTINGRADIUS_KEY    = "Sighting.Radius";
+const QString WINDFIELD_KEY         = "WindField";
+const QString TERRAIN_KEY           = "Terrain";
+const QString WINDCORRELATION_KEY   = "WindCorrelation";
 const QString FIXRANGEMEAN_KEY      = "FixRange.Mean";
 const QString FIXRANGESTD_KEY       = "FixRange.Std";
 const QString FIXBEARINGMEAN_KEY    = "FixBearing.Mean";
@@ -45,6 +81,50 @@ const QString FLIGHTPROFILE_KEY     = "FlightProfile";
 
 const double nullDbl = 1e99;
 
+// Number of threads used to run the simulation.
+const int numThreads = 8;
+
+// The containment regions: the smallest sets of cells holding each share of
+// the crashes, fullest first, outlined and used to colour the cells.
+const struct
+{
+    double      fraction;
+    const char* style;
+    const char* cellStyle;
+}
+regions[] =
+{
+    { 0.5,  "containment_50", "cell_100" } ,
+    { 0.9,  "containment_90", "cell_75"  } ,
+    { 0.95, "containment_95", "cell_50"  } ,
+    { 0.99, "containment_99", "cell_25"  }
+};
+const size_t numRegions = sizeof(regions) / sizeof(regions[0]);
+
+// The shading of the swept path by the chance the aircraft passed over each
+// cell, most likely first.
+const struct
+{
+    double      probability;
+    const char* cellStyle;
+}
+pathBands[] =
+{
+    { 0.75, "cell_100" } ,
+    { 0.5,  "cell_75"  } ,
+    { 0.25, "cell_50"  } ,
+    { 0.0,  "cell_25"  }
+};
+const size_t numPathBands = sizeof(pathBands) / sizeof(pathBands[0]);
+
+// The progress timer interval (ms), and how many of its ticks there are
+// between updates of the heat map preview.
+const int timerInterval = 100;
+const int previewTicks  = 5;
+
+// Terrain tiles are loaded for this distance (m) around the tower.
+const double terrainRadius = 200000.0;
+
 void populateRow(QTableWidget* table, int row, int cols, ...)
 {
     va_list args;
@@ -81,17 +161,110 @@ QVariant maybeDouble(QTableWidgetItem* item)
     return s.toDouble();
 }
 
+// Reads a data set into a scenario, all but its wind field and terrain.
+// value() gives the data set's setting for a key, whether saved or in the
+// window.
+void readDataSet(const std::function<QVariant(const QString&)>& value, Scenario& scenario)
+{
+    double gridToMag = value(GRIDTOMAG_KEY).toDouble();
+    auto number = [&](const QString& key) { return value(key).toDouble(); };
+
+    scenario.towerLocation.x_ = number(TOWEREAST_KEY);
+    scenario.towerLocation.y_ = number(TOWERNORTH_KEY);
+    if(value(TOWERCELL_KEY).toString() == "56HLJ")
+    {
+        scenario.towerLocation.y_ -= 100000.0;
+    }
+    scenario.fixRange        = Distribution(NMToMetres(number(FIXRANGEMEAN_KEY)),               NMToMetres(number(FIXRANGESTD_KEY)));
+    scenario.fixBearing      = Distribution(DEG2RAD(number(FIXBEARINGMEAN_KEY) + gridToMag),    DEG2RAD(number(FIXBEARINGSTD_KEY)));
+    scenario.aircraftHeading = Distribution(DEG2RAD(number(PLANEHEADINGMEAN_KEY) + gridToMag),  DEG2RAD(number(PLANEHEADINGSTD_KEY)));
+    scenario.initialBankRate = Distribution(DEG2RAD(number(BANKRATEMEAN_KEY)),                  DEG2RAD(number(BANKRATESTD_KEY)));
+    scenario.bankRateAccel   = Distribution(DEG2RAD(number(BANKACCELMEAN_KEY)),                 DEG2RAD(number(BANKACCELSTD_KEY)));
+    scenario.windDirection   = Distribution(DEG2RAD(number(WINDDIRECTIONMEAN_KEY) + gridToMag), DEG2RAD(number(WINDDIRECTIONSTD_KEY)));
+
+    QVariantList flightProfile = value(FLIGHTPROFILE_KEY).toList();
+    time_t startTime = 0;
+    scenario.flightProfile.clear();
+    for(int i = 0; i < flightProfile.size(); ++i)
+    {
+        QVariantList v = flightProfile[i].toList();
+        FlightPoint p;
+        if(i == 0)
+        {
+            startTime = stringToTime(v[0].toString());
+        }
+        p.time = Distribution(difftime(stringToTime(v[0].toString()), startTime), v[1].toDouble());
+        if(!v[2].isNull() && !v[3].isNull())
+        {
+            p.altitude = Distribution(FeetToMetres(v[2].toDouble()), FeetToMetres(v[3].toDouble()));
+        }
+        if(!v[4].isNull() && !v[5].isNull())
+        {
+            p.speed = Distribution(KnotsToMPS(v[4].toDouble()), KnotsToMPS(v[5].toDouble()));
+        }
+        scenario.flightProfile.push_back(p);
+    }
+
+    QVariantList windProfile = value(WINDPROFILE_KEY).toList();
+    scenario.windProfile.clear();
+    for(int i = 0; i < windProfile.size(); ++i)
+    {
+        QVector3D v = windProfile[i].value<QVector3D>();
+        scenario.windProfile.addPoint(FeetToMetres(v.x()), KnotsToMPS(v.y()), KnotsToMPS(v.z()));
+    }
+    scenario.windProfile.setCorrelationLength(FeetToMetres(number(WINDCORRELATION_KEY)));
+}
+
+// The style of each cell by its share of the fullest cell, in quarters, NULL
+// for an empty one.
+void fractionStyles(const std::vector<double>& grid, std::vector<const char*>& styles)
+{
+    static const char* const quarters[] = { NULL, "cell_25", "cell_50", "cell_75", "cell_100" };
+    styles.assign(grid.size(), NULL);
+    double highestCell = *std::max_element(grid.begin(), grid.end());
+    if(highestCell <= 0.0)
+        return;
+
+    for(size_t idx = 0; idx < grid.size(); ++idx)
+    {
+        int level = std::round((4 * grid[idx]) / highestCell);
+        styles[idx] = quarters[std::max(0, level)];
+    }
+}
+
+// The style of each cell by the smallest containment region it's in, NULL
+// for none.
+void containmentStyles(const std::vector<double>& grid, std::vector<const char*>& styles)
+{
+    styles.assign(grid.size(), NULL);
+    for(size_t i = numRegions; i > 0; --i)
+    {
+        std::vector<char> inside;
+        containmentMask(grid, containmentLevel(grid, regions[i - 1].fraction, numThreads), inside);
+        for(size_t idx = 0; idx < grid.size(); ++idx)
+        {
+            if(inside[idx])
+            {
+                styles[idx] = regions[i - 1].cellStyle;
+            }
+        }
+    }
+}
+
 } // namespace
 
 MainWnd::MainWnd()
 {
     timerId_ = 0;
     pthread_mutex_init(&params_.mutex, NULL);
+    pthread_mutex_init(&params_.previewMutex, NULL);
+    params_.stdTracks = NULL;
 
     QString path = QString("%1/settings.ini").arg(QApplication::applicationDirPath());
     settings_ = new QSettings(path, QSettings::IniFormat);
     progress_ = new QProgressBar;
     progress_->setVisible(false);
+    status_   = new QLabel;
 
     dataSetBox_ = new QComboBox;
     dataSetBox_->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
@@ -111,14 +284,36 @@ MainWnd::MainWnd()
     ok = connect(startBtn_, SIGNAL(clicked()), this, SLOT(startStop()));
     assert(ok);
 
+    stopBtn_ = new QPushButton(tr("Stop"));
+    stopBtn_->setVisible(false);
+    stopBtn_->setToolTip(tr("Stop the run now and save the results so far"));
+    ok = connect(stopBtn_, SIGNAL(clicked()), this, SLOT(stopEarly()));
+    assert(ok);
+
+    heatmap_ = new HeatmapWidget;
+
+    regridBtn_ = new QPushButton(tr("Re-grid"));
+    regridBtn_->setEnabled(false);
+    ok = connect(regridBtn_, SIGNAL(clicked()), this, SLOT(regrid()));
+    assert(ok);
+
+    reweightBtn_ = new QPushButton(tr("Reweight"));
+    reweightBtn_->setEnabled(false);
+    ok = connect(reweightBtn_, SIGNAL(clicked()), this, SLOT(reweight()));
+    assert(ok);
+
     QHBoxLayout* fileLayout = new QHBoxLayout;
     fileLayout->addWidget(dataSetBox_);
     fileLayout->addWidget(saveBtn);
     fileLayout->addWidget(resetBtn);
 
     QHBoxLayout* progressLayout = new QHBoxLayout;
+    progressLayout->addWidget(status_);
     progressLayout->addStretch();
     progressLayout->addWidget(progress_);
+    progressLayout->addWidget(regridBtn_);
+    progressLayout->addWidget(reweightBtn_);
+    progressLayout->addWidget(stopBtn_);
     progressLayout->addWidget(startBtn_);
 
     QGridLayout* layout = new QGridLayout;
@@ -128,20 +323,29 @@ MainWnd::MainWnd()
     layout->addWidget(createFlightBox(), 2, 0, 1, 2);
     layout->addWidget(createRandomBox(), 3, 0);
     layout->addWidget(createWindBox(),   3, 1);
-    layout->addLayout(progressLayout,    4, 0, 1, 2);
+    layout->addWidget(heatmap_,          1, 2, 3, 1);
+    layout->addLayout(progressLayout,    4, 0, 1, 3);
     layout->setRowStretch(1, 1);
     layout->setRowStretch(2, 2);
+    layout->setColumnStretch(2, 1);
 
     QWidget* widget = new QWidget;
     widget->setLayout(layout);
     setCentralWidget(widget);
 
     loadSettings();
-    resize(850, 850);
+    resize(1200, 850);
 }
 
 MainWnd::~MainWnd()
 {
+    // The workers of a run still going use both locks.
+    pthread_mutex_lock(&params_.mutex);
+    params_.cancelRequested = true;
+    pthread_mutex_unlock(&params_.mutex);
+    joinWorkers();
+
+    pthread_mutex_destroy(&params_.previewMutex);
     pthread_mutex_destroy(&params_.mutex);
 }
 
@@ -152,11 +356,37 @@ void MainWnd::loadSettings()
     double cellSize = settings_->value(CELLSIZE_KEY, 1000.0).toDouble();
     int numCells    = settings_->value(NUMCELLS_KEY, 50).toInt();
     double timeStep = settings_->value(TIMESTEP_KEY, 1.0).toDouble();
+    int integrator  = settings_->value(INTEGRATOR_KEY, EULER_INTEGRATOR).toInt();
+    bool storeSamples = settings_->value(STORESAMPLES_KEY, false).toBool();
+    double tolerance  = settings_->value(TOLERANCE_KEY, 0.0).toDouble();
+    int sampling      = settings_->value(SAMPLING_KEY, RANDOM_SAMPLING).toInt();
+    int mlmcLevels    = settings_->value(MLMCLEVELS_KEY, 0).toInt();
+    QString ensemble  = settings_->value(ENSEMBLE_KEY).toString();
+    QString sweep     = settings_->value(SWEEP_KEY).toString();
+    bool sensitivity  = settings_->value(SENSITIVITY_KEY, false).toBool();
+    bool quickEstimate = settings_->value(QUICKESTIMATE_KEY, false).toBool();
+    int surrogate     = settings_->value(SURROGATE_KEY, 0).toInt();
+    QString search    = settings_->value(SEARCH_KEY).toString();
+    QString snapshots = settings_->value(SNAPSHOTS_KEY).toString();
+    bool sweptPath    = settings_->value(SWEPTPATH_KEY, false).toBool();
 
     iterations_->setText(QString::number(iterations));
+    storeSamples_->setCheckState(storeSamples ? Qt::Checked : Qt::Unchecked);
+    tolerance_->setText(QString::number(tolerance, 'f', 1));
+    samplingBox_->setCurrentIndex(sampling);
+    mlmcLevels_->setText(QString::number(mlmcLevels));
+    ensemble_->setText(ensemble);
+    sweep_->setText(sweep);
+    sensitivity_->setCheckState(sensitivity ? Qt::Checked : Qt::Unchecked);
+    quickEstimate_->setCheckState(quickEstimate ? Qt::Checked : Qt::Unchecked);
+    surrogate_->setText(QString::number(surrogate));
+    search_->setText(search);
+    snapshots_->setText(snapshots);
+    sweptPath_->setCheckState(sweptPath ? Qt::Checked : Qt::Unchecked);
     cellSize_->setText(QString::number(cellSize, 'f', 1));
     numCells_->setText(QString::number(numCells));
     timeStep_->setText(QString::number(timeStep, 'f', 1));
+    integratorBox_->setCurrentIndex(integrator);
 
     dataSetBox_->clear();
     QStringList sets = settings_->childGroups();
@@ -176,6 +406,12 @@ void MainWnd::loadSettings()
     double towerNorthing     = settings_->value(dataSet + TOWERNORTH_KEY).toDouble();
     QString towerCell        = settings_->value(dataSet + TOWERCELL_KEY).toString();
     double gridToMag         = settings_->value(dataSet + GRIDTOMAG_KEY).toDouble();
+    QString sightingEasting  = settings_->value(dataSet + SIGHTINGEAST_KEY).toString();
+    QString sightingNorthing = settings_->value(dataSet + SIGHTINGNORTH_KEY).toString();
+    QString sightingRadius   = settings_->value(dataSet + SIGHTINGRADIUS_KEY).toString();
+    QString windField        = settings_->value(dataSet + WINDFIELD_KEY).toString();
+    QString terrain          = settings_->value(dataSet + TERRAIN_KEY).toString();
+    double windCorrelation   = settings_->value(dataSet + WINDCORRELATION_KEY).toDouble();
     double fixRangeMean      = settings_->value(dataSet + FIXRANGEMEAN_KEY).toDouble();
     double fixRangeStd       = settings_->value(dataSet + FIXRANGESTD_KEY).toDouble();
     double fixBearingMean    = settings_->value(dataSet + FIXBEARINGMEAN_KEY).toDouble();
@@ -195,6 +431,12 @@ void MainWnd::loadSettings()
     towerNorthing_->setText(QString::number(towerNorthing, 'f', 1));
     towerCell_->setText(towerCell);
     gridToMag_->setText(QString::number(gridToMag, 'f', 2));
+    sightingEasting_->setText(sightingEasting);
+    sightingNorthing_->setText(sightingNorthing);
+    sightingRadius_->setText(sightingRadius);
+    windField_->setText(windField);
+    terrain_->setText(terrain);
+    windCorrelation_->setText(QString::number(windCorrelation, 'f', 0));
     fixRangeMean_->setText(QString::number(fixRangeMean, 'f', 1));
     fixRangeStd_->setText(QString::number(fixRangeStd, 'f', 1));
     fixBearingMean_->setText(QString::number(fixBearingMean, 'f', 1));
@@ -240,68 +482,43 @@ void MainWnd::saveSettings()
     double cellSize          = cellSize_->text().toDouble();
     int numCells             = numCells_->text().toInt();
     double timeStep          = timeStep_->text().toDouble();
-    double towerEasting      = towerEasting_->text().toDouble();
-    double towerNorthing     = towerNorthing_->text().toDouble();
-    QString towerCell        = towerCell_->text();
-    double gridToMag         = gridToMag_->text().toDouble();
-    double fixRangeMean      = fixRangeMean_->text().toDouble();
-    double fixRangeStd       = fixRangeStd_->text().toDouble();
-    double fixBearingMean    = fixBearingMean_->text().toDouble();
-    double fixBearingStd     = fixBearingStd_->text().toDouble();
-    double windDirectionMean = windDirectionMean_->text().toDouble();
-    double windDirectionStd  = windDirectionStd_->text().toDouble();
-    double planeHeadingMean  = planeHeadingMean_->text().toDouble();
-    double planeHeadingStd   = planeHeadingStd_->text().toDouble();
-    double bankRateMean      = bankRateMean_->text().toDouble();
-    double bankRateStd       = bankRateStd_->text().toDouble();
-    double bankAccelMean     = bankAccelMean_->text().toDouble();
-    double bankAccelStd      = bankAccelStd_->text().toDouble();
+    int integrator           = integratorBox_->currentIndex();
+    bool storeSamples        = (storeSamples_->checkState() == Qt::Checked);
+    double tolerance         = tolerance_->text().toDouble();
+    int sampling             = samplingBox_->currentIndex();
+    int mlmcLevels           = mlmcLevels_->text().toInt();
+    QString ensemble         = ensemble_->text();
+    QString sweep            = sweep_->text();
+    bool sensitivity         = (sensitivity_->checkState() == Qt::Checked);
+    bool quickEstimate       = (quickEstimate_->checkState() == Qt::Checked);
+    int surrogate            = surrogate_->text().toInt();
+    QString search           = search_->text();
+    QString snapshots        = snapshots_->text();
+    bool sweptPath           = (sweptPath_->checkState() == Qt::Checked);
 
     settings_->setValue(ITERATIONS_KEY, iterations);
     settings_->setValue(CELLSIZE_KEY, cellSize);
     settings_->setValue(NUMCELLS_KEY, numCells);
     settings_->setValue(TIMESTEP_KEY, timeStep);
-    settings_->setValue(dataSet + TOWEREAST_KEY, towerEasting);
-    settings_->setValue(dataSet + TOWERNORTH_KEY, towerNorthing);
-    settings_->setValue(dataSet + TOWERCELL_KEY, towerCell);
-    settings_->setValue(dataSet + GRIDTOMAG_KEY, gridToMag);
-    settings_->setValue(dataSet + FIXRANGEMEAN_KEY, fixRangeMean);
-    settings_->setValue(dataSet + FIXRANGESTD_KEY, fixRangeStd);
-    settings_->setValue(dataSet + FIXBEARINGMEAN_KEY, fixBearingMean);
-    settings_->setValue(dataSet + FIXBEARINGSTD_KEY, fixBearingStd);
-    settings_->setValue(dataSet + WINDDIRECTIONMEAN_KEY, windDirectionMean);
-    settings_->setValue(dataSet + WINDDIRECTIONSTD_KEY, windDirectionStd);
-    settings_->setValue(dataSet + PLANEHEADINGMEAN_KEY, planeHeadingMean);
-    settings_->setValue(dataSet + PLANEHEADINGSTD_KEY, planeHeadingStd);
-    settings_->setValue(dataSet + BANKRATEMEAN_KEY, bankRateMean);
-    settings_->setValue(dataSet + BANKRATESTD_KEY, bankRateStd);
-    settings_->setValue(dataSet + BANKACCELMEAN_KEY, bankAccelMean);
-    settings_->setValue(dataSet + BANKACCELSTD_KEY, bankAccelStd);
-
-    QVariantList flightProfile;
-    for(int i = 0; i < flightTable_->rowCount(); ++i)
+    settings_->setValue(INTEGRATOR_KEY, integrator);
+    settings_->setValue(STORESAMPLES_KEY, storeSamples);
+    settings_->setValue(TOLERANCE_KEY, tolerance);
+    settings_->setValue(SAMPLING_KEY, sampling);
+    settings_->setValue(MLMCLEVELS_KEY, mlmcLevels);
+    settings_->setValue(ENSEMBLE_KEY, ensemble);
+    settings_->setValue(SWEEP_KEY, sweep);
+    settings_->setValue(SENSITIVITY_KEY, sensitivity);
+    settings_->setValue(QUICKESTIMATE_KEY, quickEstimate);
+    settings_->setValue(SURROGATE_KEY, surrogate);
+    settings_->setValue(SEARCH_KEY, search);
+    settings_->setValue(SNAPSHOTS_KEY, snapshots);
+    settings_->setValue(SWEPTPATH_KEY, sweptPath);
+
+    QVariantMap values = dataSetValues();
+    for(QVariantMap::const_iterator i = values.begin(); i != values.end(); ++i)
     {
-        QVariantList row;
-        row.push_back(flightTable_->item(i, 0)->text());
-        row.push_back(maybeDouble(flightTable_->item(i, 1)));
-        row.push_back(maybeDouble(flightTable_->item(i, 2)));
-        row.push_back(maybeDouble(flightTable_->item(i, 3)));
-        row.push_back(maybeDouble(flightTable_->item(i, 4)));
-        row.push_back(maybeDouble(flightTable_->item(i, 5)));
-        flightProfile.push_back(row);
+        settings_->setValue(dataSet + i.key(), i.value());
     }
-    settings_->setValue(dataSet + FLIGHTPROFILE_KEY, flightProfile);
-
-    QVariantList windProfile;
-    for(int i = 0; i < windTable_->rowCount(); ++i)
-    {
-        QVector3D v;
-        v.setX(windTable_->item(i, 0)->text().toDouble());
-        v.setY(windTable_->item(i, 1)->text().toDouble());
-        v.setZ(windTable_->item(i, 2)->text().toDouble());
-        windProfile.push_back(v);
-    }
-    settings_->setValue(dataSet + WINDPROFILE_KEY, windProfile);
 
     // Re-populate the combo box and re-format all values.
     loadSettings();
@@ -312,109 +529,618 @@ void MainWnd::startStop()
     if(timerId_ == 0)
     {
         // No calculation running. Start a new one.
-        double gridToMag = gridToMag_->text().toDouble();
-
         params_.cancelRequested  = false;
         params_.completed        = 0;
+        params_.nextIteration    = 0;
+        params_.moments          = ChunkMoments();
+        params_.seed             = time(NULL);
         params_.totalIterations  = std::round(pow(10, iterations_->text().toInt()));
-        params_.towerLocation.x_ = towerEasting_->text().toDouble();
-        params_.towerLocation.y_ = towerNorthing_->text().toDouble();
-        if(towerCell_->text() == "56HLJ")
+        params_.storeInputs      = (storeSamples_->checkState() == Qt::Checked);
+        params_.sampling         = Sampling(samplingBox_->currentIndex());
+        params_.mlmcLevels       = std::max(0, mlmcLevels_->text().toInt());
+        params_.sweptPath        = (sweptPath_->checkState() == Qt::Checked);
+        if(params_.mlmcLevels > 0)
+        {
+            // The samples of a multilevel run are differences between
+            // tracks, so they can't be stored for regridding or reweighting.
+            params_.storeInputs = false;
+        }
+        readParams(params_);
+        QString fixTime = (flightTable_->rowCount() > 0) ? flightTable_->item(0, 0)->text() : QString();
+        if(!loadEnvironment(params_, windField_->text(), terrain_->text(), fixTime))
+            return;
+        if(!readEnsemble(params_))
+            return;
+        if(!readSnapshots(params_))
+            return;
+        params_.sensitivity = (sensitivity_->checkState() == Qt::Checked);
+        params_.sensitivityChunks.clear();
+        params_.sweepVariants.clear();
+        bool sweep = !sweep_->text().isEmpty() && !params_.sensitivity;
+        int surrogateTracks = (sweep || params_.sensitivity) ? 0 : std::max(0, surrogate_->text().toInt());
+        params_.surrogate.reset();
+        if(sweep || params_.sensitivity || (surrogateTracks > 0))
+        {
+            // Sweeps, sensitivity and surrogate runs study the current data
+            // set, and only the normal workers follow the snapshots and
+            // the swept path.
+            params_.scenarios.clear();
+            params_.snapshotTimes.clear();
+            params_.sweptPath = false;
+        }
+        if(!params_.scenarios.empty() || sweep || params_.sensitivity || (surrogateTracks > 0))
+        {
+            // Ensemble samples carry scenario weights, surrogate samples
+            // aren't tracks and the other modes run several tracks per
+            // sample, which rules out multilevel runs and reweighting.
+            params_.mlmcLevels  = 0;
+            params_.storeInputs = false;
+        }
+
+        // Each iteration of a sensitivity run needs two tracks plus one per
+        // input, so there the iterations setting is the number of tracks.
+        size_t dims = runInputCount(params_);
+        if(params_.sensitivity)
+        {
+            params_.totalIterations = std::max<int>(1, params_.totalIterations / (dims + 2));
+            dims *= 2;
+        }
+
+        if(params_.sampling == SOBOL_SAMPLING)
+        {
+            dims = std::min(dims, SobolSequence::maxDimensions);
+            params_.sobol.init(dims, params_.seed);
+        }
+
+        // Optionally stop automatically once the grid stops changing.
+        double tolerance = tolerance_->text().toDouble();
+        convergence_.reset((tolerance > 0.0) ? new ConvergenceMonitor(tolerance / 100.0) : NULL);
+
+        params_.crashPoints.clear();
+        if(params_.storeInputs)
+        {
+            params_.crashPoints.reserve(params_.totalIterations);
+        }
+        params_.sampleInputs.clear();
+        params_.sampleWeights.clear();
+
+        QString path = QString("%1/track.kml").arg(QApplication::applicationDirPath());
+        kml_.reset(new KmlFile(path.toStdString()));
+
+        // Need to know the nominal crash location to set up the grid origin.
+        // This way we can centre the grid on the nominal crash pos. The
+        // workers compute the other standard deviation tracks (unless they
+        // are unchanged since the last run) and they are written out with
+        // the grid.
+        try
+        {
+            prepareStdTracks(params_, stdTracks_);
+        }
+        catch(const std::exception& e)
+        {
+            QMessageBox::warning(this, tr("Nominal track"), e.what());
+            kml_.reset();
+            return;
+        }
+        params_.stdTracks = &stdTracks_;
+        nominalCrashPos_  = stdTracks_.nominalCrash;
+        setupGrid();
+        params_.stats = CrashStats(nominalCrashPos_, std::max(params_.gridCellsX, params_.gridCellsY) * params_.metresPerCell);
+        params_.snapshotGrids.assign(params_.snapshotTimes.size(), std::vector<double>(params_.grid.size(), 0.0));
+        params_.pathGrid.assign(params_.sweptPath ? params_.grid.size() : 0, 0.0);
+        if(params_.mlmcLevels > 0)
+        {
+            // The iterations setting is the number of coarse samples.
+            setupLevels(params_, params_.totalIterations);
+        }
+
+        // The preview keeps its own copy of the grid, built up from the
+        // changes the workers pass on.
+        params_.previewChanges = true;
+        params_.gridChanges.clear();
+        preview_.assign(params_.grid.size(), 0.0);
+        previewLevels_ = params_.levelGrids;
+        setupScenarios(params_);
+        if(sweep)
         {
-            params_.towerLocation.y_ -= 100000.0;
-        }
-        params_.timeStep            = timeStep_->text().toDouble();
-        params_.fixRange            = Distribution(NMToMetres(fixRangeMean_->text().toDouble()),               NMToMetres(fixRangeStd_->text().toDouble()));
-        params_.fixBearing          = Distribution(DEG2RAD(fixBearingMean_->text().toDouble() + gridToMag),    DEG2RAD(fixBearingStd_->text().toDouble()));
-        params_.aircraftHeading     = Distribution(DEG2RAD(planeHeadingMean_->text().toDouble() + gridToMag),  DEG2RAD(planeHeadingStd_->text().toDouble()));
-        params_.initialBankRate     = Distribution(DEG2RAD(bankRateMean_->text().toDouble()),                  DEG2RAD(bankRateStd_->text().toDouble()));
-        params_.bankRateAccel       = Distribution(DEG2RAD(bankAccelMean_->text().toDouble()),                 DEG2RAD(bankAccelStd_->text().toDouble()));
-        params_.windDirection       = Distribution(DEG2RAD(windDirectionMean_->text().toDouble() + gridToMag), DEG2RAD(windDirectionStd_->text().toDouble()));
-
-        time_t startTime = 0;
-        params_.flightProfile.clear();
-        for(int i = 0; i < flightTable_->rowCount(); ++i)
-        {
-            FlightPoint p;
-            QTableWidgetItem* tm = flightTable_->item(i, 0);
-            QTableWidgetItem* ts = flightTable_->item(i, 1);
-            QTableWidgetItem* am = flightTable_->item(i, 2);
-            QTableWidgetItem* as = flightTable_->item(i, 3);
-            QTableWidgetItem* sm = flightTable_->item(i, 4);
-            QTableWidgetItem* ss = flightTable_->item(i, 5);
-            if(i == 0)
+            try
+            {
+                expandSweep(params_, sweep_->text().toStdString(), params_.sweepVariants);
+            }
+            catch(const std::exception& e)
             {
-                startTime = stringToTime(tm->text());
+                QMessageBox::warning(this, tr("Sweep"), e.what());
+                kml_.reset();
+                return;
             }
-            p.time = Distribution(difftime(stringToTime(tm->text()), startTime), ts->text().toDouble());
-            if(!am->text().isNull() && !as->text().isNull())
+        }
+        if(!search_->text().trimmed().isEmpty())
+        {
+            try
             {
-                p.altitude = Distribution(FeetToMetres(am->text().toDouble()), FeetToMetres(as->text().toDouble()));
+                SearchSettings search;
+                parseSearchSettings(search_->text().toStdString(), search);
             }
-            if(!sm->text().isNull() && !ss->text().isNull())
+            catch(const std::exception& e)
             {
-                p.speed = Distribution(KnotsToMPS(sm->text().toDouble()), KnotsToMPS(ss->text().toDouble()));
+                QMessageBox::warning(this, tr("Search plan"), e.what());
+                kml_.reset();
+                return;
             }
-            params_.flightProfile.push_back(p);
         }
 
-        params_.windProfile.clear();
-        for(int i = 0; i < windTable_->rowCount(); ++i)
+        // A surrogate that doesn't match its check tracks closely enough
+        // stops the run, as the iterations setting is likely too high for
+        // the tracks themselves.
+        surrogateText_.clear();
+        if(surrogateTracks > 0)
         {
-            double x = FeetToMetres(windTable_->item(i, 0)->text().toDouble());
-            double y = KnotsToMPS(windTable_->item(i, 1)->text().toDouble());
-            double z = KnotsToMPS(windTable_->item(i, 2)->text().toDouble());
-            params_.windProfile.addPoint(x, y, z);
+            std::shared_ptr<Surrogate> surrogate(new Surrogate);
+            try
+            {
+                surrogate->build(params_, surrogateTracks, numThreads);
+            }
+            catch(const std::exception& e)
+            {
+                QMessageBox::warning(this, tr("Surrogate"), e.what());
+                kml_.reset();
+                return;
+            }
+            const SurrogateCheck& check = surrogate->check();
+            surrogateText_ = tr("Surrogate of degree %1 with %2 terms. Error on %3 check tracks: RMS %4 m, 99% %5 m, largest %6 m, %7% in a different cell. %8% of tracks failed, so each sample counts as %9 of a track in the grid.")
+                    .arg(surrogate->degree())
+                    .arg(surrogate->terms())
+                    .arg(check.samples)
+                    .arg(check.rmsError, 0, 'f', 0)
+                    .arg(check.error99, 0, 'f', 0)
+                    .arg(check.maxError, 0, 'f', 0)
+                    .arg(100.0 * check.cellChanges, 0, 'f', 2)
+                    .arg(100.0 * (1.0 - surrogate->successFraction()), 0, 'f', 2)
+                    .arg(surrogate->successFraction(), 0, 'f', 4);
+            if(!surrogate->acceptable())
+            {
+                QMessageBox::warning(this, tr("Surrogate"), tr("%1\nThe surrogate is too inaccurate for this grid. Try larger cells, more fitting tracks or no surrogate.").arg(surrogateText_));
+                kml_.reset();
+                return;
+            }
+            params_.surrogate = surrogate;
         }
 
-        params_.gridCellsX          = numCells_->text().toInt();
-        params_.gridCellsY          = numCells_->text().toInt();
-        params_.metresPerCell       = cellSize_->text().toDouble();
-        params_.grid.resize(params_.gridCellsX * params_.gridCellsY);
-        std::fill(params_.grid.begin(), params_.grid.end(), 0);
-
-        QString path = QString("%1/track.kml").arg(QApplication::applicationDirPath());
-        kml_.reset(new KmlFile(path.toStdString()));
-
-        // Need to know the nominal crash location to set up the grid origin.
-        // This way we can centre the grid on the nominal crash pos.
-        Point3D nominalCrashPos = createStdTracks(*kml_, params_);
-        params_.gridOrigin      = Point2D(
-                    nominalCrashPos.x_ - (params_.gridCellsX * params_.metresPerCell * 0.5),
-                    nominalCrashPos.y_ - (params_.gridCellsY * params_.metresPerCell * 0.5)
-                    );
+        // A normal approximation from a few dozen tracks gives something to
+        // go on while the run proceeds.
+        estimateText_.clear();
+        if(quickEstimate_->checkState() == Qt::Checked)
+        {
+            try
+            {
+                CrashEstimate estimate = estimateCrash(params_);
+                QString estimatePath = QString("%1/estimate.kml").arg(QApplication::applicationDirPath());
+                writeEstimate(estimate, estimatePath.toStdString());
+
+                double major;
+                double minor;
+                double bearing;
+                ellipseAxes(estimate.covXX, estimate.covXY, estimate.covYY, 0.9, major, minor, bearing);
+                estimateText_ = tr("Quick estimate from %1 tracks: mean %2 %3, 90% ellipse %4 x %5 km with major axis at %6 deg grid (written to estimate.kml)")
+                        .arg(estimate.tracks)
+                        .arg(estimate.mean.x_, 0, 'f', 0)
+                        .arg(estimate.mean.y_, 0, 'f', 0)
+                        .arg(2.0 * major / 1000.0, 0, 'f', 1)
+                        .arg(2.0 * minor / 1000.0, 0, 'f', 1)
+                        .arg(fmod(RAD2DEG(bearing) + 180.0, 180.0), 0, 'f', 0);
+            }
+            catch(const std::exception& e)
+            {
+                estimateText_ = tr("No quick estimate: %1").arg(e.what());
+            }
+        }
 
-        // Divvy the work load between some threads.
-        static const int numThreads = 8;
-        params_.iterationsPerThread = params_.totalIterations / numThreads;
-        params_.totalIterations     = params_.iterationsPerThread * numThreads;
+        // Start some threads to share the work load.
+        void* (*worker)(void*) = workerThread;
+        if(params_.sensitivity)
+        {
+            worker = sensitivityThread;
+        }
+        else if(sweep)
+        {
+            worker = sweepThread;
+        }
+        else if(params_.surrogate)
+        {
+            worker = surrogateThread;
+        }
+        params_.threadsRunning = numThreads;
+        workers_.resize(numThreads);
         for(int i = 0; i < numThreads; ++i)
         {
-            pthread_t id;
-            pthread_create(&id, NULL, workerThread, &params_);
-            pthread_detach(id);
+            pthread_create(&workers_[i], NULL, worker, &params_);
         }
 
         // Start a timer to track progress and check for completion.
-        timerId_ = startTimer(100);
+        timerId_    = startTimer(timerInterval);
+        timerTicks_ = 0;
         progress_->setRange(0, params_.totalIterations);
         progress_->setVisible(true);
+        heatmap_->clear();
+        status_->setText(estimateText_);
+        regridBtn_->setEnabled(false);
+        reweightBtn_->setEnabled(false);
+        stopBtn_->setVisible(true);
         startBtn_->setText(tr("Cancel"));
     }
     else
     {
-        // Cancel the current simulation.
+        // Cancel the current simulation. The workers stop after their
+        // current chunks; wait for them so that the next run starts clean.
         pthread_mutex_lock(&params_.mutex);
         params_.cancelRequested = true;
         pthread_mutex_unlock(&params_.mutex);
+        joinWorkers();
 
         killTimer(timerId_);
         timerId_ = 0;
         progress_->setVisible(false);
+        stopBtn_->setVisible(false);
+        stopBtn_->setEnabled(true);
         startBtn_->setText(tr("Start"));
     }
 }
 
+void MainWnd::joinWorkers()
+{
+    for(size_t i = 0; i < workers_.size(); ++i)
+    {
+        pthread_join(workers_[i], NULL);
+    }
+    workers_.clear();
+}
+
+void MainWnd::stopEarly()
+{
+    // The workers finish their current chunks and the results so far are
+    // saved once they have all exited.
+    pthread_mutex_lock(&params_.mutex);
+    params_.cancelRequested = true;
+    pthread_mutex_unlock(&params_.mutex);
+    stopBtn_->setEnabled(false);
+}
+
+bool MainWnd::loadEnvironment(Scenario& scenario, const QString& windField, const QString& terrain, const QString& fixTime)
+{
+    // A gridded wind field replaces the wind profile.
+    scenario.windField.reset();
+    if(!windField.isEmpty())
+    {
+        std::shared_ptr<WindField> field(new WindField);
+        try
+        {
+            field->load(windField.toStdString());
+        }
+        catch(const std::exception& e)
+        {
+            QMessageBox::warning(this, tr("Wind field"), e.what());
+            return false;
+        }
+        field->prepare(scenario.towerLocation, fixTime.isEmpty() ? 0.0 : stringToTime(fixTime));
+        scenario.windField = field;
+    }
+
+    // Terrain ends the tracks where they reach the ground.
+    scenario.terrain.reset();
+    if(!terrain.isEmpty())
+    {
+        std::shared_ptr<Terrain> ground(new Terrain);
+        try
+        {
+            ground->load(terrain.toStdString(), scenario.towerLocation, terrainRadius);
+        }
+        catch(const std::exception& e)
+        {
+            QMessageBox::warning(this, tr("Terrain"), e.what());
+            return false;
+        }
+        scenario.terrain = ground;
+    }
+    return true;
+}
+
+bool MainWnd::readEnsemble(ThreadParams& params)
+{
+    params.scenarios.clear();
+    params.scenarioWeights.clear();
+    ensembleNames_.clear();
+
+    // "Data set=weight; Data set=weight; ..."
+    QStringList parts = ensemble_->text().split(';', QString::SkipEmptyParts);
+    for(int i = 0; i < parts.size(); ++i)
+    {
+        QString dataSet = parts[i].section('=', 0, -2).trimmed();
+        bool ok = false;
+        double weight = parts[i].section('=', -1).toDouble(&ok);
+        if(dataSet.isEmpty() || !ok || (weight < 0.0))
+        {
+            QMessageBox::warning(this, tr("Ensemble"), tr("Expected 'data set=weight' but found '%1'").arg(parts[i].trimmed()));
+            return false;
+        }
+
+        // The current data set is used as shown, unsaved changes included.
+        Scenario scenario;
+        if(dataSet == dataSetBox_->currentText())
+        {
+            scenario = params;
+        }
+        else if(!settings_->childGroups().contains(dataSet))
+        {
+            QMessageBox::warning(this, tr("Ensemble"), tr("There is no data set called '%1'").arg(dataSet));
+            return false;
+        }
+        else if(!readScenario(dataSet, scenario))
+        {
+            return false;
+        }
+        params.scenarios.push_back(scenario);
+        params.scenarioWeights.push_back(weight);
+        ensembleNames_.push_back(dataSet);
+    }
+
+    if(!params.scenarios.empty() && (std::accumulate(params.scenarioWeights.begin(), params.scenarioWeights.end(), 0.0) <= 0.0))
+    {
+        QMessageBox::warning(this, tr("Ensemble"), tr("The ensemble weights add up to zero"));
+        return false;
+    }
+    return true;
+}
+
+bool MainWnd::readSnapshots(ThreadParams& params)
+{
+    params.snapshotTimes.clear();
+    snapshotNames_.clear();
+    snapshotStamps_.clear();
+
+    // "hh:mm[:ss], hh:mm[:ss], ..." in UTC, with an optional "yyyy-mm-dd"
+    // (the date of the fix) for the KML time stamps.
+    QStringList parts = snapshots_->text().split(',', QString::SkipEmptyParts);
+    std::vector<int> times;
+    QDate date;
+    for(int i = 0; i < parts.size(); ++i)
+    {
+        QString part = parts[i].trimmed();
+        if(part.split('-').size() == 3)
+        {
+            date = QDate::fromString(part, "yyyy-MM-dd");
+            if(!date.isValid())
+            {
+                QMessageBox::warning(this, tr("Snapshots"), tr("'%1' is not a date (yyyy-mm-dd)").arg(part));
+                return false;
+            }
+            continue;
+        }
+
+        QStringList fields = part.split(':');
+        bool ok[3] = { false, false, true };
+        int hrs = fields[0].toInt(&ok[0]);
+        int min = (fields.size() > 1) ? fields[1].toInt(&ok[1]) : 0;
+        int sec = (fields.size() > 2) ? fields[2].toInt(&ok[2]) : 0;
+        if((fields.size() < 2) || (fields.size() > 3) || !ok[0] || !ok[1] || !ok[2])
+        {
+            QMessageBox::warning(this, tr("Snapshots"), tr("Expected a time (hh:mm:ss) or a date (yyyy-mm-dd) but found '%1'").arg(part));
+            return false;
+        }
+        times.push_back((hrs * 3600) + (min * 60) + sec);
+    }
+    if(times.empty())
+        return true;
+
+    // Times are counted from the fix, the first row of the flight profile.
+    QString fixTime = (flightTable_->rowCount() > 0) ? flightTable_->item(0, 0)->text() : QString();
+    if(fixTime.isEmpty())
+    {
+        QMessageBox::warning(this, tr("Snapshots"), tr("The flight profile has no fix time to count the snapshots from"));
+        return false;
+    }
+    // A time of day before the fix is taken to be on the day after it.
+    const int secondsPerDay = 24 * 3600;
+    int fix = int(stringToTime(fixTime)) % secondsPerDay;
+    for(size_t i = 0; i < times.size(); ++i)
+    {
+        if(times[i] < fix)
+        {
+            times[i] += secondsPerDay;
+        }
+    }
+    std::sort(times.begin(), times.end());
+    times.erase(std::unique(times.begin(), times.end()), times.end());
+    for(size_t i = 0; i < times.size(); ++i)
+    {
+        int day = times[i] / secondsPerDay;
+        int sec = times[i] % secondsPerDay;
+        QString name = QString("%1:%2:%3")
+                .arg(sec / 3600, 2, 10, QChar('0'))
+                .arg((sec / 60) % 60, 2, 10, QChar('0'))
+                .arg(sec % 60, 2, 10, QChar('0'));
+        params.snapshotTimes.push_back(times[i] - fix);
+        snapshotNames_.push_back(name);
+        snapshotStamps_.push_back(date.isValid() ? QString("%1T%2Z").arg(date.addDays(day).toString("yyyy-MM-dd")).arg(name) : QString());
+    }
+    return true;
+}
+
+bool MainWnd::readScenario(QString dataSet, Scenario& scenario)
+{
+    dataSet += '/';
+    readDataSet([&](const QString& key) { return settings_->value(dataSet + key); }, scenario);
+
+    QVariantList flightProfile = settings_->value(dataSet + FLIGHTPROFILE_KEY).toList();
+    QString fixTime = flightProfile.isEmpty() ? QString() : flightProfile[0].toList()[0].toString();
+    return loadEnvironment(
+                scenario,
+                settings_->value(dataSet + WINDFIELD_KEY).toString(),
+                settings_->value(dataSet + TERRAIN_KEY).toString(),
+                fixTime
+                );
+}
+
+void MainWnd::readParams(ThreadParams& params)
+{
+    QVariantMap values = dataSetValues();
+    readDataSet([&](const QString& key) { return values.value(key); }, params);
+    params.timeStep   = timeStep_->text().toDouble();
+    params.integrator = Integrator(integratorBox_->currentIndex());
+}
+
+QVariantMap MainWnd::dataSetValues()
+{
+    QVariantMap values;
+    values[TOWEREAST_KEY]         = towerEasting_->text().toDouble();
+    values[TOWERNORTH_KEY]        = towerNorthing_->text().toDouble();
+    values[TOWERCELL_KEY]         = towerCell_->text();
+    values[GRIDTOMAG_KEY]         = gridToMag_->text().toDouble();
+    values[SIGHTINGEAST_KEY]      = sightingEasting_->text();
+    values[SIGHTINGNORTH_KEY]     = sightingNorthing_->text();
+    values[SIGHTINGRADIUS_KEY]    = sightingRadius_->text();
+    values[WINDFIELD_KEY]         = windField_->text();
+    values[TERRAIN_KEY]           = terrain_->text();
+    values[WINDCORRELATION_KEY]   = windCorrelation_->text().toDouble();
+    values[FIXRANGEMEAN_KEY]      = fixRangeMean_->text().toDouble();
+    values[FIXRANGESTD_KEY]       = fixRangeStd_->text().toDouble();
+    values[FIXBEARINGMEAN_KEY]    = fixBearingMean_->text().toDouble();
+    values[FIXBEARINGSTD_KEY]     = fixBearingStd_->text().toDouble();
+    values[WINDDIRECTIONMEAN_KEY] = windDirectionMean_->text().toDouble();
+    values[WINDDIRECTIONSTD_KEY]  = windDirectionStd_->text().toDouble();
+    values[PLANEHEADINGMEAN_KEY]  = planeHeadingMean_->text().toDouble();
+    values[PLANEHEADINGSTD_KEY]   = planeHeadingStd_->text().toDouble();
+    values[BANKRATEMEAN_KEY]      = bankRateMean_->text().toDouble();
+    values[BANKRATESTD_KEY]       = bankRateStd_->text().toDouble();
+    values[BANKACCELMEAN_KEY]     = bankAccelMean_->text().toDouble();
+    values[BANKACCELSTD_KEY]      = bankAccelStd_->text().toDouble();
+
+    QVariantList flightProfile;
+    for(int i = 0; i < flightTable_->rowCount(); ++i)
+    {
+        QVariantList row;
+        row.push_back(flightTable_->item(i, 0)->text());
+        row.push_back(maybeDouble(flightTable_->item(i, 1)));
+        row.push_back(maybeDouble(flightTable_->item(i, 2)));
+        row.push_back(maybeDouble(flightTable_->item(i, 3)));
+        row.push_back(maybeDouble(flightTable_->item(i, 4)));
+        row.push_back(maybeDouble(flightTable_->item(i, 5)));
+        flightProfile.push_back(row);
+    }
+    values[FLIGHTPROFILE_KEY] = flightProfile;
+
+    QVariantList windProfile;
+    for(int i = 0; i < windTable_->rowCount(); ++i)
+    {
+        QVector3D v;
+        v.setX(windTable_->item(i, 0)->text().toDouble());
+        v.setY(windTable_->item(i, 1)->text().toDouble());
+        v.setZ(windTable_->item(i, 2)->text().toDouble());
+        windProfile.push_back(v);
+    }
+    values[WINDPROFILE_KEY] = windProfile;
+    return values;
+}
+
+void MainWnd::regrid()
+{
+    if((timerId_ != 0) || params_.crashPoints.empty())
+        return;
+
+    setupGrid();
+    params_.snapshotGrids.clear(); // the positions aren't kept
+    params_.pathGrid.clear();        // nor the tracks
+    binCrashPoints(params_, numThreads);
+
+    QString path = QString("%1/track.kml").arg(QApplication::applicationDirPath());
+    kml_.reset(new KmlFile(path.toStdString()));
+    try
+    {
+        computeStdTracks(params_, stdTracks_, numThreads);
+        writeTracks();
+    }
+    catch(const std::exception& e)
+    {
+        QMessageBox::warning(this, tr("Nominal track"), e.what());
+    }
+    writeStatsEllipses(*kml_, params_.stats);
+    writeGrid();
+    writeSearch();
+    kml_.reset();
+    heatmap_->setGrid(params_.grid, params_.gridCellsX, params_.gridCellsY);
+}
+
+void MainWnd::reweight()
+{
+    if((timerId_ != 0) || params_.sampleInputs.empty())
+        return;
+
+    ThreadParams updated;
+    readParams(updated);
+    // The tracks are flown through the environment the samples were run in.
+    updated.windField = params_.windField;
+    updated.terrain   = params_.terrain;
+
+    SpatialLikelihood sighting;
+    bool haveSighting = !sightingEasting_->text().isEmpty() &&
+                        !sightingNorthing_->text().isEmpty() &&
+                        !sightingRadius_->text().isEmpty();
+    if(haveSighting)
+    {
+        sighting.position.x_ = sightingEasting_->text().toDouble();
+        sighting.position.y_ = sightingNorthing_->text().toDouble();
+        sighting.stdDev      = sightingRadius_->text().toDouble();
+        if(towerCell_->text() == "56HLJ")
+        {
+            sighting.position.y_ -= 100000.0;
+        }
+    }
+
+    double ess;
+    try
+    {
+        ess = reweightSamples(params_, updated, haveSighting ? &sighting : NULL, numThreads);
+    }
+    catch(const std::exception& e)
+    {
+        QMessageBox::warning(this, tr("Reweight"), e.what());
+        return;
+    }
+
+    QString path = QString("%1/track.kml").arg(QApplication::applicationDirPath());
+    kml_.reset(new KmlFile(path.toStdString()));
+    // The statistics follow the new weights.
+    CrashStats stats(params_.stats.centre(), params_.stats.halfWidth());
+    for(size_t i = 0; i < params_.crashPoints.size(); ++i)
+    {
+        stats.add(params_.crashPoints[i], params_.sampleWeights[i]);
+    }
+    params_.stats = stats;
+    writeStatsSummary(params_.stats, QString("%1/summary.txt").arg(QApplication::applicationDirPath()).toStdString());
+
+    try
+    {
+        computeStdTracks(updated, stdTracks_, numThreads);
+        writeTracks();
+    }
+    catch(const std::exception& e)
+    {
+        QMessageBox::warning(this, tr("Nominal track"), e.what());
+    }
+    writeStatsEllipses(*kml_, params_.stats);
+    writeGrid();
+    writeSearch();
+    kml_.reset();
+    heatmap_->setGrid(params_.grid, params_.gridCellsX, params_.gridCellsY);
+
+    double fraction = ess / params_.crashPoints.size();
+    QString msg = tr("Effective sample size %1 (%2%)").arg(ess, 0, 'f', 0).arg(100.0 * fraction, 0, 'f', 1);
+    if(fraction < 0.1)
+    {
+        msg += tr(" - a fresh run is recommended");
+    }
+    status_->setText(msg);
+}
+
 void MainWnd::addFlightRow()
 {
     int row = flightTable_->rowCount();
@@ -473,11 +1199,23 @@ QWidget* MainWnd::createFixedBox()
     vert.push_back(tr("Tower location N (AMG)"));
     vert.push_back(tr("Tower UTM cell"));
     vert.push_back(tr("Grid to magnetic (deg)"));
-
-    towerEasting_  = new QTableWidgetItem;
-    towerNorthing_ = new QTableWidgetItem;
-    towerCell_     = new QTableWidgetItem;
-    gridToMag_     = new QTableWidgetItem;
+    vert.push_back(tr("Debris sighting E (AMG)"));
+    vert.push_back(tr("Debris sighting N (AMG)"));
+    vert.push_back(tr("Debris sighting radius (m)"));
+    vert.push_back(tr("Gridded wind field file"));
+    vert.push_back(tr("Terrain (SRTM .hgt directory)"));
+    vert.push_back(tr("Wind correlation length (ft)"));
+
+    towerEasting_     = new QTableWidgetItem;
+    towerNorthing_    = new QTableWidgetItem;
+    towerCell_        = new QTableWidgetItem;
+    gridToMag_        = new QTableWidgetItem;
+    sightingEasting_  = new QTableWidgetItem;
+    sightingNorthing_ = new QTableWidgetItem;
+    sightingRadius_   = new QTableWidgetItem;
+    windField_        = new QTableWidgetItem;
+    terrain_          = new QTableWidgetItem;
+    windCorrelation_  = new QTableWidgetItem;
 
     QTableWidget* table = new QTableWidget;
     table->setRowCount(vert.size());
@@ -488,6 +1226,12 @@ QWidget* MainWnd::createFixedBox()
     table->setItem(1, 0, towerNorthing_);
     table->setItem(2, 0, towerCell_);
     table->setItem(3, 0, gridToMag_);
+    table->setItem(4, 0, sightingEasting_);
+    table->setItem(5, 0, sightingNorthing_);
+    table->setItem(6, 0, sightingRadius_);
+    table->setItem(7, 0, windField_);
+    table->setItem(8, 0, terrain_);
+    table->setItem(9, 0, windCorrelation_);
 
     QHBoxLayout* layout = new QHBoxLayout;
     layout->addWidget(table);
@@ -557,14 +1301,55 @@ QWidget* MainWnd::createCalcBox()
 
     QStringList vert;
     vert.push_back(tr("Time integration step (s)"));
+    vert.push_back(tr("Integration method"));
     vert.push_back(tr("Iterations"));
     vert.push_back(tr("Grid cells"));
     vert.push_back(tr("Metres per cell"));
-
-    iterations_ = new QTableWidgetItem;
-    numCells_   = new QTableWidgetItem;
-    cellSize_   = new QTableWidgetItem;
-    timeStep_   = new QTableWidgetItem;
+    vert.push_back(tr("Store samples for regridding and reweighting"));
+    vert.push_back(tr("Convergence tolerance (%, 0 = off)"));
+    vert.push_back(tr("Sampling"));
+    vert.push_back(tr("Multilevel levels (0 = off)"));
+    vert.push_back(tr("Ensemble (data set=weight; ...)"));
+    vert.push_back(tr("Sweep (e.g. fixBearing=-2,0,2; timeStep=0.5,1)"));
+    vert.push_back(tr("Sensitivity analysis (Sobol indices)"));
+    vert.push_back(tr("Quick estimate first (unscented transform)"));
+    vert.push_back(tr("Surrogate fitting tracks (0 = off)"));
+    vert.push_back(tr("Search plan (e.g. units=3; hours=4; speed=120; width=1500)"));
+    vert.push_back(tr("Snapshot times, UTC (e.g. 19:40, 19:45, 2013-06-01)"));
+    vert.push_back(tr("Swept path (cells the tracks pass over)"));
+
+    iterations_   = new QTableWidgetItem;
+    numCells_     = new QTableWidgetItem;
+    cellSize_     = new QTableWidgetItem;
+    timeStep_     = new QTableWidgetItem;
+    storeSamples_ = new QTableWidgetItem;
+    storeSamples_->setFlags(Qt::ItemIsUserCheckable | Qt::ItemIsEnabled);
+    tolerance_    = new QTableWidgetItem;
+    mlmcLevels_   = new QTableWidgetItem;
+    ensemble_     = new QTableWidgetItem;
+    sweep_        = new QTableWidgetItem;
+    sensitivity_  = new QTableWidgetItem;
+    sensitivity_->setFlags(Qt::ItemIsUserCheckable | Qt::ItemIsEnabled);
+    quickEstimate_ = new QTableWidgetItem;
+    quickEstimate_->setFlags(Qt::ItemIsUserCheckable | Qt::ItemIsEnabled);
+    surrogate_    = new QTableWidgetItem;
+    search_       = new QTableWidgetItem;
+    snapshots_    = new QTableWidgetItem;
+    sweptPath_    = new QTableWidgetItem;
+    sweptPath_->setFlags(Qt::ItemIsUserCheckable | Qt::ItemIsEnabled);
+
+    // Must match the order of the Sampling enum.
+    samplingBox_ = new QComboBox;
+    samplingBox_->addItem(tr("Random"));
+    samplingBox_->addItem(tr("Sobol (quasi-random)"));
+    samplingBox_->addItem(tr("Latin hypercube"));
+    samplingBox_->addItem(tr("Antithetic pairs"));
+
+    // Must match the order of the Integrator enum.
+    integratorBox_ = new QComboBox;
+    integratorBox_->addItem(tr("Euler"));
+    integratorBox_->addItem(tr("Runge-Kutta (RK4)"));
+    integratorBox_->addItem(tr("Circular arcs"));
 
     QTableWidget* table = new QTableWidget;
     table->setRowCount(vert.size());
@@ -572,9 +1357,22 @@ QWidget* MainWnd::createCalcBox()
     table->setHorizontalHeaderLabels(horz);
     table->setVerticalHeaderLabels(vert);
     table->setItem(0, 0, timeStep_);
-    table->setItem(1, 0, iterations_);
-    table->setItem(2, 0, numCells_);
-    table->setItem(3, 0, cellSize_);
+    table->setCellWidget(1, 0, integratorBox_);
+    table->setItem(2, 0, iterations_);
+    table->setItem(3, 0, numCells_);
+    table->setItem(4, 0, cellSize_);
+    table->setItem(5, 0, storeSamples_);
+    table->setItem(6, 0, tolerance_);
+    table->setCellWidget(7, 0, samplingBox_);
+    table->setItem(8, 0, mlmcLevels_);
+    table->setItem(9, 0, ensemble_);
+    table->setItem(10, 0, sweep_);
+    table->setItem(11, 0, sensitivity_);
+    table->setItem(12, 0, quickEstimate_);
+    table->setItem(13, 0, surrogate_);
+    table->setItem(14, 0, search_);
+    table->setItem(15, 0, snapshots_);
+    table->setItem(16, 0, sweptPath_);
 
     QHBoxLayout* layout = new QHBoxLayout;
     layout->addWidget(table);
@@ -714,55 +1512,402 @@ void MainWnd::addDefaultDataSet()
 
 void MainWnd::timerEvent(QTimerEvent*)
 {
+    bool refresh = (++timerTicks_ % previewTicks) == 0;
+
     pthread_mutex_lock(&params_.mutex);
-    int complete  = params_.completed;
-    bool finished = (params_.completed == params_.totalIterations);
+    int complete    = params_.completed;
+    bool finished   = (params_.threadsRunning == 0);
+    bool checkpoint = !finished && convergence_ && convergence_->checkpointDue(complete);
+    std::vector<int> levelCompleted = params_.levelCompleted;
     pthread_mutex_unlock(&params_.mutex);
 
+    std::vector<GridChange> changes;
+    takeChanges(params_, changes);
+    if(finished)
+    {
+        joinWorkers();
+
+        // The workers are done with the grid. A multilevel run only combines
+        // its levels into it now, rather than after every chunk.
+        if(params_.mlmcLevels > 0)
+        {
+            combineLevels(params_);
+        }
+        preview_ = params_.grid;
+    }
+    else
+    {
+        // Bring the preview's copy of the grid up to date without holding up
+        // the workers, which only wait for the changes to be swapped out.
+        for(size_t i = 0; i < changes.size(); ++i)
+        {
+            const GridChange& change = changes[i];
+            if(params_.mlmcLevels > 0)
+            {
+                previewLevels_[change.level][change.idx] += change.weight;
+            }
+            else
+            {
+                preview_[change.idx] += change.weight;
+            }
+        }
+        if((params_.mlmcLevels > 0) && (refresh || checkpoint))
+        {
+            combineLevels(previewLevels_, levelCompleted, preview_);
+        }
+    }
+
     progress_->setValue(complete);
+    if(refresh || finished)
+    {
+        heatmap_->setGrid(preview_, params_.gridCellsX, params_.gridCellsY);
+    }
+    if(checkpoint && convergence_->checkpoint(preview_, complete))
+    {
+        stopEarly();
+    }
     if(finished)
     {
         killTimer(timerId_);
         timerId_ = 0;
 
-        kml_->startFolder("Grid");
-        int idx            = 0;
-        double y           = params_.gridOrigin.y_;
-        double highestCell = *std::max_element(params_.grid.begin(), params_.grid.end());
-        for(int row = 0; row < params_.gridCellsY; ++row, y += params_.metresPerCell)
+        writeTracks();
+        writeStatsEllipses(*kml_, params_.stats);
+        writeGrid();
+        writeSearch();
+        writeSnapshots();
+        writePath();
+        kml_.reset();
+        writeStatsSummary(params_.stats, QString("%1/summary.txt").arg(QApplication::applicationDirPath()).toStdString());
+
+        QStringList summary;
+        if(!estimateText_.isEmpty())
         {
-            double x = params_.gridOrigin.x_;
-            for(int col = 0; col < params_.gridCellsX; ++col, ++idx, x += params_.metresPerCell)
+            summary.push_back(estimateText_);
+        }
+        if(convergence_)
+        {
+            double cellArea = params_.metresPerCell * params_.metresPerCell / 1e6;
+            summary.push_back(
+                        tr("%1 after %2 iterations. Change at last check: grid %3%, 50% area %4 km2 (%5%), 90% area %6 km2 (%7%)")
+                        .arg(convergence_->converged() ? tr("Converged") : tr("Not converged"))
+                        .arg(complete)
+                        .arg(100.0 * convergence_->distributionChange(), 0, 'f', 2)
+                        .arg(convergence_->area50() * cellArea, 0, 'f', 1)
+                        .arg(100.0 * convergence_->area50Change(), 0, 'f', 2)
+                        .arg(convergence_->area90() * cellArea, 0, 'f', 1)
+                        .arg(100.0 * convergence_->area90Change(), 0, 'f', 2)
+                        );
+        }
+        // The chunks of an ensemble run come from different scenarios, so
+        // their spread says nothing about the sampling.
+        double reduction = params_.scenarios.empty() ? estimatedVarianceReduction(params_.moments) : 0.0;
+        if((params_.sampling != RANDOM_SAMPLING) && (reduction > 0.0))
+        {
+            summary.push_back(tr("Estimated variance reduction of the mean crash position: %1x").arg(reduction, 0, 'f', 2));
+        }
+        if(params_.mlmcLevels > 0)
+        {
+            QStringList counts;
+            for(size_t l = 0; l < params_.levelCompleted.size(); ++l)
             {
-                Track3D cell;
-                cell.addPoint(x, y, 0);
-                cell.addPoint(x + params_.metresPerCell, y, 0);
-                cell.addPoint(x + params_.metresPerCell, y + params_.metresPerCell, 0);
-                cell.addPoint(x, y + params_.metresPerCell, 0);
-                cell.addPoint(x, y, 0);
-                cell.convertAMG66toWGS84();
-
-                const char* style;
-                int level = std::round((4 * params_.grid[idx]) / highestCell);
-                switch(level)
-                {
-                case 1:
-                    style = "cell_25"; break;
-                case 2:
-                    style = "cell_50"; break;
-                case 3:
-                    style = "cell_75"; break;
-                case 4:
-                    style = "cell_100"; break;
-                default:
-                    style = ((row == 0) && (col == 0)) ? "origin_cell" : "empty_cell"; break;
-                }
-                kml_->addPolygon(cell, NULL, style, false);
+                counts.push_back(QString::number(params_.levelCompleted[l]));
             }
+            summary.push_back(
+                        tr("Multilevel samples per level (coarsest first): %1. Integration work %2% of a single level run at the finest step.")
+                        .arg(counts.join(", "))
+                        .arg(100.0 * multilevelWork(params_), 0, 'f', 1)
+                        );
         }
-        kml_.reset();
+        if(!params_.scenarios.empty())
+        {
+            QStringList counts;
+            for(size_t s = 0; s < params_.scenarioCompleted.size(); ++s)
+            {
+                counts.push_back(tr("%1 %2").arg(ensembleNames_[s]).arg(params_.scenarioCompleted[s]));
+            }
+            summary.push_back(tr("Ensemble samples: %1").arg(counts.join(", ")));
+        }
+        if(!surrogateText_.isEmpty())
+        {
+            summary.push_back(surrogateText_);
+        }
+        if(!containmentText_.isEmpty())
+        {
+            summary.push_back(containmentText_);
+        }
+        if(!searchText_.isEmpty())
+        {
+            summary.push_back(searchText_);
+        }
+        if(!snapshotText_.isEmpty())
+        {
+            summary.push_back(snapshotText_);
+        }
+        if(!pathText_.isEmpty())
+        {
+            summary.push_back(pathText_);
+        }
+        if(params_.stats.count() > 0.0)
+        {
+            const CrashStats& stats = params_.stats;
+            summary.push_back(
+                        tr("Mean crash position %1 %2, standard deviation %3 / %4 m. Half the crashes within %5 km and 95% within %6 km of the nominal. Statistics written to summary.txt")
+                        .arg(stats.mean().x_, 0, 'f', 0)
+                        .arg(stats.mean().y_, 0, 'f', 0)
+                        .arg(sqrt(stats.covXX()), 0, 'f', 0)
+                        .arg(sqrt(stats.covYY()), 0, 'f', 0)
+                        .arg(stats.quantileRadius(0.5) / 1000.0, 0, 'f', 1)
+                        .arg(stats.quantileRadius(0.95) / 1000.0, 0, 'f', 1)
+                        );
+        }
+        if(!params_.sweepVariants.empty())
+        {
+            writeSweep(params_, QApplication::applicationDirPath().toStdString());
+            summary.push_back(tr("Sweep of %1 variants written to sweep.csv").arg(params_.sweepVariants.size()));
+        }
+        if(params_.sensitivity)
+        {
+            std::vector<SobolIndex> indices;
+            sobolIndices(params_, indices);
+            writeSensitivity(indices, QApplication::applicationDirPath().toStdString());
+
+            // Name the inputs that matter most, by the larger of their total
+            // indices for easting and northing.
+            std::sort(indices.begin(), indices.end(), [](const SobolIndex& a, const SobolIndex& b)
+            {
+                return std::max(a.total[0], a.total[1]) > std::max(b.total[0], b.total[1]);
+            });
+            QStringList top;
+            for(size_t i = 0; (i < indices.size()) && (i < 3); ++i)
+            {
+                top.push_back(tr("%1 %2/%3")
+                              .arg(QString::fromStdString(indices[i].name))
+                              .arg(indices[i].total[0], 0, 'f', 2)
+                              .arg(indices[i].total[1], 0, 'f', 2));
+            }
+            summary.push_back(tr("Largest total Sobol indices (E/N): %1. All indices written to sensitivity.csv").arg(top.join(", ")));
+        }
+        status_->setText(summary.join("\n"));
 
         progress_->setVisible(false);
+        regridBtn_->setEnabled(!params_.crashPoints.empty());
+        reweightBtn_->setEnabled(!params_.sampleInputs.empty());
+        stopBtn_->setVisible(false);
+        stopBtn_->setEnabled(true);
         startBtn_->setText(tr("Start"));
     }
 }
+
+void MainWnd::setupGrid()
+{
+    params_.gridCellsX    = numCells_->text().toInt();
+    params_.gridCellsY    = numCells_->text().toInt();
+    params_.metresPerCell = cellSize_->text().toDouble();
+    params_.grid.assign(params_.gridCellsX * params_.gridCellsY, 0.0);
+
+    // Centre the grid on the nominal crash position.
+    params_.gridOrigin = Point2D(
+                nominalCrashPos_.x_ - (params_.gridCellsX * params_.metresPerCell * 0.5),
+                nominalCrashPos_.y_ - (params_.gridCellsY * params_.metresPerCell * 0.5)
+                );
+}
+
+void MainWnd::writeGrid()
+{
+    const double cellArea = params_.metresPerCell * params_.metresPerCell / 1e6;
+    QStringList areas;
+    kml_->startFolder("Containment");
+    for(size_t i = 0; i < numRegions; ++i)
+    {
+        // The areas are of the cells drawn, ties at the threshold and all.
+        ContainmentLevel level = containmentLevel(params_.grid, regions[i].fraction, numThreads);
+        std::vector<char> inside;
+        size_t cells = containmentMask(params_.grid, level, inside);
+        areas.push_back(tr("%1% %2 km2").arg(int(100 * regions[i].fraction)).arg(cells * cellArea, 0, 'f', 1));
+        if(cells == 0)
+            continue;
+
+        std::vector<std::vector<Point2D> > rings;
+        containmentOutlines(inside, params_.gridCellsX, params_.gridCellsY, rings);
+        QString name = tr("%1% containment (%2 km2)").arg(int(100 * regions[i].fraction)).arg(cells * cellArea, 0, 'f', 1);
+        for(size_t r = 0; r < rings.size(); ++r)
+        {
+            Track3D outline;
+            for(size_t p = 0; p < rings[r].size(); ++p)
+            {
+                outline.addPoint(
+                            params_.gridOrigin.x_ + (rings[r][p].x_ * params_.metresPerCell),
+                            params_.gridOrigin.y_ + (rings[r][p].y_ * params_.metresPerCell),
+                            0);
+            }
+            outline.convertAMG66toWGS84();
+            kml_->addTrack(outline, name.toStdString().c_str(), regions[i].style, false);
+        }
+    }
+    containmentText_ = tr("Containment areas: %1").arg(areas.join(", "));
+
+    // The cells coloured by fraction of the fullest cell, and again by
+    // containment band in a folder of their own.
+    std::vector<const char*> styles;
+    fractionStyles(params_.grid, styles);
+    writeCells(params_.grid, styles, "Grid", std::string(), true);
+    containmentStyles(params_.grid, styles);
+    writeCells(params_.grid, styles, tr("Containment bands").toStdString(), std::string(), false);
+}
+
+void MainWnd::writeCells(const std::vector<double>& grid, const std::vector<const char*>& styles, const std::string& folder, const std::string& when, bool emptyCells)
+{
+    kml_->startFolder(folder, when);
+    int idx    = 0;
+    double y   = params_.gridOrigin.y_;
+    for(int row = 0; row < params_.gridCellsY; ++row, y += params_.metresPerCell)
+    {
+        double x = params_.gridOrigin.x_;
+        for(int col = 0; col < params_.gridCellsX; ++col, ++idx, x += params_.metresPerCell)
+        {
+            if(!emptyCells && (grid[idx] <= 0.0))
+                continue;
+
+            Track3D cell;
+            cell.addPoint(x, y, 0);
+            cell.addPoint(x + params_.metresPerCell, y, 0);
+            cell.addPoint(x + params_.metresPerCell, y + params_.metresPerCell, 0);
+            cell.addPoint(x, y + params_.metresPerCell, 0);
+            cell.addPoint(x, y, 0);
+            cell.convertAMG66toWGS84();
+
+            const char* style = ((row == 0) && (col == 0)) ? "origin_cell" : "empty_cell";
+            if(styles[idx] != NULL)
+            {
+                style = styles[idx];
+            }
+            kml_->addPolygon(cell, NULL, style, false);
+        }
+    }
+}
+
+void MainWnd::writeSearch()
+{
+    searchText_.clear();
+    if(search_->text().trimmed().isEmpty())
+        return;
+
+    SearchSettings search;
+    try
+    {
+        parseSearchSettings(search_->text().toStdString(), search);
+    }
+    catch(const std::exception& e)
+    {
+        searchText_ = tr("No search plan: %1").arg(e.what());
+        return;
+    }
+
+    SearchPlan plan;
+    planSearch(
+                params_.grid,
+                params_.gridCellsX,
+                params_.gridCellsY,
+                params_.metresPerCell,
+                std::vector<double>(1, search.sweepWidth),
+                search.detection,
+                search.trackLength(),
+                search.units,
+                numThreads,
+                plan);
+    writeSearchCells(*kml_, params_, plan);
+    writeSearchPlan(params_, plan, QString("%1/searchplan.csv").arg(QApplication::applicationDirPath()).toStdString());
+
+    const double cellArea = params_.metresPerCell * params_.metresPerCell / 1e6;
+    searchText_ = tr("Search plan: %1 units flying %2 km find the wreck with probability %3%, searching %4 cells (%5 km2)")
+            .arg(search.units)
+            .arg(plan.trackLength / 1000.0, 0, 'f', 0)
+            .arg(100.0 * plan.success, 0, 'f', 1)
+            .arg(plan.cellsSearched)
+            .arg(plan.cellsSearched * cellArea, 0, 'f', 1);
+}
+
+void MainWnd::writeTracks()
+{
+    // Any standard deviation tracks that failed are left out.
+    writeStdTracks(*kml_, stdTracks_);
+    if(!stdTracks_.error.empty())
+    {
+        QMessageBox::warning(this, tr("Standard deviation tracks"), tr("Some of the tracks failed and are left out of the KML file: %1").arg(stdTracks_.error.c_str()));
+    }
+}
+
+void MainWnd::writeSnapshots()
+{
+    snapshotText_.clear();
+    if(params_.snapshotGrids.empty())
+        return;
+
+    // One folder of cells for each time, stamped with it if there's a date.
+    const double cellArea = params_.metresPerCell * params_.metresPerCell / 1e6;
+    QStringList areas;
+    for(size_t i = 0; i < params_.snapshotGrids.size(); ++i)
+    {
+        const std::vector<double>& grid = params_.snapshotGrids[i];
+        std::vector<const char*> styles;
+        containmentStyles(grid, styles);
+        writeCells(grid, styles, tr("Position at %1").arg(snapshotNames_[i]).toStdString(), snapshotStamps_[i].toStdString(), false);
+        std::vector<char> inside;
+        size_t cells = containmentMask(grid, containmentLevel(grid, 0.9, numThreads), inside);
+        areas.push_back(tr("%1 %2 km2").arg(snapshotNames_[i]).arg(cells * cellArea, 0, 'f', 1));
+    }
+    snapshotText_ = tr("90% areas at the snapshots: %1").arg(areas.join(", "));
+}
+
+void MainWnd::writePath()
+{
+    pathText_.clear();
+    if(params_.pathGrid.empty())
+        return;
+
+    // Each sample counts once in every cell it passed over, so over the
+    // weight of the samples the cells hold the chance the aircraft flew
+    // over them.
+    const double samples = params_.stats.count();
+    if(samples <= 0.0)
+        return;
+
+    // The counts don't add up to the number of samples, so the cells are
+    // shaded by their chance of being passed over rather than by containment.
+    std::vector<const char*> styles(params_.pathGrid.size(), NULL);
+    std::ofstream os(QString("%1/path.csv").arg(QApplication::applicationDirPath()).toStdString().c_str());
+    os << "Easting,Northing,Passed over (%)" << std::endl;
+    size_t cells   = 0;
+    double highest = 0.0;
+    for(size_t idx = 0; idx < params_.pathGrid.size(); ++idx)
+    {
+        double probability = params_.pathGrid[idx] / samples;
+        if(probability <= 0.0)
+            continue;
+
+        int row = int(idx) / params_.gridCellsX;
+        int col = int(idx) % params_.gridCellsX;
+        os << params_.gridOrigin.x_ + (col * params_.metresPerCell) << ","
+           << params_.gridOrigin.y_ + (row * params_.metresPerCell) << ","
+           << 100.0 * probability << std::endl;
+        ++cells;
+        highest = std::max(highest, probability);
+
+        for(size_t i = 0; i < numPathBands; ++i)
+        {
+            if(probability >= pathBands[i].probability)
+            {
+                styles[idx] = pathBands[i].cellStyle;
+                break;
+            }
+        }
+    }
+    writeCells(params_.pathGrid, styles, tr("Swept path").toStdString(), std::string(), false);
+
+    const double cellArea = params_.metresPerCell * params_.metresPerCell / 1e6;
+    pathText_ = tr("Swept path: %1 cells (%2 km2) passed over, the busiest by %3% of the tracks. Written to path.csv")
+            .arg(cells)
+            .arg(cells * cellArea, 0, 'f', 1)
+            .arg(100.0 * highest, 0, 'f', 1);
+}
@@ -7,9 +7,14 @@
 #include <QSettings>
 #include <QTableWidget>
 #include <QProgressBar>
+#include <QLabel>
 #include <QPushButton>
 #include "thread.h"
 #include "kmlfile.h"
+#include "point3d.h"
+#include "util.h"
+#include "heatmapwidget.h"
+#include "convergence.h"
 
 class MainWnd : public QMainWindow
 {
@@ -23,6 +28,9 @@ public slots:
     void loadSettings();
     void saveSettings();
     void startStop();
+    void stopEarly();
+    void regrid();
+    void reweight();
 
     void addFlightRow();
     void delFlightRow();
@@ -36,25 +44,79 @@ protected:
     QWidget* createFlightBox();
     QWidget* createWindBox();
     void addDefaultDataSet();
+    void readParams(ThreadParams& params);
+    QVariantMap dataSetValues();
+    bool readScenario(QString dataSet, Scenario& scenario);
+    bool readEnsemble(ThreadParams& params);
+    bool readSnapshots(ThreadParams& params);
+    bool loadEnvironment(Scenario& scenario, const QString& windField, const QString& terrain, const QString& fixTime);
+    void setupGrid();
+    void writeTracks();
+    void writeGrid();
+    void writeCells(const std::vector<double>& grid, const std::vector<const char*>& styles, const std::string& folder, const std::string& when, bool emptyCells);
+    void writeSnapshots();
+    void writePath();
+    void writeSearch();
+    void joinWorkers();
     virtual void timerEvent(QTimerEvent*);
 
     QSettings*    settings_;
     QComboBox*    dataSetBox_;
     QProgressBar* progress_;
+    QLabel*       status_;
     QPushButton*  startBtn_;
+    QPushButton*  stopBtn_;
+    QPushButton*  regridBtn_;
+    QPushButton*  reweightBtn_;
+    HeatmapWidget* heatmap_;
     ThreadParams  params_;
+    QStringList   ensembleNames_;
+    QString       estimateText_;
+    QString       surrogateText_;
+    QString       containmentText_;
+    QString       searchText_;
+    QString       snapshotText_;
+    QStringList   snapshotNames_;
+    QStringList   snapshotStamps_; // KML times, empty without a date
+    QString       pathText_;
+    Point3D       nominalCrashPos_;
+    StdTracks     stdTracks_;
     int           timerId_;
+    std::vector<pthread_t> workers_; // until joined by joinWorkers()
+    int           timerTicks_;
+    std::vector<double> preview_;
+    std::vector<std::vector<double> > previewLevels_;
     std::shared_ptr<KmlFile> kml_;
+    std::shared_ptr<ConvergenceMonitor> convergence_;
 
     QTableWidgetItem* timeStep_;
+    QComboBox*        integratorBox_;
     QTableWidgetItem* numCells_;
     QTableWidgetItem* cellSize_;
     QTableWidgetItem* iterations_;
+    QTableWidgetItem* storeSamples_;
+    QTableWidgetItem* tolerance_;
+    QComboBox*        samplingBox_;
+    QTableWidgetItem* mlmcLevels_;
+    QTableWidgetItem* ensemble_;
+    QTableWidgetItem* sweep_;
+    QTableWidgetItem* sensitivity_;
+    QTableWidgetItem* quickEstimate_;
+    QTableWidgetItem* surrogate_;
+    QTableWidgetItem* search_;
+    QTableWidgetItem* snapshots_;
+    QTableWidgetItem* sweptPath_;
 
     QTableWidgetItem* towerEasting_;
     QTableWidgetItem* towerNorthing_;
     QTableWidgetItem* towerCell_;
     QTableWidgetItem* gridToMag_;
+    QTableWidgetItem* sightingEasting_;
+    QTableWidgetItem* sightingNorthing_;
+    QTableWidgetItem* sightingRadius_;
+    QTableWidgetItem* windField_;
+    QTableWidgetItem* terrain_;
+    QTableWidgetItem* windCorrelation_;
 
     QTableWidgetItem* fixRangeMean_;
     QTableWidgetItem* fixRangeStd_;
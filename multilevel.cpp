@@ -0,0 +1,92 @@
+#include "multilevel.h"
+
+#include <algorithm>
+#include <cmath>
+
+void setupLevels(ThreadParams& params, int coarseIterations)
+{
+    const int levels = params.mlmcLevels + 1;
+
+    // The difference between the tracks at successive steps shrinks in
+    // proportion to the step, and so does the variance of the difference in
+    // the cell counts, while the cost of a sample doubles at each level.
+    // Halving the number of samples at each level balances the two.
+    std::vector<int> chunks(levels);
+    int totalChunks = 0;
+    for(int l = 0; l < levels; ++l)
+    {
+        double n  = coarseIterations / (chunkSize * pow(2.0, l));
+        chunks[l] = std::max(1, int(std::round(n)));
+        totalChunks += chunks[l];
+    }
+
+    // Order the chunks by how far through its level each one is.
+    std::vector<std::pair<double, int> > order;
+    order.reserve(totalChunks);
+    for(int l = 0; l < levels; ++l)
+    {
+        for(int c = 0; c < chunks[l]; ++c)
+        {
+            order.push_back(std::make_pair((c + 0.5) / chunks[l], l));
+        }
+    }
+    std::sort(order.begin(), order.end());
+
+    params.chunkLevels.resize(totalChunks);
+    for(int c = 0; c < totalChunks; ++c)
+    {
+        params.chunkLevels[c] = order[c].second;
+    }
+    params.levelCompleted.assign(levels, 0);
+    params.levelGrids.assign(levels, std::vector<double>(params.gridCellsX * params.gridCellsY, 0.0));
+    params.totalIterations = totalChunks * chunkSize;
+}
+
+double levelTimeStep(const ThreadParams& params, int level)
+{
+    return params.timeStep * pow(2.0, params.mlmcLevels - level);
+}
+
+void combineLevels(ThreadParams& params)
+{
+    combineLevels(params.levelGrids, params.levelCompleted, params.grid);
+}
+
+void combineLevels(const std::vector<std::vector<double> >& levelGrids, const std::vector<int>& levelCompleted, std::vector<double>& grid)
+{
+    grid = levelGrids[0];
+
+    const double coarseSamples = levelCompleted[0];
+    for(size_t l = 1; l < levelGrids.size(); ++l)
+    {
+        if(levelCompleted[l] == 0)
+            continue;
+
+        const std::vector<double>& diff = levelGrids[l];
+        double scale = coarseSamples / levelCompleted[l];
+        for(size_t c = 0; c < grid.size(); ++c)
+        {
+            grid[c] += scale * diff[c];
+        }
+    }
+
+    for(size_t c = 0; c < grid.size(); ++c)
+    {
+        grid[c] = std::max(grid[c], 0.0);
+    }
+}
+
+double multilevelWork(const ThreadParams& params)
+{
+    if(params.levelCompleted.empty() || (params.levelCompleted[0] == 0))
+        return 0.0;
+
+    // Measured in steps of the coarsest level. A level l sample integrates
+    // 2^l steps at its own step and 2^(l-1) at the coarser one.
+    double work = params.levelCompleted[0];
+    for(size_t l = 1; l < params.levelCompleted.size(); ++l)
+    {
+        work += params.levelCompleted[l] * 1.5 * pow(2.0, l);
+    }
+    return work / (params.levelCompleted[0] * pow(2.0, params.mlmcLevels));
+}
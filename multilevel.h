@@ -0,0 +1,29 @@
+#ifndef MULTILEVEL_H
+#define MULTILEVEL_H
+
+#include "thread.h"
+
+// Sets up the levels of a multilevel run (see ThreadParams::mlmcLevels).
+// Level 0 gets coarseIterations samples and each finer level half as many as
+// the one below it, rounded to whole chunks. The chunks of the levels are
+// interleaved so that a run stopped early has made proportional progress on
+// every level. Sets totalIterations to the total over all levels.
+void setupLevels(ThreadParams& params, int coarseIterations);
+
+// The time step used by the given level.
+double levelTimeStep(const ThreadParams& params, int level);
+
+// Rebuilds the grid from the level sums: the level 0 counts plus the mean
+// difference of each finer level, scaled to the number of level 0 samples.
+// Cells that come out negative (possible where the corrections are noisy and
+// the probability is small) are clamped to zero.
+void combineLevels(ThreadParams& params);
+
+// The same for level sums and counts kept elsewhere, such as the preview's.
+void combineLevels(const std::vector<std::vector<double> >& levelGrids, const std::vector<int>& levelCompleted, std::vector<double>& grid);
+
+// Integration work of the completed samples as a fraction of the work needed
+// to run the same number of level 0 samples at the finest time step.
+double multilevelWork(const ThreadParams& params);
+
+#endif // MULTILEVEL_H
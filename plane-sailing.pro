@@ -24,7 +24,25 @@ SOURCES += main.cpp \
     units.cpp \
     thread.cpp \
     mainwnd.cpp \
-    distributionset.cpp
+    distributionset.cpp \
+    reweight.cpp \
+    heatmapwidget.cpp \
+    containment.cpp \
+    convergence.cpp \
+    sobol.cpp \
+    sampler.cpp \
+    multilevel.cpp \
+    windfield.cpp \
+    localprojection.cpp \
+    terrain.cpp \
+    ensemble.cpp \
+    sweep.cpp \
+    sensitivity.cpp \
+    estimate.cpp \
+    surrogate.cpp \
+    crashstats.cpp \
+    searchplan.cpp \
+    trackpath.cpp
 
 HEADERS += \
     util.h \
@@ -37,6 +55,25 @@ HEADERS += \
     units.h \
     thread.h \
     mainwnd.h \
-    distributionset.h
+    distributionset.h \
+    reweight.h \
+    heatmapwidget.h \
+    containment.h \
+    convergence.h \
+    sobol.h \
+    sampler.h \
+    multilevel.h \
+    trackkernel.h \
+    windfield.h \
+    localprojection.h \
+    terrain.h \
+    ensemble.h \
+    sweep.h \
+    sensitivity.h \
+    estimate.h \
+    surrogate.h \
+    crashstats.h \
+    searchplan.h \
+    trackpath.h
 
 LIBS += -lpthread
@@ -35,7 +35,12 @@ void PointSet::addPoint(double x, double y)
 
 double PointSet::interpolate(double x) const
 {
-    if(points_.size() == 2)
+    if(points_.size() == 1)
+    {
+        // A single point is a constant.
+        return points_.front().y_;
+    }
+    else if(points_.size() == 2)
     {
         // Only two points in the set. Just interpolate these.
         const Point2D& p1 = points_.front();
@@ -18,7 +18,8 @@ public:
 
     // Determines the y valuefor a given x. If the y value is within our range
     // then the nearest (by x) known points are interpolated, otherwise the
-    // points at the nearest end are extrapolated.
+    // points at the nearest end are extrapolated. A set of one point is
+    // constant.
     double interpolate(double x) const;
 
     Point2D& operator [] (int idx) { return points_[idx]; }
@@ -0,0 +1,180 @@
+#include "reweight.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include "util.h"
+
+namespace
+{
+
+struct WeightJob
+{
+    ThreadParams*                           params;
+    const SpatialLikelihood*                sighting;
+    const std::vector<const Distribution*>* oldDists;
+    const std::vector<const Distribution*>* newDists;
+    const DistributionSet*                  oldWind;
+    const DistributionSet*                  newWind;
+    size_t                                  begin;
+    size_t                                  end;
+    double                                  maxLogWeight;
+};
+
+// Stores the log of each sample's weight in params.sampleWeights.
+void* logWeightThread(void* param)
+{
+    WeightJob* job = reinterpret_cast<WeightJob*>(param);
+    ThreadParams& tp = *job->params;
+    const std::vector<const Distribution*>& oldDists = *job->oldDists;
+    const std::vector<const Distribution*>& newDists = *job->newDists;
+    const size_t numInputs = oldDists.size();
+
+    // The wind profile rows come last. They may be correlated, so they are
+    // compared as a whole rather than one at a time.
+    const size_t numWind     = job->oldWind->size();
+    const size_t numMarginal = numInputs - numWind;
+    std::vector<double> windZ(numWind);
+    std::vector<double> windValues(numWind);
+    PointSet wind;
+
+    job->maxLogWeight = -std::numeric_limits<double>::infinity();
+    for(size_t i = job->begin; i < job->end; ++i)
+    {
+        const float* z = &tp.sampleInputs[i * numInputs];
+        double logWeight = 0.0;
+        for(size_t j = 0; j < numMarginal; ++j)
+        {
+            // Recover the value actually used by the sample and compare how
+            // likely it is under the new and old distributions.
+            double x = oldDists[j]->offsetMean(z[j]);
+            logWeight += newDists[j]->logDensity(x) - oldDists[j]->logDensity(x);
+        }
+
+        if(numWind > 0)
+        {
+            std::copy(z + numMarginal, z + numInputs, windZ.begin());
+            job->oldWind->fromNormals(windZ.data(), wind);
+            for(size_t j = 0; j < numWind; ++j)
+            {
+                windValues[j] = wind[j].y_;
+            }
+            logWeight += job->newWind->logDensity(windValues.data()) - job->oldWind->logDensity(windValues.data());
+        }
+
+        if(job->sighting != NULL)
+        {
+            double dx = (tp.crashPoints[i].x_ - job->sighting->position.x_) / job->sighting->stdDev;
+            double dy = (tp.crashPoints[i].y_ - job->sighting->position.y_) / job->sighting->stdDev;
+            logWeight -= 0.5 * ((dx * dx) + (dy * dy));
+        }
+
+        tp.sampleWeights[i] = logWeight;
+        job->maxLogWeight   = std::max(job->maxLogWeight, logWeight);
+    }
+    return NULL;
+}
+
+// Converts the log weights to weights relative to the largest one.
+void* expWeightThread(void* param)
+{
+    WeightJob* job = reinterpret_cast<WeightJob*>(param);
+    ThreadParams& tp = *job->params;
+    for(size_t i = job->begin; i < job->end; ++i)
+    {
+        tp.sampleWeights[i] = std::exp(tp.sampleWeights[i] - job->maxLogWeight);
+    }
+    return NULL;
+}
+
+void runJobs(std::vector<WeightJob>& jobs, void* (*func)(void*))
+{
+    std::vector<pthread_t> ids(jobs.size());
+    for(size_t i = 0; i < jobs.size(); ++i)
+    {
+        pthread_create(&ids[i], NULL, func, &jobs[i]);
+    }
+    for(size_t i = 0; i < jobs.size(); ++i)
+    {
+        pthread_join(ids[i], NULL);
+    }
+}
+
+} // namespace
+
+double reweightSamples(
+        ThreadParams&            params,
+        const ThreadParams&      updated,
+        const SpatialLikelihood* sighting,
+        int                      numThreads
+        )
+{
+    std::vector<const Distribution*> oldDists;
+    std::vector<const Distribution*> newDists;
+    inputDistributions(params, oldDists);
+    inputDistributions(updated, newDists);
+
+    const size_t numSamples = params.crashPoints.size();
+    if(numSamples == 0)
+        throw std::runtime_error("There are no samples to reweight");
+    if(params.sampleInputs.size() != numSamples * oldDists.size())
+        throw std::runtime_error("The sample inputs were not stored by the last run");
+    if(newDists.size() != oldDists.size())
+        throw std::runtime_error("The flight or wind profile has changed shape since the last run");
+    for(size_t j = 0; j < oldDists.size(); ++j)
+    {
+        // A value that was fixed can't be reweighted to a spread of values.
+        if((oldDists[j]->stdDev() == 0.0) && (newDists[j]->stdDev() != 0.0))
+            throw std::runtime_error("An input that had no spread in the last run now has one");
+    }
+    if((sighting != NULL) && (sighting->stdDev <= 0.0))
+        throw std::runtime_error("The sighting radius must be positive");
+
+    params.sampleWeights.resize(numSamples);
+    std::vector<WeightJob> jobs(numThreads);
+    for(int i = 0; i < numThreads; ++i)
+    {
+        jobs[i].params   = &params;
+        jobs[i].sighting = sighting;
+        jobs[i].oldDists = &oldDists;
+        jobs[i].newDists = &newDists;
+        jobs[i].oldWind  = &params.windProfile;
+        jobs[i].newWind  = &updated.windProfile;
+        jobs[i].begin    = (numSamples * i) / numThreads;
+        jobs[i].end      = (numSamples * (i + 1)) / numThreads;
+    }
+    runJobs(jobs, logWeightThread);
+
+    double maxLogWeight = -std::numeric_limits<double>::infinity();
+    for(int i = 0; i < numThreads; ++i)
+    {
+        maxLogWeight = std::max(maxLogWeight, jobs[i].maxLogWeight);
+    }
+    if(!std::isfinite(maxLogWeight))
+        throw std::runtime_error("None of the samples are possible under the new parameters");
+    for(int i = 0; i < numThreads; ++i)
+    {
+        jobs[i].maxLogWeight = maxLogWeight;
+    }
+    runJobs(jobs, expWeightThread);
+
+    double sum   = 0.0;
+    double sumSq = 0.0;
+    for(size_t i = 0; i < numSamples; ++i)
+    {
+        sum   += params.sampleWeights[i];
+        sumSq += params.sampleWeights[i] * params.sampleWeights[i];
+    }
+
+    // Normalise so the grid still holds (weighted) sample counts.
+    const double scale = numSamples / sum;
+    for(size_t i = 0; i < numSamples; ++i)
+    {
+        params.sampleWeights[i] *= scale;
+    }
+    binCrashPoints(params, numThreads);
+
+    return (sum * sum) / sumSq;
+}
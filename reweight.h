@@ -0,0 +1,30 @@
+#ifndef REWEIGHT_H
+#define REWEIGHT_H
+
+#include "thread.h"
+
+// Likelihood of a crash position given a debris sighting: a circular gaussian
+// about the sighting position.
+struct SpatialLikelihood
+{
+    Point2D position;
+    double  stdDev;
+};
+
+// Computes an importance weight for every sample stored by the last run so
+// that the weighted samples follow the distributions in 'updated' rather than
+// those in 'params' that they were drawn from, optionally also conditioned on
+// a sighting. The weights are stored in params.sampleWeights (normalised to a
+// mean of one) and the grid is rebuilt with them.
+//
+// Returns the effective sample size. When this is a small fraction of the
+// number of samples the weights are dominated by a few samples and a fresh
+// run is needed.
+double reweightSamples(
+        ThreadParams&            params,
+        const ThreadParams&      updated,
+        const SpatialLikelihood* sighting,
+        int                      numThreads
+        );
+
+#endif // REWEIGHT_H
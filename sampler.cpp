@@ -0,0 +1,109 @@
+#include "sampler.h"
+
+#include <algorithm>
+
+#include "util.h"
+
+ChunkSampler::ChunkSampler(const ThreadParams& params, int begin, int end, size_t dimensions) :
+    sampling_(params.sampling),
+    dimensions_((dimensions > 0) ? dimensions : runInputCount(params)),
+    size_(end - begin),
+    index_(0)
+{
+    // Each chunk has its own random sequence so that a run doesn't depend on
+    // how the chunks were shared between the threads.
+    std::seed_seq seq = { params.seed, unsigned(begin), unsigned(end) };
+    rng_.seed(seq);
+
+    if(params.sampling == SOBOL_SAMPLING)
+    {
+        // The chunk is its own stretch of the run's sequence.
+        sobol_.reset(new SobolGenerator(params.sobol, begin));
+        uniform_.resize(params.sobol.dimensions());
+    }
+    else if(sampling_ == LATIN_HYPERCUBE_SAMPLING)
+    {
+        // Split each input's range into one stratum per iteration and visit
+        // the strata in a different random order for each input.
+        strata_.resize(size_ * dimensions_);
+        for(size_t j = 0; j < dimensions_; ++j)
+        {
+            int* perm = &strata_[j * size_];
+            for(int i = 0; i < size_; ++i)
+            {
+                perm[i] = i;
+            }
+            std::shuffle(perm, perm + size_, rng_);
+        }
+    }
+    else if(sampling_ == ANTITHETIC_SAMPLING)
+    {
+        previous_.resize(dimensions_);
+    }
+}
+
+void ChunkSampler::next(double* z)
+{
+    const int i = index_++;
+    if(sampling_ == LATIN_HYPERCUBE_SAMPLING)
+    {
+        std::uniform_real_distribution<> uniform;
+        for(size_t j = 0; j < dimensions_; ++j)
+        {
+            double u = (strata_[(j * size_) + i] + uniform(rng_)) / size_;
+            z[j] = inverseNormalCdf(std::min(std::max(u, 1e-16), 1.0 - 1e-16));
+        }
+        return;
+    }
+    if((sampling_ == ANTITHETIC_SAMPLING) && (i % 2 == 1))
+    {
+        // Mirror the previous iteration's inputs about the means.
+        for(size_t j = 0; j < dimensions_; ++j)
+        {
+            z[j] = -previous_[j];
+        }
+        return;
+    }
+
+    size_t j = 0;
+    if(sobol_)
+    {
+        sobol_->next(uniform_.data());
+        for(; j < uniform_.size(); ++j)
+        {
+            z[j] = inverseNormalCdf(uniform_[j]);
+        }
+    }
+
+    // Any dimensions beyond the low-discrepancy ones are pseudo-random.
+    for(; j < dimensions_; ++j)
+    {
+        z[j] = norm_(rng_);
+    }
+
+    if(sampling_ == ANTITHETIC_SAMPLING)
+    {
+        std::copy(z, z + dimensions_, previous_.begin());
+    }
+}
+
+double estimatedVarianceReduction(const ChunkMoments& moments)
+{
+    if((moments.chunks < 10) || (moments.samples < 2))
+        return 0.0;
+
+    // Per-sample variance, i.e. the variance an independent sample has.
+    const double n     = moments.samples;
+    const double meanX = moments.sumX / n;
+    const double meanY = moments.sumY / n;
+    const double varX  = (moments.sumSqX - (n * meanX * meanX)) / (n - 1);
+    const double varY  = (moments.sumSqY - (n * meanY * meanY)) / (n - 1);
+
+    // For independent samples n_c * (chunk mean - mean)^2 also averages to
+    // the per-sample variance. Any reduction shows up as a smaller value.
+    const double chunkX = (moments.chunkSqX - (n * meanX * meanX)) / (moments.chunks - 1);
+    const double chunkY = (moments.chunkSqY - (n * meanY * meanY)) / (moments.chunks - 1);
+    if(chunkX + chunkY <= 0.0)
+        return 0.0;
+    return (varX + varY) / (chunkX + chunkY);
+}
@@ -0,0 +1,43 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <memory>
+#include <random>
+#include <vector>
+#include "thread.h"
+#include "sobol.h"
+
+// Produces the standard normal deviates (see inputDistributions()) for each
+// iteration of one chunk of a run, using the run's sampling scheme. Each chunk
+// is independent of the others so chunks can be run by any thread in any
+// order.
+class ChunkSampler
+{
+public:
+    // Draws runInputCount() deviates per iteration unless dimensions is given.
+    ChunkSampler(const ThreadParams& params, int begin, int end, size_t dimensions = 0);
+
+    size_t dimensions() const { return dimensions_; }
+
+    // Writes the deviates of the next iteration into z.
+    void next(double* z);
+
+protected:
+    Sampling                        sampling_;
+    size_t                          dimensions_;
+    int                             size_;
+    int                             index_;
+    std::mt19937                    rng_;
+    std::normal_distribution<>      norm_;
+    std::shared_ptr<SobolGenerator> sobol_;
+    std::vector<double>             uniform_;
+    std::vector<int>                strata_;   // Latin hypercube permutations
+    std::vector<double>             previous_; // antithetic partner
+};
+
+// Estimates how many times smaller the variance of the mean crash position
+// is than it would be with independent sampling, from the run's chunk
+// moments. Returns 0 if there aren't enough chunks to tell.
+double estimatedVarianceReduction(const ChunkMoments& moments);
+
+#endif // SAMPLER_H
@@ -0,0 +1,367 @@
+#include "searchplan.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <pthread.h>
+
+#include "units.h"
+#include "util.h"
+#include "kmlfile.h"
+#include "point3d.h"
+#include "track3d.h"
+
+namespace
+{
+
+// Below this many cells a pass runs on the calling thread.
+const size_t threadedCells = 10000;
+
+// A cell with some chance of holding the wreck.
+struct SearchCell
+{
+    size_t idx;
+    double probability;
+    double logReturn;       // log of the probability found per metre of track at first
+    double metresPerCoverage;
+};
+
+// The coverage that gives a return per metre of exp(-u) times the first
+// return, i.e. the inverse of the slope of the detection function.
+inline double coverageFor(double u, DetectionModel detection)
+{
+    if(u <= 0.0)
+        return 0.0;
+    return (detection == RANDOM_SEARCH_DETECTION) ? u : sqrt(4.0 * u / M_PI);
+}
+
+inline double detectionFor(double coverage, DetectionModel detection)
+{
+    return (detection == RANDOM_SEARCH_DETECTION) ? 1.0 - exp(-coverage) : erf(coverage * sqrt(M_PI) / 2.0);
+}
+
+// One thread's share of a pass: the track needed to bring its cells down to
+// the given return.
+struct EffortJob
+{
+    const std::vector<SearchCell>* cells;
+    size_t                         begin;
+    size_t                         end;
+    double                         logReturn;
+    DetectionModel                 detection;
+    double                         track;
+};
+
+void* effortThread(void* params)
+{
+    EffortJob* job = reinterpret_cast<EffortJob*>(params);
+    const std::vector<SearchCell>& cells = *job->cells;
+    double track = 0.0;
+    for(size_t i = job->begin; i < job->end; ++i)
+    {
+        track += cells[i].metresPerCoverage * coverageFor(cells[i].logReturn - job->logReturn, job->detection);
+    }
+    job->track = track;
+    return NULL;
+}
+
+double effort(const std::vector<SearchCell>& cells, double logReturn, DetectionModel detection, int numThreads)
+{
+    int threads = (cells.size() < threadedCells) ? 1 : std::max(1, numThreads);
+    std::vector<EffortJob> jobs(threads);
+    for(int t = 0; t < threads; ++t)
+    {
+        jobs[t].cells     = &cells;
+        jobs[t].begin     = (cells.size() * t) / threads;
+        jobs[t].end       = (cells.size() * (t + 1)) / threads;
+        jobs[t].logReturn = logReturn;
+        jobs[t].detection = detection;
+        jobs[t].track     = 0.0;
+    }
+    if(threads == 1)
+    {
+        effortThread(&jobs[0]);
+        return jobs[0].track;
+    }
+
+    std::vector<pthread_t> ids(threads);
+    for(int t = 0; t < threads; ++t)
+    {
+        pthread_create(&ids[t], NULL, effortThread, &jobs[t]);
+    }
+    double retval = 0.0;
+    for(int t = 0; t < threads; ++t)
+    {
+        pthread_join(ids[t], NULL);
+        retval += jobs[t].track;
+    }
+    return retval;
+}
+
+double number(const std::string& name, const std::string& value)
+{
+    char* end;
+    double retval = strtod(value.c_str(), &end);
+    if(value.empty() || (*end != '\0') || (retval <= 0.0))
+        throw std::runtime_error("The search " + name + " must be a positive number, not '" + value + "'");
+    return retval;
+}
+
+} // namespace
+
+double SearchSettings::trackLength() const
+{
+    return units * hoursPerUnit * 3600.0 * KnotsToMPS(speed);
+}
+
+void parseSearchSettings(const std::string& spec, SearchSettings& settings)
+{
+    settings.units        = 0;
+    settings.hoursPerUnit = 0.0;
+    settings.speed        = 0.0;
+    settings.sweepWidth   = 0.0;
+    settings.detection    = RANDOM_SEARCH_DETECTION;
+
+    std::vector<std::string> parts = split(spec, ';');
+    for(size_t i = 0; i < parts.size(); ++i)
+    {
+        size_t eq = parts[i].find('=');
+        if(eq == std::string::npos)
+            throw std::runtime_error("Expected 'setting=value' but found '" + parts[i] + "'");
+
+        std::string name  = trim(parts[i].substr(0, eq));
+        std::string value = trim(parts[i].substr(eq + 1));
+        if(name == "units")
+        {
+            double units = number(name, value);
+            if(units != floor(units))
+                throw std::runtime_error("The number of search units must be a whole number");
+            settings.units = int(units);
+        }
+        else if(name == "hours")
+        {
+            settings.hoursPerUnit = number(name, value);
+        }
+        else if(name == "speed")
+        {
+            settings.speed = number(name, value);
+        }
+        else if(name == "width")
+        {
+            settings.sweepWidth = number(name, value);
+        }
+        else if(name == "detection")
+        {
+            if(value == "random")
+            {
+                settings.detection = RANDOM_SEARCH_DETECTION;
+            }
+            else if(value == "inverseCube")
+            {
+                settings.detection = INVERSE_CUBE_DETECTION;
+            }
+            else
+            {
+                throw std::runtime_error("The search detection must be random or inverseCube, not '" + value + "'");
+            }
+        }
+        else
+        {
+            throw std::runtime_error("There is no search setting '" + name + "'");
+        }
+    }
+    if((settings.units <= 0) || (settings.hoursPerUnit <= 0.0) || (settings.speed <= 0.0) || (settings.sweepWidth <= 0.0))
+        throw std::runtime_error("The search needs units, hours, speed and width");
+}
+
+void planSearch(
+        const std::vector<double>& grid,
+        int                        cellsX,
+        int                        cellsY,
+        double                     metresPerCell,
+        const std::vector<double>& sweepWidths,
+        DetectionModel             detection,
+        double                     trackLength,
+        int                        units,
+        int                        numThreads,
+        SearchPlan&                plan
+        )
+{
+    plan.coverage.assign(grid.size(), 0.0);
+    plan.detection.assign(grid.size(), 0.0);
+    plan.track.assign(grid.size(), 0.0);
+    plan.unit.assign(grid.size(), -1);
+    plan.success       = 0.0;
+    plan.trackLength   = 0.0;
+    plan.cellsSearched = 0;
+
+    double total = 0.0;
+    for(size_t i = 0; i < grid.size(); ++i)
+    {
+        if(grid[i] > 0.0)
+        {
+            total += grid[i];
+        }
+    }
+    if((total <= 0.0) || (trackLength <= 0.0))
+        return;
+
+    const double cellArea = metresPerCell * metresPerCell;
+    std::vector<SearchCell> cells;
+    double highest = -HUGE_VAL;
+    for(size_t i = 0; i < grid.size(); ++i)
+    {
+        double width = sweepWidths[(sweepWidths.size() == 1) ? 0 : i];
+        if((grid[i] <= 0.0) || (width <= 0.0))
+            continue;
+
+        SearchCell cell;
+        cell.idx               = i;
+        cell.probability       = grid[i] / total;
+        cell.metresPerCoverage = cellArea / width;
+        cell.logReturn         = log(cell.probability / cell.metresPerCoverage);
+        cells.push_back(cell);
+        highest = std::max(highest, cell.logReturn);
+    }
+    if(cells.empty())
+        return;
+
+    // At the highest first return no track is needed; step down until there
+    // is more track than there is to fly, then close in.
+    double upper = highest;
+    double lower = highest - 1.0;
+    for(double step = 1.0; effort(cells, lower, detection, numThreads) < trackLength; step *= 2.0)
+    {
+        upper = lower;
+        lower = highest - (2.0 * step);
+    }
+    for(int pass = 0; (pass < 100) && (upper - lower > 1e-12 * std::max(1.0, fabs(lower))); ++pass)
+    {
+        double mid = 0.5 * (upper + lower);
+        if(effort(cells, mid, detection, numThreads) < trackLength)
+        {
+            upper = mid;
+        }
+        else
+        {
+            lower = mid;
+        }
+    }
+
+    // Scale away what's left of the difference, so the units fly exactly
+    // their track.
+    const double scale = trackLength / effort(cells, lower, detection, numThreads);
+    for(size_t i = 0; i < cells.size(); ++i)
+    {
+        double coverage = scale * coverageFor(cells[i].logReturn - lower, detection);
+        if(coverage <= 0.0)
+            continue;
+
+        size_t idx = cells[i].idx;
+        plan.coverage[idx]  = coverage;
+        plan.detection[idx] = detectionFor(coverage, detection);
+        plan.track[idx]     = coverage * cells[i].metresPerCoverage;
+        plan.success       += cells[i].probability * plan.detection[idx];
+        ++plan.cellsSearched;
+    }
+    plan.trackLength = trackLength;
+
+    // Deal the cells out in equal shares of track.
+    const double share = trackLength / std::max(1, units);
+    double flown = 0.0;
+    for(int row = 0; row < cellsY; ++row)
+    {
+        for(int step = 0; step < cellsX; ++step)
+        {
+            int col = ((row % 2) == 0) ? step : cellsX - 1 - step;
+            size_t idx = (row * cellsX) + col;
+            if(plan.coverage[idx] <= 0.0)
+                continue;
+
+            plan.unit[idx] = std::min(units - 1, int((flown + (0.5 * plan.track[idx])) / share));
+            flown += plan.track[idx];
+        }
+    }
+}
+
+void writeSearchCells(KmlFile& kml, const ThreadParams& params, const SearchPlan& plan)
+{
+    if(plan.cellsSearched == 0)
+        return;
+
+    kml.startFolder("Search plan");
+    int idx  = 0;
+    double y = params.gridOrigin.y_;
+    for(int row = 0; row < params.gridCellsY; ++row, y += params.metresPerCell)
+    {
+        double x = params.gridOrigin.x_;
+        for(int col = 0; col < params.gridCellsX; ++col, ++idx, x += params.metresPerCell)
+        {
+            if(plan.coverage[idx] <= 0.0)
+                continue;
+
+            Track3D cell;
+            cell.addPoint(x, y, 0);
+            cell.addPoint(x + params.metresPerCell, y, 0);
+            cell.addPoint(x + params.metresPerCell, y + params.metresPerCell, 0);
+            cell.addPoint(x, y + params.metresPerCell, 0);
+            cell.addPoint(x, y, 0);
+            cell.convertAMG66toWGS84();
+
+            const char* style;
+            int level = int(4.0 * plan.detection[idx]);
+            switch(level)
+            {
+            case 0:
+                style = "cell_25"; break;
+            case 1:
+                style = "cell_50"; break;
+            case 2:
+                style = "cell_75"; break;
+            default:
+                style = "cell_100"; break;
+            }
+
+            std::ostringstream name;
+            name << "Unit " << (plan.unit[idx] + 1) << ", " << int(100.0 * plan.detection[idx]) << "% detection";
+            kml.addPolygon(cell, name.str().c_str(), style, false);
+        }
+    }
+}
+
+void writeSearchPlan(const ThreadParams& params, const SearchPlan& plan, const std::string& path)
+{
+    double total = 0.0;
+    for(size_t i = 0; i < params.grid.size(); ++i)
+    {
+        if(params.grid[i] > 0.0)
+        {
+            total += params.grid[i];
+        }
+    }
+
+    std::ofstream os(path.c_str());
+    os << "Unit,Easting,Northing,Probability (%),Coverage,Track (km),Detection (%)" << std::endl;
+    const int units = plan.unit.empty() ? 0 : *std::max_element(plan.unit.begin(), plan.unit.end()) + 1;
+    for(int unit = 0; unit < units; ++unit)
+    {
+        for(size_t idx = 0; idx < plan.unit.size(); ++idx)
+        {
+            if(plan.unit[idx] != unit)
+                continue;
+
+            int row = int(idx) / params.gridCellsX;
+            int col = int(idx) % params.gridCellsX;
+            os << (unit + 1) << ","
+               << params.gridOrigin.x_ + (col * params.metresPerCell) << ","
+               << params.gridOrigin.y_ + (row * params.metresPerCell) << ","
+               << 100.0 * params.grid[idx] / total << ","
+               << plan.coverage[idx] << ","
+               << plan.track[idx] / 1000.0 << ","
+               << 100.0 * plan.detection[idx] << std::endl;
+        }
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef SEARCHPLAN_H
+#define SEARCHPLAN_H
+
+#include <string>
+#include <vector>
+#include "thread.h"
+class KmlFile;
+
+// How the chance of detecting the wreck in a cell grows with the coverage put
+// into it: the sweep width times the length of track flown in the cell, over
+// the cell's area.
+enum DetectionModel
+{
+    RANDOM_SEARCH_DETECTION, // 1 - exp(-c), Koopman's random search
+    INVERSE_CUBE_DETECTION   // erf(c sqrt(pi) / 2), parallel sweeps by eye
+};
+
+struct SearchSettings
+{
+    int            units;
+    double         hoursPerUnit;
+    double         speed;      // kn
+    double         sweepWidth; // m
+    DetectionModel detection;
+
+    // Total length of track the units can fly, m.
+    double trackLength() const;
+};
+
+// Reads a search specification such as
+// "units=3; hours=4; speed=120; width=1500; detection=inverseCube". All but
+// detection (random or inverseCube, random if left out) must be given.
+// Throws std::runtime_error if the specification can't be understood.
+void parseSearchSettings(const std::string& spec, SearchSettings& settings);
+
+struct SearchPlan
+{
+    std::vector<double> coverage;  // per cell
+    std::vector<double> detection; // probability of detection, per cell
+    std::vector<double> track;     // m, per cell
+    std::vector<int>    unit;      // unit searching each cell, or -1
+    double              success;   // chance of finding the wreck
+    double              trackLength; // m
+    size_t              cellsSearched;
+};
+
+// Shares trackLength metres of search track between the cells of a grid to
+// give the greatest chance of finding the wreck, taking the grid as
+// proportional to the probability of the wreck being in each cell.
+// sweepWidths holds a width (m) for every cell, or one for them all.
+//
+// As detection grows ever more slowly with coverage, the best plan (Charnes
+// and Cooper) gives every searched cell the same return on one more metre of
+// track, and none to the cells that would return less than that even
+// unsearched. That return is found by bisection, each pass over the cells
+// running on numThreads threads. The searched cells are then dealt out to
+// the units in equal lengths of track, in rows alternately east and west.
+void planSearch(
+        const std::vector<double>& grid,
+        int                        cellsX,
+        int                        cellsY,
+        double                     metresPerCell,
+        const std::vector<double>& sweepWidths,
+        DetectionModel             detection,
+        double                     trackLength,
+        int                        units,
+        int                        numThreads,
+        SearchPlan&                plan
+        );
+
+// Adds the searched cells of params' grid to a KML file, shaded by their
+// probability of detection and named for their unit.
+void writeSearchCells(KmlFile& kml, const ThreadParams& params, const SearchPlan& plan);
+
+// Writes the searched cells to a CSV file: unit, position, probability,
+// coverage, track length and probability of detection.
+void writeSearchPlan(const ThreadParams& params, const SearchPlan& plan, const std::string& path);
+
+#endif // SEARCHPLAN_H
@@ -0,0 +1,264 @@
+#include "sensitivity.h"
+
+#include <algorithm>
+#include <fstream>
+#include <random>
+
+#include "util.h"
+#include "point3d.h"
+#include "sampler.h"
+
+namespace
+{
+
+// Number of bootstrap resamples of the chunks behind each interval.
+const int bootstrapResamples = 200;
+
+// Adds the sums of one chunk, weighted by how many times it was drawn.
+void addChunk(SensitivityChunk& sums, const SensitivityChunk& chunk, double weight)
+{
+    sums.samples += weight * chunk.samples;
+    for(int k = 0; k < 2; ++k)
+    {
+        sums.sum[k]   += weight * chunk.sum[k];
+        sums.sumSq[k] += weight * chunk.sumSq[k];
+    }
+    for(size_t j = 0; j < sums.first.size(); ++j)
+    {
+        sums.first[j] += weight * chunk.first[j];
+        sums.total[j] += weight * chunk.total[j];
+    }
+}
+
+// The first order and total indices from the sums, for each input then
+// easting/northing.
+void estimate(const SensitivityChunk& sums, std::vector<double>& first, std::vector<double>& total)
+{
+    const size_t numInputs = sums.first.size() / 2;
+    first.assign(sums.first.size(), 0.0);
+    total.assign(sums.total.size(), 0.0);
+    if(sums.samples < 2)
+        return;
+
+    for(int k = 0; k < 2; ++k)
+    {
+        // A and B are both samples of the output.
+        double mean     = sums.sum[k] / (2 * sums.samples);
+        double variance = (sums.sumSq[k] / (2 * sums.samples)) - (mean * mean);
+        if(variance <= 0.0)
+            continue;
+
+        for(size_t j = 0; j < numInputs; ++j)
+        {
+            size_t idx = (k * numInputs) + j;
+            first[idx] = sums.first[idx] / (sums.samples * variance);
+            total[idx] = sums.total[idx] / (2 * sums.samples * variance);
+        }
+    }
+}
+
+SensitivityChunk emptyChunk(size_t numInputs)
+{
+    SensitivityChunk chunk;
+    chunk.samples = 0.0;
+    for(int k = 0; k < 2; ++k)
+    {
+        chunk.sum[k]   = 0.0;
+        chunk.sumSq[k] = 0.0;
+    }
+    chunk.first.assign(2 * numInputs, 0.0);
+    chunk.total.assign(2 * numInputs, 0.0);
+    return chunk;
+}
+
+} // namespace
+
+void* sensitivityThread(void* params)
+{
+    ThreadParams* tp = reinterpret_cast<ThreadParams*>(params);
+    const size_t numInputs = inputCount(*tp);
+
+    // Work relative to the middle of the grid to keep the sums well
+    // conditioned.
+    const double centreX = tp->gridOrigin.x_ + (0.5 * tp->gridCellsX * tp->metresPerCell);
+    const double centreY = tp->gridOrigin.y_ + (0.5 * tp->gridCellsY * tp->metresPerCell);
+
+    SampleProfiles profiles;
+    std::vector<double> z(2 * numInputs);
+    std::vector<double> mixed(numInputs);
+    std::vector<Point2D> picked(numInputs);
+    std::vector<Point2D> crashes;
+    SensitivityChunk chunk = emptyChunk(numInputs);
+    crashes.reserve(2 * chunkSize);
+    CrashStats stats(tp->stats.centre(), tp->stats.halfWidth());
+
+    auto runChunk = [&](int begin, int end)
+    {
+        ChunkSampler sampler(*tp, begin, end, 2 * numInputs);
+        chunk = emptyChunk(numInputs);
+        crashes.clear();
+        for(int i = begin; i < end; ++i)
+        {
+            sampler.next(z.data());
+            const double* a = z.data();
+            const double* b = a + numInputs;
+
+            Point2D crashA;
+            Point2D crashB;
+            try
+            {
+                crashA = CalcSample(*tp, tp->integrator, a, profiles, tp->timeStep);
+                crashB = CalcSample(*tp, tp->integrator, b, profiles, tp->timeStep);
+                std::copy(a, a + numInputs, mixed.begin());
+                for(size_t j = 0; j < numInputs; ++j)
+                {
+                    mixed[j]  = b[j];
+                    picked[j] = CalcSample(*tp, tp->integrator, mixed.data(), profiles, tp->timeStep);
+                    mixed[j]  = a[j];
+                }
+            }
+            catch(...)
+            {
+                continue;
+            }
+            crashes.push_back(crashA);
+            crashes.push_back(crashB);
+            stats.add(crashA);
+            stats.add(crashB);
+
+            const double fa[2] = { crashA.x_ - centreX, crashA.y_ - centreY };
+            const double fb[2] = { crashB.x_ - centreX, crashB.y_ - centreY };
+            chunk.samples += 1.0;
+            for(int k = 0; k < 2; ++k)
+            {
+                chunk.sum[k]   += fa[k] + fb[k];
+                chunk.sumSq[k] += (fa[k] * fa[k]) + (fb[k] * fb[k]);
+            }
+            for(size_t j = 0; j < numInputs; ++j)
+            {
+                const double fab[2] = { picked[j].x_ - centreX, picked[j].y_ - centreY };
+                for(int k = 0; k < 2; ++k)
+                {
+                    size_t idx = (k * numInputs) + j;
+                    chunk.first[idx] += fb[k] * (fab[k] - fa[k]);
+                    chunk.total[idx] += (fa[k] - fab[k]) * (fa[k] - fab[k]);
+                }
+            }
+        }
+    };
+
+    auto mergeChunk = [&](std::vector<GridChange>& changes)
+    {
+        for(auto i = crashes.begin(); i != crashes.end(); ++i)
+        {
+            int idx = gridIndex(*tp, *i);
+            if(idx >= 0)
+            {
+                tp->grid[idx] += 1.0;
+                changes.push_back(GridChange{ 0, idx, 1.0 });
+            }
+        }
+        if(chunk.samples > 0)
+        {
+            tp->sensitivityChunks.push_back(chunk);
+        }
+    };
+
+    runChunks(*tp, stats, runChunk, mergeChunk);
+    return NULL;
+}
+
+void sobolIndices(const ThreadParams& params, std::vector<SobolIndex>& indices)
+{
+    std::vector<std::string> names;
+    inputNames(params, names);
+    const size_t numInputs = names.size();
+    const std::vector<SensitivityChunk>& chunks = params.sensitivityChunks;
+
+    SensitivityChunk sums = emptyChunk(numInputs);
+    for(auto i = chunks.begin(); i != chunks.end(); ++i)
+    {
+        addChunk(sums, *i, 1.0);
+    }
+    std::vector<double> first;
+    std::vector<double> total;
+    estimate(sums, first, total);
+
+    // Resample the chunks with replacement.
+    std::vector<std::vector<double> > bootFirst(first.size());
+    std::vector<std::vector<double> > bootTotal(total.size());
+    std::mt19937 rng(params.seed);
+    std::uniform_int_distribution<size_t> pick(0, chunks.empty() ? 0 : chunks.size() - 1);
+    std::vector<int> draws(chunks.size());
+    for(int r = 0; (r < bootstrapResamples) && !chunks.empty(); ++r)
+    {
+        std::fill(draws.begin(), draws.end(), 0);
+        for(size_t c = 0; c < chunks.size(); ++c)
+        {
+            ++draws[pick(rng)];
+        }
+        SensitivityChunk resample = emptyChunk(numInputs);
+        for(size_t c = 0; c < chunks.size(); ++c)
+        {
+            if(draws[c] > 0)
+            {
+                addChunk(resample, chunks[c], draws[c]);
+            }
+        }
+
+        std::vector<double> f;
+        std::vector<double> t;
+        estimate(resample, f, t);
+        for(size_t j = 0; j < f.size(); ++j)
+        {
+            bootFirst[j].push_back(f[j]);
+            bootTotal[j].push_back(t[j]);
+        }
+    }
+
+    auto percentile = [](std::vector<double>& values, double p, double fallback) -> double
+    {
+        if(values.empty())
+            return fallback;
+        size_t idx = std::min(values.size() - 1, size_t(p * values.size()));
+        std::nth_element(values.begin(), values.begin() + idx, values.end());
+        return values[idx];
+    };
+
+    indices.resize(numInputs);
+    for(size_t j = 0; j < numInputs; ++j)
+    {
+        SobolIndex& index = indices[j];
+        index.name = names[j];
+        for(int k = 0; k < 2; ++k)
+        {
+            size_t idx = (k * numInputs) + j;
+            index.first[k]     = first[idx];
+            index.firstLow[k]  = percentile(bootFirst[idx], 0.025, first[idx]);
+            index.firstHigh[k] = percentile(bootFirst[idx], 0.975, first[idx]);
+            index.total[k]     = total[idx];
+            index.totalLow[k]  = percentile(bootTotal[idx], 0.025, total[idx]);
+            index.totalHigh[k] = percentile(bootTotal[idx], 0.975, total[idx]);
+        }
+    }
+}
+
+void writeSensitivity(const std::vector<SobolIndex>& indices, const std::string& directory)
+{
+    std::ofstream os((directory + "/sensitivity.csv").c_str());
+    os << "Input,"
+          "First order E,First order E low,First order E high,Total E,Total E low,Total E high,"
+          "First order N,First order N low,First order N high,Total N,Total N low,Total N high" << std::endl;
+    os.setf(std::ios::fixed);
+    os.precision(4);
+    for(auto i = indices.begin(); i != indices.end(); ++i)
+    {
+        os << "\"" << i->name << "\"";
+        for(int k = 0; k < 2; ++k)
+        {
+            os << "," << i->first[k] << "," << i->firstLow[k] << "," << i->firstHigh[k]
+               << "," << i->total[k] << "," << i->totalLow[k] << "," << i->totalHigh[k];
+        }
+        os << std::endl;
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef SENSITIVITY_H
+#define SENSITIVITY_H
+
+#include <string>
+#include <vector>
+#include "thread.h"
+
+// Global sensitivity of the crash position to each input, by the pick-freeze
+// method. Each iteration draws two independent sets of inputs, A and B, and
+// runs A, B, and A with each input in turn taken from B. The first order
+// index of an input (Saltelli 2010) is the fraction of the variance of the
+// crash easting or northing that the input explains by itself; the total
+// index (Jansen 1999) also counts its interactions with the other inputs.
+// Intervals come from bootstrapping the chunks of the run.
+struct SobolIndex
+{
+    std::string name;
+    double first[2];     // easting, northing
+    double firstLow[2];  // 95% interval
+    double firstHigh[2];
+    double total[2];
+    double totalLow[2];
+    double totalHigh[2];
+};
+
+// Worker for a sensitivity run (see ThreadParams::sensitivity). Claims chunks
+// of iterations through runChunks(). A and B are binned into the grid. An
+// iteration with a failed track is dropped.
+void* sensitivityThread(void* params);
+
+// Estimates the indices of each input from the chunks completed so far.
+void sobolIndices(const ThreadParams& params, std::vector<SobolIndex>& indices);
+
+// Writes the indices to sensitivity.csv in the given directory.
+void writeSensitivity(const std::vector<SobolIndex>& indices, const std::string& directory);
+
+#endif // SENSITIVITY_H
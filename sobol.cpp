@@ -0,0 +1,218 @@
+#include "sobol.h"
+
+#include <cassert>
+#include <random>
+
+namespace
+{
+
+struct DirectionInit
+{
+    int      degree;
+    unsigned polynomial; // including the leading and constant terms
+    unsigned m[9];       // initial direction numbers
+};
+
+// Primitive polynomials and initial direction numbers for dimensions 2 to 64,
+// from S. Joe and F. Y. Kuo, "Constructing Sobol sequences with better
+// two-dimensional projections", SIAM J. Sci. Comput. 30 (2008), file
+// new-joe-kuo-6.21201. The first dimension is the van der Corput sequence.
+const DirectionInit directionInit[SobolSequence::maxDimensions - 1] =
+{
+    { 1,    3, { 1 } },
+    { 2,    7, { 1, 3 } },
+    { 3,   11, { 1, 3, 1 } },
+    { 3,   13, { 1, 1, 1 } },
+    { 4,   19, { 1, 1, 3, 3 } },
+    { 4,   25, { 1, 3, 5, 13 } },
+    { 5,   37, { 1, 1, 5, 5, 17 } },
+    { 5,   41, { 1, 1, 5, 5, 5 } },
+    { 5,   47, { 1, 1, 7, 11, 19 } },
+    { 5,   55, { 1, 1, 5, 1, 1 } },
+    { 5,   59, { 1, 1, 1, 3, 11 } },
+    { 5,   61, { 1, 3, 5, 5, 31 } },
+    { 6,   67, { 1, 3, 3, 9, 7, 49 } },
+    { 6,   91, { 1, 1, 1, 15, 21, 21 } },
+    { 6,   97, { 1, 3, 1, 13, 27, 49 } },
+    { 6,  103, { 1, 1, 1, 15, 7, 5 } },
+    { 6,  109, { 1, 3, 1, 15, 13, 25 } },
+    { 6,  115, { 1, 1, 5, 5, 19, 61 } },
+    { 7,  131, { 1, 3, 7, 11, 23, 15, 103 } },
+    { 7,  137, { 1, 3, 7, 13, 13, 15, 69 } },
+    { 7,  143, { 1, 1, 3, 13, 7, 35, 63 } },
+    { 7,  145, { 1, 3, 5, 9, 1, 25, 53 } },
+    { 7,  157, { 1, 3, 1, 13, 9, 35, 107 } },
+    { 7,  167, { 1, 3, 1, 5, 27, 61, 31 } },
+    { 7,  171, { 1, 1, 5, 11, 19, 41, 61 } },
+    { 7,  185, { 1, 3, 5, 3, 3, 13, 69 } },
+    { 7,  191, { 1, 1, 7, 13, 1, 19, 1 } },
+    { 7,  193, { 1, 3, 7, 5, 13, 19, 59 } },
+    { 7,  203, { 1, 1, 3, 9, 25, 29, 41 } },
+    { 7,  211, { 1, 3, 5, 13, 23, 1, 55 } },
+    { 7,  213, { 1, 3, 7, 3, 13, 59, 17 } },
+    { 7,  229, { 1, 3, 1, 3, 5, 53, 69 } },
+    { 7,  239, { 1, 1, 5, 5, 23, 33, 13 } },
+    { 7,  241, { 1, 1, 7, 7, 1, 61, 123 } },
+    { 7,  247, { 1, 1, 7, 9, 13, 61, 49 } },
+    { 7,  253, { 1, 3, 3, 5, 3, 55, 33 } },
+    { 8,  285, { 1, 3, 1, 15, 31, 13, 49, 245 } },
+    { 8,  299, { 1, 3, 5, 15, 31, 59, 63, 97 } },
+    { 8,  301, { 1, 3, 1, 11, 11, 11, 77, 249 } },
+    { 8,  333, { 1, 3, 1, 11, 27, 43, 71, 9 } },
+    { 8,  351, { 1, 1, 7, 15, 21, 11, 81, 45 } },
+    { 8,  355, { 1, 3, 7, 3, 25, 31, 65, 79 } },
+    { 8,  357, { 1, 3, 1, 1, 19, 11, 3, 205 } },
+    { 8,  361, { 1, 1, 5, 9, 19, 21, 29, 157 } },
+    { 8,  369, { 1, 3, 7, 11, 1, 33, 89, 185 } },
+    { 8,  391, { 1, 3, 3, 3, 15, 9, 79, 71 } },
+    { 8,  397, { 1, 3, 7, 11, 15, 39, 119, 27 } },
+    { 8,  425, { 1, 1, 3, 1, 11, 31, 97, 225 } },
+    { 8,  451, { 1, 1, 1, 3, 23, 43, 57, 177 } },
+    { 8,  463, { 1, 3, 7, 7, 17, 17, 37, 71 } },
+    { 8,  487, { 1, 3, 1, 5, 27, 63, 123, 213 } },
+    { 8,  501, { 1, 1, 3, 5, 11, 43, 53, 133 } },
+    { 9,  529, { 1, 3, 5, 5, 29, 17, 47, 173, 479 } },
+    { 9,  539, { 1, 3, 3, 11, 3, 1, 109, 9, 69 } },
+    { 9,  545, { 1, 1, 1, 5, 17, 39, 23, 5, 343 } },
+    { 9,  557, { 1, 3, 1, 5, 25, 15, 31, 103, 499 } },
+    { 9,  563, { 1, 1, 1, 11, 11, 17, 63, 105, 183 } },
+    { 9,  601, { 1, 1, 5, 11, 9, 29, 97, 231, 363 } },
+    { 9,  607, { 1, 1, 5, 15, 19, 45, 41, 7, 383 } },
+    { 9,  617, { 1, 3, 7, 7, 31, 19, 83, 137, 221 } },
+    { 9,  623, { 1, 1, 1, 3, 23, 15, 111, 223, 83 } },
+    { 9,  631, { 1, 1, 5, 13, 31, 15, 55, 25, 161 } },
+    { 9,  637, { 1, 1, 3, 13, 25, 47, 39, 87, 257 } },
+};
+
+// Parity of the number of set bits.
+unsigned parity(unsigned x)
+{
+    x ^= x >> 16;
+    x ^= x >> 8;
+    x ^= x >> 4;
+    x ^= x >> 2;
+    x ^= x >> 1;
+    return x & 1;
+}
+
+} // namespace
+
+const size_t SobolSequence::maxDimensions;
+
+SobolSequence::SobolSequence() : dimensions_(0)
+{
+}
+
+void SobolSequence::init(size_t dimensions, unsigned seed)
+{
+    assert(dimensions <= maxDimensions);
+    dimensions_ = dimensions;
+    directions_.assign(dimensions * bits, 0);
+    shift_.assign(dimensions, 0);
+
+    for(size_t d = 0; d < dimensions; ++d)
+    {
+        unsigned* v = &directions_[d * bits];
+        if(d == 0)
+        {
+            for(int k = 0; k < bits; ++k)
+            {
+                v[k] = 1u << (bits - 1 - k);
+            }
+        }
+        else
+        {
+            const DirectionInit& init = directionInit[d - 1];
+            const int s = init.degree;
+            for(int k = 0; k < s; ++k)
+            {
+                v[k] = init.m[k] << (bits - 1 - k);
+            }
+            for(int k = s; k < bits; ++k)
+            {
+                v[k] = v[k - s] ^ (v[k - s] >> s);
+                for(int i = 1; i < s; ++i)
+                {
+                    if((init.polynomial >> (s - i)) & 1)
+                    {
+                        v[k] ^= v[k - i];
+                    }
+                }
+            }
+        }
+    }
+
+    if(seed == 0)
+        return;
+
+    // Scramble each dimension's direction numbers by a random lower
+    // triangular binary matrix with a unit diagonal, then pick a random
+    // digital shift.
+    std::mt19937 rng(seed);
+    for(size_t d = 0; d < dimensions; ++d)
+    {
+        // Row r of the matrix as a mask of the digits (most significant
+        // first) that contribute to digit r of the result.
+        unsigned rows[bits];
+        for(int r = 0; r < bits; ++r)
+        {
+            unsigned below = (r == 0) ? 0u : (rng() & ~((1u << (bits - r)) - 1));
+            rows[r] = below | (1u << (bits - 1 - r));
+        }
+
+        unsigned* v = &directions_[d * bits];
+        for(int k = 0; k < bits; ++k)
+        {
+            unsigned scrambled = 0;
+            for(int r = 0; r < bits; ++r)
+            {
+                scrambled |= parity(rows[r] & v[k]) << (bits - 1 - r);
+            }
+            v[k] = scrambled;
+        }
+        shift_[d] = rng();
+    }
+}
+
+SobolGenerator::SobolGenerator(const SobolSequence& seq, unsigned start) :
+    seq_(seq), index_(start), state_(seq.dimensions_)
+{
+    // Skip ahead: point n of the Gray code ordering is the XOR of the
+    // direction numbers selected by the bits of n ^ (n >> 1).
+    const unsigned gray = start ^ (start >> 1);
+    for(size_t d = 0; d < seq_.dimensions_; ++d)
+    {
+        const unsigned* v = &seq_.directions_[d * SobolSequence::bits];
+        unsigned x = seq_.shift_[d];
+        for(int k = 0; k < SobolSequence::bits; ++k)
+        {
+            if((gray >> k) & 1)
+            {
+                x ^= v[k];
+            }
+        }
+        state_[d] = x;
+    }
+}
+
+void SobolGenerator::next(double* u)
+{
+    for(size_t d = 0; d < state_.size(); ++d)
+    {
+        // Centre each point in its cell so neither 0 nor 1 is returned.
+        u[d] = (state_[d] + 0.5) * (1.0 / 4294967296.0);
+    }
+
+    // Moving to the next point in Gray code order flips one bit: the lowest
+    // zero bit of the current index.
+    int k = 0;
+    for(unsigned i = index_; i & 1; i >>= 1)
+    {
+        ++k;
+    }
+    for(size_t d = 0; d < state_.size(); ++d)
+    {
+        state_[d] ^= seq_.directions_[d * SobolSequence::bits + k];
+    }
+    ++index_;
+}
@@ -0,0 +1,52 @@
+#ifndef SOBOL_H
+#define SOBOL_H
+
+#include <cstddef>
+#include <vector>
+
+// Direction numbers for a Sobol low-discrepancy sequence. The sequence can
+// optionally be scrambled (random linear matrix scrambling plus a random
+// digital shift), which keeps its low discrepancy but makes each run an
+// independent randomisation.
+class SobolSequence
+{
+public:
+    // Largest number of dimensions supported by the direction number table.
+    static const size_t maxDimensions = 64;
+
+    SobolSequence();
+
+    // Sets up the sequence for the given number of dimensions (at most
+    // maxDimensions). The sequence is scrambled if seed is non-zero.
+    void init(size_t dimensions, unsigned seed);
+
+    size_t dimensions() const { return dimensions_; }
+
+protected:
+    friend class SobolGenerator;
+
+    static const int bits = 32;
+
+    size_t                dimensions_;
+    std::vector<unsigned> directions_; // bits per dimension
+    std::vector<unsigned> shift_;      // one per dimension
+};
+
+// Generates consecutive points of a Sobol sequence, in Gray code order,
+// starting from any index. Generators starting at different indices can be
+// used by different threads to share out a sequence.
+class SobolGenerator
+{
+public:
+    SobolGenerator(const SobolSequence& seq, unsigned start);
+
+    // Writes the next point, with each coordinate in the open interval (0,1).
+    void next(double* u);
+
+protected:
+    const SobolSequence&  seq_;
+    unsigned              index_;
+    std::vector<unsigned> state_;
+};
+
+#endif // SOBOL_H
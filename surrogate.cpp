@@ -0,0 +1,431 @@
+#include "surrogate.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+
+#include "util.h"
+#include "point3d.h"
+#include "sampler.h"
+
+namespace
+{
+
+// Highest total degree of the expansion.
+const int maxDegree = 3;
+
+// Tracks checked against the surrogate per track fitted.
+const double checkFraction = 0.2;
+
+// Tracks needed per term of the expansion.
+const int tracksPerTerm = 2;
+
+// Largest fraction of the check tracks the surrogate may put in a different
+// grid cell to the real track.
+const double maxCellChanges = 0.05;
+
+// Writes the normalised Hermite polynomials of orders 0 to 3 at z.
+inline void hermite(double z, double* h)
+{
+    h[0] = 1.0;
+    h[1] = z;
+    h[2] = ((z * z) - 1.0) * 0.70710678118654752;       // 1/sqrt(2)
+    h[3] = ((z * z * z) - (3.0 * z)) * 0.40824829046386302; // 1/sqrt(6)
+}
+
+struct TrackJob
+{
+    const ThreadParams*   params;
+    const double*         z;
+    size_t                dimensions;
+    int                   begin;
+    int                   end;
+    std::vector<Point2D>* positions;
+    std::vector<char>*    succeeded;
+};
+
+void* trackThread(void* params)
+{
+    TrackJob* job = reinterpret_cast<TrackJob*>(params);
+    SampleProfiles profiles;
+    for(int i = job->begin; i < job->end; ++i)
+    {
+        try
+        {
+            (*job->positions)[i] = CalcSample(*job->params, job->params->integrator, job->z + (i * job->dimensions), profiles, job->params->timeStep);
+            (*job->succeeded)[i] = 1;
+        }
+        catch(...)
+        {
+            (*job->succeeded)[i] = 0;
+        }
+    }
+    return NULL;
+}
+
+// Solves a * x = b for each of the right hand sides, where a is n x n
+// symmetric positive definite (only the upper triangle is used and it is
+// overwritten with the Cholesky factor).
+void choleskySolve(std::vector<double>& a, size_t n, std::vector<double>* rhs[], int numRhs)
+{
+    for(size_t j = 0; j < n; ++j)
+    {
+        for(size_t k = 0; k < j; ++k)
+        {
+            double s = a[(k * n) + j];
+            for(size_t i = j; i < n; ++i)
+            {
+                a[(j * n) + i] -= s * a[(k * n) + i];
+            }
+        }
+        double pivot = a[(j * n) + j];
+        if(pivot <= 0.0)
+            throw std::runtime_error("The surrogate fit is singular");
+        double scale = 1.0 / sqrt(pivot);
+        for(size_t i = j; i < n; ++i)
+        {
+            a[(j * n) + i] *= scale;
+        }
+    }
+
+    // a now holds R with R' R = a, row by row.
+    for(int r = 0; r < numRhs; ++r)
+    {
+        std::vector<double>& x = *rhs[r];
+        for(size_t i = 0; i < n; ++i)
+        {
+            for(size_t k = 0; k < i; ++k)
+            {
+                x[i] -= a[(k * n) + i] * x[k];
+            }
+            x[i] /= a[(i * n) + i];
+        }
+        for(size_t i = n; i-- > 0; )
+        {
+            for(size_t k = i + 1; k < n; ++k)
+            {
+                x[i] -= a[(i * n) + k] * x[k];
+            }
+            x[i] /= a[(i * n) + i];
+        }
+    }
+}
+
+} // namespace
+
+Surrogate::Surrogate() :
+    dimensions_(0),
+    degree_(0),
+    successFraction_(0.0)
+{
+    check_.samples     = 0;
+    check_.rmsError    = 0.0;
+    check_.error99     = 0.0;
+    check_.maxError    = 0.0;
+    check_.cellChanges = 0.0;
+}
+
+void Surrogate::build(const ThreadParams& params, int trainingTracks, int numThreads)
+{
+    dimensions_ = inputCount(params);
+    const int checkTracks = std::max(1, int(trainingTracks * checkFraction));
+    const int numTracks   = trainingTracks + checkTracks;
+
+    // Random inputs, as the run itself would draw them.
+    std::mt19937 rng(params.seed ^ 0x5a17u);
+    std::normal_distribution<> norm;
+    std::vector<double> z(numTracks * dimensions_);
+    for(size_t i = 0; i < z.size(); ++i)
+    {
+        z[i] = norm(rng);
+    }
+
+    std::vector<Point2D> positions(numTracks);
+    std::vector<char> succeeded(numTracks);
+    std::vector<TrackJob> jobs(numThreads);
+    std::vector<pthread_t> ids(numThreads);
+    for(int i = 0; i < numThreads; ++i)
+    {
+        jobs[i].params     = &params;
+        jobs[i].z          = z.data();
+        jobs[i].dimensions = dimensions_;
+        jobs[i].begin      = (numTracks * i) / numThreads;
+        jobs[i].end        = (numTracks * (i + 1)) / numThreads;
+        jobs[i].positions  = &positions;
+        jobs[i].succeeded  = &succeeded;
+        pthread_create(&ids[i], NULL, trackThread, &jobs[i]);
+    }
+    for(int i = 0; i < numThreads; ++i)
+    {
+        pthread_join(ids[i], NULL);
+    }
+
+    int fitted = 0;
+    int failed = 0;
+    for(int i = 0; i < numTracks; ++i)
+    {
+        if(succeeded[i])
+        {
+            fitted += (i < trainingTracks) ? 1 : 0;
+        }
+        else
+        {
+            ++failed;
+        }
+    }
+    successFraction_ = double(numTracks - failed) / numTracks;
+    if(successFraction_ <= 0.0)
+        throw std::runtime_error("All the surrogate fitting tracks failed");
+
+    // Choose the degree and list the terms: the constant, then the powers
+    // of each input, then the products of two inputs.
+    for(degree_ = maxDegree; degree_ > 0; --degree_)
+    {
+        terms_.clear();
+        Term constant = { -1, 0, -1, 0 };
+        terms_.push_back(constant);
+        for(int d = 1; d <= degree_; ++d)
+        {
+            for(int i = 0; i < int(dimensions_); ++i)
+            {
+                Term term = { i, d, -1, 0 };
+                terms_.push_back(term);
+            }
+        }
+        for(int i = 0; i < int(dimensions_); ++i)
+        {
+            for(int j = i + 1; j < int(dimensions_); ++j)
+            {
+                for(int a = 1; a < degree_; ++a)
+                {
+                    for(int b = 1; a + b <= degree_; ++b)
+                    {
+                        Term term = { i, a, j, b };
+                        terms_.push_back(term);
+                    }
+                }
+            }
+        }
+        if(int(terms_.size()) * tracksPerTerm <= fitted)
+            break;
+    }
+    if(degree_ == 0)
+        throw std::runtime_error("Too few tracks to fit a surrogate");
+
+    // Least squares by the normal equations, relative to the mean position
+    // to keep them well conditioned.
+    const size_t numTerms = terms_.size();
+    double refX = 0.0;
+    double refY = 0.0;
+    for(int i = 0; i < trainingTracks; ++i)
+    {
+        if(succeeded[i])
+        {
+            refX += positions[i].x_ / fitted;
+            refY += positions[i].y_ / fitted;
+        }
+    }
+    std::vector<double> normal(numTerms * numTerms, 0.0);
+    coeffX_.assign(numTerms, 0.0);
+    coeffY_.assign(numTerms, 0.0);
+    std::vector<double> row(numTerms);
+    std::vector<double> h(dimensions_ * 4);
+    for(int i = 0; i < trainingTracks; ++i)
+    {
+        if(!succeeded[i])
+            continue;
+
+        for(size_t d = 0; d < dimensions_; ++d)
+        {
+            hermite(z[(i * dimensions_) + d], &h[d * 4]);
+        }
+        for(size_t t = 0; t < numTerms; ++t)
+        {
+            const Term& term = terms_[t];
+            row[t] = (term.first < 0) ? 1.0 : h[(term.first * 4) + term.order1];
+            if(term.second >= 0)
+            {
+                row[t] *= h[(term.second * 4) + term.order2];
+            }
+        }
+        double dx = positions[i].x_ - refX;
+        double dy = positions[i].y_ - refY;
+        for(size_t r = 0; r < numTerms; ++r)
+        {
+            double* out = &normal[r * numTerms];
+            const double v = row[r];
+            for(size_t c = r; c < numTerms; ++c)
+            {
+                out[c] += v * row[c];
+            }
+            coeffX_[r] += v * dx;
+            coeffY_[r] += v * dy;
+        }
+    }
+
+    // A touch of ridge regularisation guards against inputs that don't
+    // vary.
+    double maxDiagonal = 0.0;
+    for(size_t t = 0; t < numTerms; ++t)
+    {
+        maxDiagonal = std::max(maxDiagonal, normal[(t * numTerms) + t]);
+    }
+    for(size_t t = 0; t < numTerms; ++t)
+    {
+        normal[(t * numTerms) + t] += 1e-9 * maxDiagonal;
+    }
+    std::vector<double>* rhs[] = { &coeffX_, &coeffY_ };
+    choleskySolve(normal, numTerms, rhs, 2);
+    coeffX_[0] += refX;
+    coeffY_[0] += refY;
+
+    // Check against the tracks that weren't fitted.
+    std::vector<double> x(checkTracks);
+    std::vector<double> y(checkTracks);
+    std::vector<double> scratch;
+    evaluate(&z[trainingTracks * dimensions_], checkTracks, x.data(), y.data(), scratch);
+    std::vector<double> errors;
+    int cellChanges = 0;
+    double sumSq = 0.0;
+    for(int i = 0; i < checkTracks; ++i)
+    {
+        if(!succeeded[trainingTracks + i])
+            continue;
+
+        const Point2D& actual = positions[trainingTracks + i];
+        Point2D estimate(x[i], y[i]);
+        double dx = estimate.x_ - actual.x_;
+        double dy = estimate.y_ - actual.y_;
+        errors.push_back(sqrt((dx * dx) + (dy * dy)));
+        sumSq += (dx * dx) + (dy * dy);
+        if(gridIndex(params, estimate) != gridIndex(params, actual))
+        {
+            ++cellChanges;
+        }
+    }
+    check_.samples = errors.size();
+    if(!errors.empty())
+    {
+        std::sort(errors.begin(), errors.end());
+        check_.rmsError    = sqrt(sumSq / errors.size());
+        check_.error99     = errors[std::min(errors.size() - 1, size_t(0.99 * errors.size()))];
+        check_.maxError    = errors.back();
+        check_.cellChanges = double(cellChanges) / errors.size();
+    }
+}
+
+bool Surrogate::acceptable() const
+{
+    return (check_.samples > 0) && (check_.cellChanges <= maxCellChanges);
+}
+
+void Surrogate::evaluate(const double* z, int count, double* x, double* y, std::vector<double>& scratch) const
+{
+    // The polynomials of each input and order for all the samples, so
+    // h[((input * 4) + order) * count + sample].
+    scratch.resize(dimensions_ * 4 * count);
+    double* h = scratch.data();
+    double values[4];
+    for(int s = 0; s < count; ++s)
+    {
+        for(size_t d = 0; d < dimensions_; ++d)
+        {
+            hermite(z[(s * dimensions_) + d], values);
+            for(int a = 0; a < 4; ++a)
+            {
+                h[(((d * 4) + a) * count) + s] = values[a];
+            }
+        }
+    }
+
+    std::fill(x, x + count, coeffX_[0]);
+    std::fill(y, y + count, coeffY_[0]);
+    for(size_t t = 1; t < terms_.size(); ++t)
+    {
+        const Term& term = terms_[t];
+        const double cx  = coeffX_[t];
+        const double cy  = coeffY_[t];
+        const double* p  = h + (((term.first * 4) + term.order1) * count);
+        if(term.second < 0)
+        {
+            for(int s = 0; s < count; ++s)
+            {
+                x[s] += cx * p[s];
+                y[s] += cy * p[s];
+            }
+        }
+        else
+        {
+            const double* q = h + (((term.second * 4) + term.order2) * count);
+            for(int s = 0; s < count; ++s)
+            {
+                double v = p[s] * q[s];
+                x[s] += cx * v;
+                y[s] += cy * v;
+            }
+        }
+    }
+}
+
+void* surrogateThread(void* params)
+{
+    ThreadParams* tp = reinterpret_cast<ThreadParams*>(params);
+
+    const Surrogate& surrogate = *tp->surrogate;
+    const size_t dims = surrogate.dimensions();
+    std::vector<double> z(chunkSize * dims);
+    std::vector<double> x(chunkSize);
+    std::vector<double> y(chunkSize);
+    std::vector<double> scratch;
+    CrashStats stats(tp->stats.centre(), tp->stats.halfWidth());
+
+    int count = 0;
+    auto runChunk = [&](int begin, int end)
+    {
+        ChunkSampler sampler(*tp, begin, end, dims);
+        count = end - begin;
+        for(int i = 0; i < count; ++i)
+        {
+            sampler.next(&z[i * dims]);
+        }
+        surrogate.evaluate(z.data(), count, x.data(), y.data(), scratch);
+        for(int i = 0; i < count; ++i)
+        {
+            stats.add(Point2D(x[i], y[i]), surrogate.successFraction());
+        }
+    };
+
+    auto mergeChunk = [&](std::vector<GridChange>& changes)
+    {
+        const double weight = surrogate.successFraction();
+        double sumX = 0.0;
+        double sumY = 0.0;
+        for(int i = 0; i < count; ++i)
+        {
+            int idx = gridIndex(*tp, Point2D(x[i], y[i]));
+            if(idx >= 0)
+            {
+                tp->grid[idx] += weight;
+                changes.push_back(GridChange{ 0, idx, weight });
+            }
+
+            double dx = x[i] - tp->gridOrigin.x_;
+            double dy = y[i] - tp->gridOrigin.y_;
+            sumX += dx;
+            sumY += dy;
+            tp->moments.sumSqX += dx * dx;
+            tp->moments.sumSqY += dy * dy;
+        }
+        ChunkMoments& m = tp->moments;
+        m.samples  += count;
+        m.sumX     += sumX;
+        m.sumY     += sumY;
+        m.chunkSqX += (sumX * sumX) / count;
+        m.chunkSqY += (sumY * sumY) / count;
+        ++m.chunks;
+    };
+
+    runChunks(*tp, stats, runChunk, mergeChunk);
+    return NULL;
+}
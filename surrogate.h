@@ -0,0 +1,83 @@
+#ifndef SURROGATE_H
+#define SURROGATE_H
+
+#include <vector>
+#include "thread.h"
+
+// How well a surrogate matched real tracks it wasn't fitted to.
+struct SurrogateCheck
+{
+    int    samples;
+    double rmsError;    // m
+    double error99;     // m, 99th percentile
+    double maxError;    // m
+    double cellChanges; // fraction landing in a different grid cell
+};
+
+// A polynomial chaos expansion of the crash position in the standard normal
+// inputs of a run (see inputDistributions()): a sum of products of
+// normalised probabilists' Hermite polynomials, of total degree up to three
+// and involving at most two inputs each, fitted by least squares to the
+// crash positions of random tracks. Evaluating it costs a few hundred
+// multiply-adds per sample, so a run can use far more samples than it could
+// tracks.
+class Surrogate
+{
+public:
+    Surrogate();
+
+    // Fits the expansion to trainingTracks tracks of params' own data set,
+    // run on numThreads threads, using the highest degree that has at least
+    // two tracks per term. A fifth as many more tracks check the fit
+    // against the grid of params, so set that up first. Throws
+    // std::runtime_error if there are too few tracks.
+    void build(const ThreadParams& params, int trainingTracks, int numThreads);
+
+    size_t dimensions() const { return dimensions_; }
+    size_t terms() const { return terms_.size(); }
+    int degree() const { return degree_; }
+
+    // The fraction of the fitting and checking tracks that didn't fail. The
+    // surrogate always gives a position, so each sample counts as this much
+    // of a track in the grid; the rest is the chance of a failed track. Never
+    // zero, as build() throws if every track fails.
+    double successFraction() const { return successFraction_; }
+
+    const SurrogateCheck& check() const { return check_; }
+
+    // Whether the check tracks mostly land in the same grid cells as the
+    // surrogate puts them.
+    bool acceptable() const;
+
+    // The crash positions of count samples, z holding dimensions()
+    // deviates for each in turn. Works through the samples a term at a time
+    // so that the inner loops vectorise. scratch is resized as needed.
+    void evaluate(const double* z, int count, double* x, double* y, std::vector<double>& scratch) const;
+
+private:
+    // A term is hermite(first, order1) * hermite(second, order2); second is
+    // -1 for terms in one input.
+    struct Term
+    {
+        int first;
+        int order1;
+        int second;
+        int order2;
+    };
+
+    size_t            dimensions_;
+    int               degree_;
+    std::vector<Term> terms_;
+    std::vector<double> coeffX_;
+    std::vector<double> coeffY_;
+    double            successFraction_;
+    SurrogateCheck    check_;
+};
+
+// Worker for a surrogate run (see ThreadParams::surrogate). Claims chunks of
+// samples through runChunks() and bins the surrogate's crash positions into
+// the grid. The positions aren't stored, so the run can't be regridded or
+// reweighted.
+void* surrogateThread(void* params);
+
+#endif // SURROGATE_H
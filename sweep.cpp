@@ -0,0 +1,270 @@
+#include "sweep.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "units.h"
+#include "util.h"
+#include "point3d.h"
+#include "sampler.h"
+#include "containment.h"
+
+namespace
+{
+
+// Largest number of variants a sweep may expand to.
+const size_t maxVariants = 1000;
+
+struct SweepAxis
+{
+    std::string         name;
+    std::vector<double> values;
+};
+
+Distribution offsetMean(const Distribution& dist, double offset)
+{
+    return Distribution(dist.mean() + offset, dist.stdDev());
+}
+
+// Applies one swept value to a variant.
+void applySetting(SweepVariant& variant, const std::string& name, double value)
+{
+    Scenario& s = variant.scenario;
+    if(name == "timeStep")
+    {
+        if(value <= 0.0)
+            throw std::runtime_error("The swept time steps must be positive");
+        variant.timeStep = value;
+    }
+    else if(name == "fixRange")
+    {
+        s.fixRange = offsetMean(s.fixRange, NMToMetres(value));
+    }
+    else if(name == "fixBearing")
+    {
+        s.fixBearing = offsetMean(s.fixBearing, DEG2RAD(value));
+    }
+    else if(name == "heading")
+    {
+        s.aircraftHeading = offsetMean(s.aircraftHeading, DEG2RAD(value));
+    }
+    else if(name == "windDirection")
+    {
+        s.windDirection = offsetMean(s.windDirection, DEG2RAD(value));
+    }
+    else if(name == "bankRate")
+    {
+        s.initialBankRate = offsetMean(s.initialBankRate, DEG2RAD(value));
+    }
+    else if(name == "bankAccel")
+    {
+        s.bankRateAccel = offsetMean(s.bankRateAccel, DEG2RAD(value));
+    }
+    else if(name == "windSpeed")
+    {
+        DistributionSet wind;
+        for(size_t i = 0; i < s.windProfile.size(); ++i)
+        {
+            wind.addPoint(s.windProfile.x(i), s.windProfile[i].mean() + KnotsToMPS(value), s.windProfile[i].stdDev());
+        }
+        wind.setCorrelationLength(s.windProfile.correlationLength());
+        s.windProfile = wind;
+    }
+    else
+    {
+        throw std::runtime_error("Can't sweep '" + name + "'");
+    }
+}
+
+} // namespace
+
+void expandSweep(const ThreadParams& params, const std::string& spec, std::vector<SweepVariant>& variants)
+{
+    std::vector<SweepAxis> axes;
+    std::vector<std::string> parts = split(spec, ';');
+    size_t numVariants = 1;
+    for(size_t i = 0; i < parts.size(); ++i)
+    {
+        size_t eq = parts[i].find('=');
+        if(eq == std::string::npos)
+            throw std::runtime_error("Expected 'setting=value,value,...' but found '" + parts[i] + "'");
+
+        SweepAxis axis;
+        axis.name = trim(parts[i].substr(0, eq));
+        std::vector<std::string> values = split(parts[i].substr(eq + 1), ',');
+        for(size_t j = 0; j < values.size(); ++j)
+        {
+            char* end;
+            double value = strtod(values[j].c_str(), &end);
+            if(*end != '\0')
+                throw std::runtime_error("'" + values[j] + "' is not a number");
+            axis.values.push_back(value);
+        }
+        if(axis.values.empty())
+            throw std::runtime_error("No values given for '" + axis.name + "'");
+
+        numVariants *= axis.values.size();
+        if(numVariants > maxVariants)
+            throw std::runtime_error("The sweep has too many variants");
+        axes.push_back(axis);
+    }
+    if(axes.empty())
+        throw std::runtime_error("There is nothing to sweep");
+
+    // The last setting varies fastest.
+    variants.assign(numVariants, SweepVariant());
+    for(size_t v = 0; v < numVariants; ++v)
+    {
+        SweepVariant& variant = variants[v];
+        variant.scenario = params;
+        variant.timeStep = params.timeStep;
+        variant.grid.assign(params.gridCellsX * params.gridCellsY, 0.0);
+        variant.moments  = SweepMoments();
+
+        std::ostringstream name;
+        size_t stride = numVariants;
+        for(size_t a = 0; a < axes.size(); ++a)
+        {
+            stride /= axes[a].values.size();
+            double value = axes[a].values[(v / stride) % axes[a].values.size()];
+            applySetting(variant, axes[a].name, value);
+            name << ((a == 0) ? "" : " ") << axes[a].name << "=" << value;
+        }
+        variant.name = name.str();
+    }
+}
+
+void* sweepThread(void* params)
+{
+    ThreadParams* tp = reinterpret_cast<ThreadParams*>(params);
+    const size_t numVariants = tp->sweepVariants.size();
+
+    SampleProfiles profiles;
+    std::vector<double> z(runInputCount(*tp));
+    std::vector<Point2D> sample(numVariants);
+    std::vector<Point2D> crashes; // numVariants per sample
+    crashes.reserve(chunkSize * numVariants);
+    CrashStats stats(tp->stats.centre(), tp->stats.halfWidth()); // first variant
+
+    auto runChunk = [&](int begin, int end)
+    {
+        // Every variant sees the same inputs.
+        ChunkSampler sampler(*tp, begin, end);
+        crashes.clear();
+        for(int i = begin; i < end; ++i)
+        {
+            sampler.next(z.data());
+            try
+            {
+                for(size_t v = 0; v < numVariants; ++v)
+                {
+                    const SweepVariant& variant = tp->sweepVariants[v];
+                    sample[v] = CalcSample(variant.scenario, tp->integrator, z.data(), profiles, variant.timeStep);
+                }
+            }
+            catch(...)
+            {
+                continue;
+            }
+            crashes.insert(crashes.end(), sample.begin(), sample.end());
+            stats.add(sample[0]);
+        }
+    };
+
+    auto mergeChunk = [&](std::vector<GridChange>& changes)
+    {
+        for(size_t i = 0; i < crashes.size(); i += numVariants)
+        {
+            double baseX = crashes[i].x_ - tp->gridOrigin.x_;
+            double baseY = crashes[i].y_ - tp->gridOrigin.y_;
+            for(size_t v = 0; v < numVariants; ++v)
+            {
+                const Point2D& pos    = crashes[i + v];
+                SweepVariant& variant = tp->sweepVariants[v];
+                int idx = gridIndex(*tp, pos);
+                if(idx >= 0)
+                {
+                    variant.grid[idx] += 1.0;
+                    if(v == 0)
+                    {
+                        tp->grid[idx] += 1.0;
+                        changes.push_back(GridChange{ 0, idx, 1.0 });
+                    }
+                }
+
+                double x = pos.x_ - tp->gridOrigin.x_;
+                double y = pos.y_ - tp->gridOrigin.y_;
+                SweepMoments& m = variant.moments;
+                m.samples += 1.0;
+                m.sumX    += x;
+                m.sumY    += y;
+                m.sumSqX  += x * x;
+                m.sumSqY  += y * y;
+                m.diffX   += x - baseX;
+                m.diffY   += y - baseY;
+                m.diffSqX += (x - baseX) * (x - baseX);
+                m.diffSqY += (y - baseY) * (y - baseY);
+            }
+        }
+    };
+
+    runChunks(*tp, stats, runChunk, mergeChunk);
+    return NULL;
+}
+
+void writeSweep(const ThreadParams& params, const std::string& directory)
+{
+    const double cellArea = params.metresPerCell * params.metresPerCell / 1e6;
+    const SweepMoments& base = params.sweepVariants.front().moments;
+    const double baseVarX = (base.samples > 0.0) ? (base.sumSqX / base.samples) - pow(base.sumX / base.samples, 2) : 0.0;
+    const double baseVarY = (base.samples > 0.0) ? (base.sumSqY / base.samples) - pow(base.sumY / base.samples, 2) : 0.0;
+
+    std::ofstream os((directory + "/sweep.csv").c_str());
+    os << "Variant,Settings,Samples,Mean E,Mean N,STD E,STD N,Shift E,Shift N,Shift std error,"
+          "Shift std error without common random numbers,50% area (km2),90% area (km2)" << std::endl;
+    os.setf(std::ios::fixed);
+    os.precision(1);
+    for(size_t v = 0; v < params.sweepVariants.size(); ++v)
+    {
+        const SweepVariant& variant = params.sweepVariants[v];
+        const SweepMoments& m = variant.moments;
+        const double n = std::max(m.samples, 1.0);
+
+        double meanX  = m.sumX / n;
+        double meanY  = m.sumY / n;
+        double varX   = std::max(0.0, (m.sumSqX / n) - (meanX * meanX));
+        double varY   = std::max(0.0, (m.sumSqY / n) - (meanY * meanY));
+        double shiftX = m.diffX / n;
+        double shiftY = m.diffY / n;
+
+        // The standard error of the shift from the first variant, as
+        // measured with the paired samples and as it would have been with
+        // independent runs of the same size.
+        double pairedVar = std::max(0.0, (m.diffSqX / n) - (shiftX * shiftX)) +
+                           std::max(0.0, (m.diffSqY / n) - (shiftY * shiftY));
+        double independentVar = (v == 0) ? 0.0 : (varX + varY + baseVarX + baseVarY);
+
+        os << v << ",\"" << variant.name << "\"," << long(m.samples) << ","
+           << params.gridOrigin.x_ + meanX << "," << params.gridOrigin.y_ + meanY << ","
+           << sqrt(varX) << "," << sqrt(varY) << ","
+           << shiftX << "," << shiftY << ","
+           << sqrt(pairedVar / n) << "," << sqrt(independentVar / n) << ","
+           << containmentCells(variant.grid, 0.5) * cellArea << ","
+           << containmentCells(variant.grid, 0.9) * cellArea << std::endl;
+
+        std::ostringstream path;
+        path << directory << "/sweep_" << v << ".csv";
+        std::ofstream grid(path.str().c_str());
+        for(int row = 0; row < params.gridCellsY; ++row)
+        {
+            for(int col = 0; col < params.gridCellsX; ++col)
+            {
+                grid << ((col == 0) ? "" : ",") << variant.grid[col + (row * params.gridCellsX)];
+            }
+            grid << std::endl;
+        }
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <string>
+#include "thread.h"
+
+// Expands a sweep specification such as "fixBearing=-2,0,2; timeStep=0.5,1"
+// into one variant of params for every combination of the values. timeStep
+// (s) sets the integration step; the others offset the mean of a distribution
+// in the units of the main window: fixRange (NM), fixBearing, heading and
+// windDirection (deg), bankRate (deg/s), bankAccel (deg/s/s) and windSpeed
+// (kn, every row of the wind profile). The variant grids match the grid of
+// params, so set that up first. Throws std::runtime_error if the
+// specification can't be understood.
+void expandSweep(const ThreadParams& params, const std::string& spec, std::vector<SweepVariant>& variants);
+
+// Worker for a sweep (see ThreadParams::sweepVariants). Claims chunks of
+// samples through runChunks() and runs every variant on each sample. A
+// sample that fails in any variant is dropped from all of them.
+void* sweepThread(void* params);
+
+// Writes a summary table of the variants to sweep.csv in the given directory,
+// and the grid of each variant (one row of cells per line, south first) to
+// sweep_<n>.csv.
+void writeSweep(const ThreadParams& params, const std::string& directory);
+
+#endif // SWEEP_H
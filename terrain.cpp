@@ -0,0 +1,133 @@
+#include "terrain.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <QFile>
+
+namespace
+{
+
+// Reads a height sample, treating voids as sea level.
+inline double sample(const unsigned char* p)
+{
+    int h = short((p[0] << 8) | p[1]);
+    return (h == -32768) ? 0.0 : h;
+}
+
+} // namespace
+
+Terrain::Terrain() :
+    west_(0),
+    south_(0),
+    cols_(0),
+    rows_(0)
+{
+}
+
+Terrain::~Terrain()
+{
+}
+
+void Terrain::load(const std::string& directory, const Point2D& origin, double radius)
+{
+    directory_ = directory;
+    projection_.setOrigin(origin);
+
+    // Find the tiles covering a square around the origin.
+    double minLon = 1e9;
+    double maxLon = -1e9;
+    double minLat = 1e9;
+    double maxLat = -1e9;
+    for(int i = 0; i < 4; ++i)
+    {
+        double e   = origin.x_ + ((i & 1) ? radius : -radius);
+        double n   = origin.y_ + ((i & 2) ? radius : -radius);
+        double lon = projection_.longitude(e, n);
+        double lat = projection_.latitude(e, n);
+        minLon = std::min(minLon, lon);
+        maxLon = std::max(maxLon, lon);
+        minLat = std::min(minLat, lat);
+        maxLat = std::max(maxLat, lat);
+    }
+    west_  = int(floor(minLon));
+    south_ = int(floor(minLat));
+    cols_  = int(floor(maxLon)) - west_ + 1;
+    rows_  = int(floor(maxLat)) - south_ + 1;
+
+    tiles_.assign(cols_ * rows_, Tile());
+    int found = 0;
+    for(int row = 0; row < rows_; ++row)
+    {
+        for(int col = 0; col < cols_; ++col)
+        {
+            int lat = south_ + row;
+            int lon = west_ + col;
+            char name[32];
+            snprintf(name, sizeof(name), "%c%02d%c%03d.hgt", (lat < 0) ? 'S' : 'N', abs(lat), (lon < 0) ? 'W' : 'E', abs(lon));
+
+            Tile& tile = tiles_[col + (row * cols_)];
+            tile.data = NULL;
+            tile.size = 0;
+            tile.file.reset(new QFile(QString::fromStdString(directory + "/" + name)));
+            if(!tile.file->open(QIODevice::ReadOnly))
+            {
+                tile.file.reset();
+                continue;
+            }
+
+            qint64 bytes = tile.file->size();
+            int size     = int(std::round(sqrt(bytes / 2.0)));
+            if((size < 2) || (qint64(size) * size * 2 != bytes))
+                throw std::runtime_error("Not an SRTM tile: " + directory + "/" + name);
+
+            tile.data = tile.file->map(0, bytes);
+            if(tile.data == NULL)
+                throw std::runtime_error("Unable to map " + directory + "/" + name);
+            tile.size = size;
+            ++found;
+        }
+    }
+
+    if(found == 0)
+        throw std::runtime_error("No SRTM tiles for the search area in " + directory);
+}
+
+double Terrain::height(TerrainCache& cache, double easting, double northing) const
+{
+    double lon = projection_.longitude(easting, northing);
+    double lat = projection_.latitude(easting, northing);
+    int col    = int(floor(lon)) - west_;
+    int row    = int(floor(lat)) - south_;
+    if((col < 0) || (row < 0) || (col >= cols_) || (row >= rows_))
+        return 0.0;
+
+    int tile = col + (row * cols_);
+    if(tile != cache.tile)
+    {
+        cache.tile  = tile;
+        cache.data  = tiles_[tile].data;
+        cache.size  = tiles_[tile].size;
+        cache.west  = west_ + col;
+        cache.north = south_ + row + 1;
+    }
+    if(cache.data == NULL)
+        return 0.0;
+
+    // Position in samples from the north west corner.
+    const int last = cache.size - 1;
+    double x = (lon - cache.west) * last;
+    double y = (cache.north - lat) * last;
+    int ix   = std::min(int(x), last - 1);
+    int iy   = std::min(int(y), last - 1);
+    double fx = x - ix;
+    double fy = y - iy;
+
+    const unsigned char* p = cache.data + 2 * (ix + (iy * cache.size));
+    double top    = sample(p) + fx * (sample(p + 2) - sample(p));
+    p += 2 * cache.size;
+    double bottom = sample(p) + fx * (sample(p + 2) - sample(p));
+    return top + fy * (bottom - top);
+}
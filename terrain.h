@@ -0,0 +1,62 @@
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "point2d.h"
+#include "localprojection.h"
+
+class QFile;
+
+// Remembers the tile of the last terrain lookup. Each thread needs its own.
+struct TerrainCache
+{
+    TerrainCache() : tile(-1), data(NULL), size(0) {}
+
+    int                  tile;
+    const unsigned char* data;
+    int                  size;
+    double               west;
+    double               north;
+};
+
+// Ground heights from SRTM .hgt tiles: one degree square tiles named for
+// their south west corner (e.g. S33E151.hgt) holding big endian 16 bit
+// heights in metres, north row first, at 3 (1201 x 1201) or 1 (3601 x 3601)
+// arc second spacing. The tiles are memory mapped. Heights between the
+// samples are interpolated bilinearly; missing tiles and voids are taken to
+// be sea level.
+class Terrain
+{
+public:
+    Terrain();
+    ~Terrain();
+
+    // Maps the tiles in the given directory that lie within radius metres of
+    // origin (an AMG position). Throws std::runtime_error if there are none.
+    void load(const std::string& directory, const Point2D& origin, double radius);
+
+    // The ground height at the given AMG position.
+    double height(TerrainCache& cache, double easting, double northing) const;
+
+    const std::string& directory() const { return directory_; }
+
+private:
+    struct Tile
+    {
+        std::shared_ptr<QFile> file;
+        const unsigned char*   data;
+        int                    size;
+    };
+
+    std::string       directory_;
+    LocalProjection   projection_;
+    int               west_;  // longitude of the western tiles
+    int               south_; // latitude of the southern tiles
+    int               cols_;
+    int               rows_;
+    std::vector<Tile> tiles_;
+};
+
+#endif // TERRAIN_H
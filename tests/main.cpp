@@ -0,0 +1,51 @@
+// Checks of the numerical parts of plane-sailing that have a known answer.
+// Prints each failure and exits with the number of failures.
+
+#include "tests.h"
+
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+
+int failures = 0;
+
+} // namespace
+
+void check(bool ok, const char* what)
+{
+    if(!ok)
+    {
+        printf("FAILED: %s\n", what);
+        ++failures;
+    }
+}
+
+bool near(double a, double b, double tolerance)
+{
+    return fabs(a - b) <= tolerance;
+}
+
+int main()
+{
+    testTurn();
+    testSobol();
+    testCholesky();
+    testCrashStatsMerge();
+    testTrackPath();
+    testReweight();
+    testSampler();
+    testMultilevel();
+    testSweep();
+    testSensitivity();
+    testEstimate();
+    testSurrogate();
+    testContainment();
+    testSearchPlan();
+    if(failures == 0)
+    {
+        printf("All tests passed\n");
+    }
+    return failures;
+}
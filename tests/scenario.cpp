@@ -0,0 +1,77 @@
+#include "tests.h"
+
+#include "units.h"
+
+void setupScenario(ThreadParams& params)
+{
+    const double gridToMag = 11.63;
+    params.towerLocation   = Point2D(90345.0, -30092.0);
+    params.fixRange        = Distribution(NMToMetres(48.0), NMToMetres(0.5));
+    params.fixBearing      = Distribution(DEG2RAD(320.0 + gridToMag), DEG2RAD(2.0));
+    params.aircraftHeading = Distribution(DEG2RAD(140.0 + gridToMag), DEG2RAD(10.0));
+    params.initialBankRate = Distribution(0.0, DEG2RAD(0.1));
+    params.bankRateAccel   = Distribution(0.0, DEG2RAD(0.02));
+    params.windDirection   = Distribution(DEG2RAD(230.0 + gridToMag), DEG2RAD(10.0));
+
+    const struct
+    {
+        const char* time;
+        double      timeStdDev;
+        double      altitude;
+        double      speed;
+        double      speedStdDev;
+    }
+    profile[] =
+    {
+        { "19:36:00", 0.0,  8500.0, 145.0, 10.0 },
+        { "19:37:39", 0.0,  7500.0, -1.0,  -1.0 },
+        { "19:38:29", 0.0,  6500.0, -1.0,  -1.0 },
+        { "19:39:27", 35.0, 5500.0, 85.0,  10.0 }
+    };
+    const double start = stringToTime(profile[0].time);
+    params.flightProfile.clear();
+    for(size_t i = 0; i < sizeof(profile) / sizeof(profile[0]); ++i)
+    {
+        FlightPoint point;
+        point.time     = Distribution(stringToTime(profile[i].time) - start, profile[i].timeStdDev);
+        point.altitude = Distribution(FeetToMetres(profile[i].altitude), 0.0);
+        if(profile[i].speed > 0.0)
+        {
+            point.speed = Distribution(KnotsToMPS(profile[i].speed), KnotsToMPS(profile[i].speedStdDev));
+        }
+        params.flightProfile.push_back(point);
+    }
+
+    params.windProfile.clear();
+    params.windProfile.addPoint(FeetToMetres(6000.0), KnotsToMPS(33.0), KnotsToMPS(10.0));
+    params.windProfile.addPoint(FeetToMetres(8000.0), KnotsToMPS(43.0), KnotsToMPS(10.0));
+
+    params.timeStep   = 1.0;
+    params.integrator = EULER_INTEGRATOR;
+    params.seed       = 1;
+    params.sampling   = RANDOM_SAMPLING;
+}
+
+void narrowScenario(Scenario& s, double factor)
+{
+    Distribution* dists[] = { &s.fixRange, &s.fixBearing, &s.aircraftHeading, &s.initialBankRate, &s.bankRateAccel, &s.windDirection };
+    for(size_t i = 0; i < sizeof(dists) / sizeof(dists[0]); ++i)
+    {
+        *dists[i] = Distribution(dists[i]->mean(), factor * dists[i]->stdDev());
+    }
+    for(auto i = s.flightProfile.begin(); i != s.flightProfile.end(); ++i)
+    {
+        i->time = Distribution(i->time.mean(), factor * i->time.stdDev());
+        if(!i->speed.isNull())
+        {
+            i->speed = Distribution(i->speed.mean(), factor * i->speed.stdDev());
+        }
+    }
+    DistributionSet wind;
+    for(size_t i = 0; i < s.windProfile.size(); ++i)
+    {
+        wind.addPoint(s.windProfile.x(i), s.windProfile[i].mean(), factor * s.windProfile[i].stdDev());
+    }
+    wind.setCorrelationLength(s.windProfile.correlationLength());
+    s.windProfile = wind;
+}
@@ -0,0 +1,135 @@
+#include "tests.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include "containment.h"
+
+namespace
+{
+
+// The containment level found by sorting the whole grid.
+ContainmentLevel sortedLevel(const std::vector<double>& grid, double fraction)
+{
+    std::vector<double> values;
+    double total = 0.0;
+    for(size_t i = 0; i < grid.size(); ++i)
+    {
+        if(grid[i] > 0.0)
+        {
+            values.push_back(grid[i]);
+            total += grid[i];
+        }
+    }
+    std::sort(values.begin(), values.end(), std::greater<double>());
+    const double target = fraction * total * (1.0 - 1e-12);
+    ContainmentLevel retval = { 0.0, 0.0, 0 };
+    double sum = 0.0;
+    for(size_t i = 0; i < values.size(); ++i)
+    {
+        if(sum + values[i] >= target)
+        {
+            retval.threshold   = values[i];
+            retval.cells       = i + ((target - sum) / values[i]);
+            retval.atThreshold = i + 1 - (std::find(values.begin(), values.end(), values[i]) - values.begin());
+            break;
+        }
+        sum += values[i];
+    }
+    return retval;
+}
+
+// Twice the area enclosed by the rings, counting holes as negative.
+double ringArea(const std::vector<std::vector<Point2D> >& rings)
+{
+    double area = 0.0;
+    for(size_t r = 0; r < rings.size(); ++r)
+    {
+        for(size_t i = 0; i + 1 < rings[r].size(); ++i)
+        {
+            area += (rings[r][i].x_ * rings[r][i + 1].y_) - (rings[r][i + 1].x_ * rings[r][i].y_);
+        }
+    }
+    return area;
+}
+
+} // namespace
+
+// Containment levels against sorting the grid, on grids large enough to take
+// the histogram passes and with the ties of cell counts, and the outlines of
+// the sets they mark. The cell counts can differ in their last digits, as the
+// sums are taken in a different order.
+void testContainment()
+{
+    std::mt19937 rng(12);
+    const int cells = 120;
+    bool levels = true;
+    bool masks  = true;
+    bool areas  = true;
+    for(int trial = 0; trial < 6; ++trial)
+    {
+        // Counts, with many cells tying, or continuous values.
+        std::vector<double> grid(cells * cells, 0.0);
+        std::normal_distribution<> norm(0.0, 20.0 + (5.0 * trial));
+        std::uniform_real_distribution<> uniform;
+        for(int i = 0; i < 200000; ++i)
+        {
+            int col = int(floor((cells / 2) + norm(rng)));
+            int row = int(floor((cells / 2) + (0.5 * norm(rng))));
+            if((col >= 0) && (row >= 0) && (col < cells) && (row < cells))
+            {
+                grid[(row * cells) + col] += (trial % 2 == 0) ? 1.0 : uniform(rng);
+            }
+        }
+
+        const double fractions[] = { 0.5, 0.9, 0.99, 1.0 };
+        for(size_t f = 0; f < sizeof(fractions) / sizeof(fractions[0]); ++f)
+        {
+            ContainmentLevel expected = sortedLevel(grid, fractions[f]);
+            ContainmentLevel level    = containmentLevel(grid, fractions[f], 1 + (trial % 4));
+            levels = levels &&
+                     (level.threshold == expected.threshold) &&
+                     (level.atThreshold == expected.atThreshold) &&
+                     near(level.cells, expected.cells, 1e-4);
+
+            std::vector<char> inside;
+            size_t marked = containmentMask(grid, level, inside);
+            masks = masks && (marked == size_t(ceil(level.cells - 1e-9)));
+
+            std::vector<std::vector<Point2D> > rings;
+            containmentOutlines(inside, cells, cells, rings);
+            areas = areas && near(ringArea(rings), 2.0 * marked, 1e-9);
+        }
+    }
+    check(levels, "containment level");
+    check(masks, "containment mask");
+    check(areas, "containment outline areas");
+
+    // A square with a hole in the middle, and two cells touching only at a
+    // corner, which stay apart.
+    const char square[] =
+    {
+        0, 0, 0, 0, 0,
+        0, 1, 1, 1, 0,
+        0, 1, 0, 1, 0,
+        0, 1, 1, 1, 0,
+        0, 0, 0, 0, 1
+    };
+    std::vector<std::vector<Point2D> > rings;
+    containmentOutlines(std::vector<char>(square, square + 25), 5, 5, rings);
+    check(rings.size() == 3, "containment outline count");
+    bool shapes = true;
+    int holes = 0;
+    for(size_t r = 0; r < rings.size(); ++r)
+    {
+        std::vector<std::vector<Point2D> > one(1, rings[r]);
+        double area = ringArea(one);
+        shapes = shapes && (rings[r].size() == 5) && (rings[r].front().x_ == rings[r].back().x_) && (rings[r].front().y_ == rings[r].back().y_);
+        shapes = shapes && ((area == 18.0) || (area == 2.0) || (area == -2.0));
+        holes += (area < 0.0) ? 1 : 0;
+    }
+    check(shapes && (holes == 1), "containment outline shapes");
+}
@@ -0,0 +1,46 @@
+#include "tests.h"
+
+#include <random>
+
+#include "crashstats.h"
+#include "point2d.h"
+
+// Statistics kept in parts and merged match those kept in one.
+void testCrashStatsMerge()
+{
+    const Point2D centre(1000.0, -500.0);
+    const double halfWidth = 20000.0;
+    CrashStats whole(centre, halfWidth);
+    CrashStats first(centre, halfWidth);
+    CrashStats second(centre, halfWidth);
+    CrashStats empty(centre, halfWidth);
+
+    std::mt19937 rng(7);
+    std::normal_distribution<> norm;
+    std::uniform_real_distribution<> uniform(0.0, 2.0);
+    for(int i = 0; i < 20000; ++i)
+    {
+        Point2D pos(centre.x_ + 3000.0 * norm(rng), centre.y_ + 1000.0 * norm(rng) + 0.5 * (i % 100));
+        double weight = uniform(rng);
+        whole.add(pos, weight);
+        ((i < 5000) ? first : second).add(pos, weight);
+    }
+    first.add(Point2D(1e9, 1e9), 0.0); // ignored
+    first.merge(second);
+    first.merge(empty);
+    empty.merge(first);
+
+    const CrashStats* merged[] = { &first, &empty };
+    for(int i = 0; i < 2; ++i)
+    {
+        const CrashStats& s = *merged[i];
+        check(near(s.count(), whole.count(), 1e-9 * whole.count()), "merged count");
+        check(near(s.mean().x_, whole.mean().x_, 1e-6) && near(s.mean().y_, whole.mean().y_, 1e-6), "merged mean");
+        check(near(s.covXX(), whole.covXX(), 1e-9 * whole.covXX()) &&
+              near(s.covXY(), whole.covXY(), 1e-9 * whole.covXX()) &&
+              near(s.covYY(), whole.covYY(), 1e-9 * whole.covYY()), "merged covariance");
+        check(near(s.quantileX(0.9), whole.quantileX(0.9), 1e-6) &&
+              near(s.quantileY(0.5), whole.quantileY(0.5), 1e-6) &&
+              near(s.quantileRadius(0.95), whole.quantileRadius(0.95), 1e-6), "merged quantiles");
+    }
+}
@@ -0,0 +1,105 @@
+#include "tests.h"
+
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "estimate.h"
+#include "util.h"
+#include "point3d.h"
+
+namespace
+{
+
+// The mean and covariance of the crash positions of random tracks, leaving
+// out any that fail.
+CrashEstimate sampleCrash(const ThreadParams& params, int count)
+{
+    std::mt19937 rng(8);
+    std::normal_distribution<> norm;
+    std::vector<double> z(inputCount(params));
+    SampleProfiles profiles;
+    double sums[5] = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+    int tracks = 0;
+    for(int i = 0; i < count; ++i)
+    {
+        for(size_t j = 0; j < z.size(); ++j)
+        {
+            z[j] = norm(rng);
+        }
+        Point3D crash;
+        try
+        {
+            crash = CalcSample(params, params.integrator, z.data(), profiles, params.timeStep);
+        }
+        catch(const std::exception&)
+        {
+            continue;
+        }
+        ++tracks;
+        sums[0] += crash.x_;
+        sums[1] += crash.y_;
+        sums[2] += crash.x_ * crash.x_;
+        sums[3] += crash.x_ * crash.y_;
+        sums[4] += crash.y_ * crash.y_;
+    }
+    CrashEstimate retval;
+    retval.mean   = Point2D(sums[0] / tracks, sums[1] / tracks);
+    retval.covXX  = (sums[2] / tracks) - (retval.mean.x_ * retval.mean.x_);
+    retval.covXY  = (sums[3] / tracks) - (retval.mean.x_ * retval.mean.y_);
+    retval.covYY  = (sums[4] / tracks) - (retval.mean.y_ * retval.mean.y_);
+    retval.tracks = tracks;
+    return retval;
+}
+
+} // namespace
+
+// The unscented estimate against random tracks for a data set narrow enough
+// to be nearly linear, the mixture of an ensemble's estimates and the axes of
+// known ellipses.
+void testEstimate()
+{
+    ThreadParams params;
+    setupScenario(params);
+    narrowScenario(params, 0.05);
+    CrashEstimate estimate = estimateCrash(params);
+    CrashEstimate sampled  = sampleCrash(params, 4000);
+    const double scale = sqrt(sampled.covXX * sampled.covYY);
+    check(near(estimate.mean.x_, sampled.mean.x_, 0.1 * sqrt(sampled.covXX)) &&
+          near(estimate.mean.y_, sampled.mean.y_, 0.1 * sqrt(sampled.covYY)), "unscented mean");
+    check(near(estimate.covXX, sampled.covXX, 0.1 * sampled.covXX) &&
+          near(estimate.covXY, sampled.covXY, 0.1 * scale) &&
+          near(estimate.covYY, sampled.covYY, 0.1 * sampled.covYY), "unscented covariance");
+    check(estimate.tracks == int(1 + (2 * inputCount(params))), "unscented track count");
+
+    // An ensemble is the mixture of its data sets' estimates.
+    ThreadParams moved = params;
+    moved.fixRange = Distribution(params.fixRange.mean() + 2000.0, params.fixRange.stdDev());
+    CrashEstimate other = estimateCrash(moved);
+    params.scenarios.push_back(params);
+    params.scenarios.push_back(moved);
+    params.scenarioWeights.push_back(1.0);
+    params.scenarioWeights.push_back(3.0);
+    CrashEstimate mixed = estimateCrash(params);
+    const double meanX = (0.25 * estimate.mean.x_) + (0.75 * other.mean.x_);
+    const double meanY = (0.25 * estimate.mean.y_) + (0.75 * other.mean.y_);
+    const double dx    = other.mean.x_ - estimate.mean.x_;
+    const double dy    = other.mean.y_ - estimate.mean.y_;
+    check(near(mixed.mean.x_, meanX, 1e-6) && near(mixed.mean.y_, meanY, 1e-6), "ensemble estimate mean");
+    check(near(mixed.covXX, (0.25 * estimate.covXX) + (0.75 * other.covXX) + (0.1875 * dx * dx), 1e-3) &&
+          near(mixed.covXY, (0.25 * estimate.covXY) + (0.75 * other.covXY) + (0.1875 * dx * dy), 1e-3) &&
+          near(mixed.covYY, (0.25 * estimate.covYY) + (0.75 * other.covYY) + (0.1875 * dy * dy), 1e-3), "ensemble estimate covariance");
+    check(mixed.tracks == estimate.tracks + other.tracks, "ensemble estimate track count");
+
+    // Variances of 4 east and 1 north: a 2:1 ellipse with its major axis
+    // east.
+    double major;
+    double minor;
+    double bearing;
+    ellipseAxes(4.0, 0.0, 1.0, 0.5, major, minor, bearing);
+    const double radius = sqrt(-2.0 * log(0.5));
+    check(near(major, 2.0 * radius, 1e-12) && near(minor, radius, 1e-12) && near(bearing, 0.5 * M_PI, 1e-12), "ellipse axes");
+    ellipseAxes(2.5, 1.5, 2.5, 0.5, major, minor, bearing);
+    check(near(major, 2.0 * radius, 1e-12) && near(minor, radius, 1e-12) && near(bearing, 0.25 * M_PI, 1e-12), "rotated ellipse axes");
+}
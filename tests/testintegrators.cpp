@@ -0,0 +1,71 @@
+#include "tests.h"
+
+#include <cmath>
+
+#include "util.h"
+#include "pointset.h"
+#include "point3d.h"
+
+// A steady turn at constant speed with no wind, against the circle it flies.
+// The profiles are given with one point and with two, which take different
+// paths through the integrators.
+void testTurn()
+{
+    const double speed    = 60.0;
+    const double rate     = 0.01;  // rad/s
+    const double heading  = 1.0;
+    const double range    = 5000.0;
+    const double bearing  = 0.3;
+    const double duration = 305.0; // not a whole number of steps
+
+    PointSet altitude1;
+    PointSet wind1;
+    PointSet speed1;
+    altitude1.addPoint(0.0, 1000.0);
+    wind1.addPoint(0.0, 0.0);
+    speed1.addPoint(0.0, speed);
+
+    PointSet altitude2;
+    PointSet wind2;
+    PointSet speed2;
+    altitude2.addPoint(0.0, 1000.0);
+    altitude2.addPoint(1000.0, 1000.0);
+    wind2.addPoint(0.0, 0.0);
+    wind2.addPoint(5000.0, 0.0);
+    speed2.addPoint(0.0, speed);
+    speed2.addPoint(1000.0, speed);
+
+    const double endHeading = heading + (rate * duration);
+    const double radius     = speed / rate;
+    const double x = (range * sin(bearing)) + (radius * (cos(heading) - cos(endHeading)));
+    const double y = (range * cos(bearing)) + (radius * (sin(endHeading) - sin(heading)));
+
+    TrackEnvironment environment;
+    const struct
+    {
+        Integrator      integrator;
+        double          timeStep;
+        double          tolerance;
+        const PointSet* altitude;
+        const PointSet* wind;
+        const PointSet* speed;
+        const char*     name;
+    }
+    cases[] =
+    {
+        { RK4_INTEGRATOR, 10.0, 0.01, &altitude1, &wind1, &speed1, "RK4 turn, one-point profiles" },
+        { RK4_INTEGRATOR, 10.0, 0.01, &altitude2, &wind2, &speed2, "RK4 turn, two-point profiles" },
+        { ARC_INTEGRATOR, 10.0, 1e-6, &altitude1, &wind1, &speed1, "arc turn, one-point profiles" },
+        { ARC_INTEGRATOR, 60.0, 1e-6, &altitude2, &wind2, &speed2, "arc turn, two-point profiles" }
+    };
+    for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i)
+    {
+        Point3D end = CalcTrack(
+                    Point2D(0.0, 0.0), cases[i].timeStep, cases[i].integrator, *cases[i].altitude,
+                    range, bearing, duration, heading, rate, 0.0, 0.0,
+                    *cases[i].wind, *cases[i].speed, environment
+                    );
+        check(near(end.x_, x, cases[i].tolerance) && near(end.y_, y, cases[i].tolerance), cases[i].name);
+        check(near(end.z_, 1000.0, 1e-9), "turn altitude");
+    }
+}
@@ -0,0 +1,57 @@
+#include "tests.h"
+
+#include <vector>
+
+#include "multilevel.h"
+
+// The levels a run is split into and the grid combined from their sums.
+void testMultilevel()
+{
+    ThreadParams params;
+    params.mlmcLevels = 2;
+    params.timeStep   = 0.5;
+    params.gridCellsX = 2;
+    params.gridCellsY = 2;
+    setupLevels(params, 8 * chunkSize);
+
+    // Half as many chunks at each finer level, interleaved so that the first
+    // half of the run holds the first half of every level.
+    std::vector<int> chunks(3, 0);
+    std::vector<int> firstHalf(3, 0);
+    for(size_t c = 0; c < params.chunkLevels.size(); ++c)
+    {
+        ++chunks[params.chunkLevels[c]];
+        if(c < params.chunkLevels.size() / 2)
+        {
+            ++firstHalf[params.chunkLevels[c]];
+        }
+    }
+    check((chunks[0] == 8) && (chunks[1] == 4) && (chunks[2] == 2), "multilevel chunks per level");
+    check((firstHalf[0] == 4) && (firstHalf[1] == 2) && (firstHalf[2] == 1), "multilevel chunks interleaved");
+    check(params.totalIterations == 14 * chunkSize, "multilevel total iterations");
+    check((params.levelGrids.size() == 3) && (params.levelGrids[2].size() == 4), "multilevel level grids");
+    check((levelTimeStep(params, 0) == 2.0) && (levelTimeStep(params, 2) == 0.5), "multilevel time steps");
+
+    // Level 1 holds differences from half as many samples as level 0, so they
+    // count twice. A level with no samples yet is left out, and a cell the
+    // corrections take below zero is clamped.
+    const double level0[] = { 10.0, 5.0, 0.0, 2.0 };
+    const double level1[] = { 1.0, -2.0, 0.0, -5.0 };
+    const double level2[] = { 7.0, 7.0, 7.0, 7.0 };
+    params.levelGrids[0].assign(level0, level0 + 4);
+    params.levelGrids[1].assign(level1, level1 + 4);
+    params.levelGrids[2].assign(level2, level2 + 4);
+    params.levelCompleted[0] = 100;
+    params.levelCompleted[1] = 50;
+    params.levelCompleted[2] = 0;
+    combineLevels(params);
+    const double expected[] = { 12.0, 1.0, 0.0, 0.0 };
+    check(params.grid == std::vector<double>(expected, expected + 4), "multilevel combined grid");
+
+    // Level l costs 2^l steps at its own step and 2^(l-1) at the coarser
+    // one, against 2^mlmcLevels for a level 0 sample at the finest step.
+    params.levelCompleted[0] = 8000;
+    params.levelCompleted[1] = 4000;
+    params.levelCompleted[2] = 2000;
+    check(near(multilevelWork(params), 1.0, 1e-12), "multilevel work");
+}
@@ -0,0 +1,93 @@
+#include "tests.h"
+
+#include <cmath>
+#include <stdexcept>
+
+#include "reweight.h"
+
+// Samples of the fix range reweighted for a shifted mean, and for a sighting,
+// against the moments and effective sample sizes worked out for normal
+// distributions. The other inputs have no spread.
+void testReweight()
+{
+    const double mean   = 10000.0;
+    const double stdDev = 100.0;
+    const int    count  = 20000;
+
+    ThreadParams params;
+    params.fixRange        = Distribution(mean, stdDev);
+    params.fixBearing      = Distribution(0.5, 0.0);
+    params.aircraftHeading = Distribution(1.0, 0.0);
+    params.initialBankRate = Distribution(0.0, 0.0);
+    params.bankRateAccel   = Distribution(0.0, 0.0);
+    params.windDirection   = Distribution(2.0, 0.0);
+    params.gridCellsX      = 40;
+    params.gridCellsY      = 1;
+    params.metresPerCell   = 25.0;
+    params.gridOrigin      = Point2D(mean - 500.0, -12.5);
+
+    // Evenly spaced quantiles rather than random deviates, so that the sums
+    // are close to the integrals.
+    for(int i = 0; i < count; ++i)
+    {
+        float z = float(inverseNormalCdf((i + 0.5) / count));
+        params.crashPoints.push_back(Point2D(params.fixRange.offsetMean(z), 0.0));
+        float inputs[] = { z, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+        params.sampleInputs.insert(params.sampleInputs.end(), inputs, inputs + 6);
+    }
+
+    // Moving the mean by one standard deviation leaves exp(-1) of the samples.
+    ThreadParams updated = params;
+    updated.fixRange = Distribution(mean + stdDev, stdDev);
+    double ess = reweightSamples(params, updated, NULL, 4);
+    check(near(ess / count, exp(-1.0), 0.005), "effective sample size of a shifted mean");
+
+    double sum     = 0.0;
+    double sumX    = 0.0;
+    double gridSum = 0.0;
+    double inGrid  = 0.0;
+    for(int i = 0; i < count; ++i)
+    {
+        sum  += params.sampleWeights[i];
+        sumX += params.sampleWeights[i] * params.crashPoints[i].x_;
+        if(gridIndex(params, params.crashPoints[i]) >= 0)
+        {
+            inGrid += params.sampleWeights[i];
+        }
+    }
+    for(size_t c = 0; c < params.grid.size(); ++c)
+    {
+        gridSum += params.grid[c];
+    }
+    check(near(sum, count, 1e-6 * count), "reweighted samples keep their total");
+    check(near(sumX / sum, mean + stdDev, 2.0), "reweighted mean");
+    check(near(gridSum, inGrid, 1e-6 * count), "grid rebuilt with the weights");
+
+    // A sighting one standard deviation away, with the same spread, meets the
+    // prior half way; the weights are gaussian in the samples' deviates.
+    SpatialLikelihood sighting;
+    sighting.position = Point2D(mean + stdDev, 0.0);
+    sighting.stdDev   = stdDev;
+    ess = reweightSamples(params, params, &sighting, 4);
+    check(near(ess / count, 0.5 * sqrt(3.0) * exp(-1.0 / 6.0), 0.005), "effective sample size after a sighting");
+    sumX = 0.0;
+    for(int i = 0; i < count; ++i)
+    {
+        sumX += params.sampleWeights[i] * params.crashPoints[i].x_;
+    }
+    check(near(sumX / count, mean + (0.5 * stdDev), 2.0), "mean after a sighting");
+
+    // An input that was fixed can't be given a spread.
+    updated = params;
+    updated.bankRateAccel = Distribution(0.0, 0.1);
+    bool threw = false;
+    try
+    {
+        reweightSamples(params, updated, NULL, 4);
+    }
+    catch(const std::runtime_error&)
+    {
+        threw = true;
+    }
+    check(threw, "reweighting a fixed input");
+}
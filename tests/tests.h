@@ -0,0 +1,33 @@
+#ifndef TESTS_H
+#define TESTS_H
+
+#include "thread.h"
+
+// Records a failure, printing what failed, unless ok.
+void check(bool ok, const char* what);
+
+bool near(double a, double b, double tolerance);
+
+// Sets up a data set like the window's default one (see scenario.cpp).
+void setupScenario(ThreadParams& params);
+
+// Narrows the spread of every input of a data set by the given factor.
+void narrowScenario(Scenario& s, double factor);
+
+// The checks of each part of the program, in their own files.
+void testTurn();
+void testSobol();
+void testCholesky();
+void testCrashStatsMerge();
+void testTrackPath();
+void testReweight();
+void testSampler();
+void testMultilevel();
+void testSweep();
+void testSensitivity();
+void testEstimate();
+void testSurrogate();
+void testContainment();
+void testSearchPlan();
+
+#endif // TESTS_H
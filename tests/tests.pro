@@ -0,0 +1,92 @@
+#-------------------------------------------------
+#
+# Checks of the numerical code, without the window. Build and run the
+# tests executable; it prints any failures and exits non-zero if there
+# were some.
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = tests
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -std=c++0x
+INCLUDEPATH += ..
+SOURCES += main.cpp \
+    scenario.cpp \
+    testintegrators.cpp \
+    testsobol.cpp \
+    testwindprofile.cpp \
+    testcrashstats.cpp \
+    testtrackpath.cpp \
+    testreweight.cpp \
+    testsampler.cpp \
+    testmultilevel.cpp \
+    testsweep.cpp \
+    testsensitivity.cpp \
+    testestimate.cpp \
+    testsurrogate.cpp \
+    testcontainment.cpp \
+    testsearchplan.cpp \
+    ../util.cpp \
+    ../kmlfile.cpp \
+    ../pointset.cpp \
+    ../track3d.cpp \
+    ../point3d.cpp \
+    ../point2d.cpp \
+    ../distribution.cpp \
+    ../units.cpp \
+    ../distributionset.cpp \
+    ../sobol.cpp \
+    ../windfield.cpp \
+    ../localprojection.cpp \
+    ../terrain.cpp \
+    ../estimate.cpp \
+    ../crashstats.cpp \
+    ../trackpath.cpp \
+    ../reweight.cpp \
+    ../thread.cpp \
+    ../sampler.cpp \
+    ../multilevel.cpp \
+    ../ensemble.cpp \
+    ../sweep.cpp \
+    ../containment.cpp \
+    ../sensitivity.cpp \
+    ../surrogate.cpp \
+    ../searchplan.cpp
+
+HEADERS += tests.h \
+    ../util.h \
+    ../kmlfile.h \
+    ../pointset.h \
+    ../track3d.h \
+    ../point3d.h \
+    ../point2d.h \
+    ../distribution.h \
+    ../units.h \
+    ../distributionset.h \
+    ../sobol.h \
+    ../trackkernel.h \
+    ../windfield.h \
+    ../localprojection.h \
+    ../terrain.h \
+    ../estimate.h \
+    ../crashstats.h \
+    ../trackpath.h \
+    ../reweight.h \
+    ../thread.h \
+    ../sampler.h \
+    ../multilevel.h \
+    ../ensemble.h \
+    ../sweep.h \
+    ../containment.h \
+    ../sensitivity.h \
+    ../surrogate.h \
+    ../searchplan.h
+
+LIBS += -lpthread
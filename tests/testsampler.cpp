@@ -0,0 +1,111 @@
+#include "tests.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "sampler.h"
+
+namespace
+{
+
+// Chunk moments of a response with linear and quadratic parts over chunks of
+// the given sampling scheme.
+ChunkMoments linearMoments(Sampling sampling)
+{
+    ThreadParams params;
+    params.sampling = sampling;
+    params.seed     = 11;
+    ChunkMoments m = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0 };
+    const int size = 200;
+    for(int begin = 0; begin < 50 * size; begin += size)
+    {
+        ChunkSampler sampler(params, begin, begin + size, 3);
+        double sumX = 0.0;
+        double sumY = 0.0;
+        for(int i = 0; i < size; ++i)
+        {
+            double z[3];
+            sampler.next(z);
+            double x = z[0] + z[1] + (0.5 * z[0] * z[0]);
+            double y = z[2] + (0.2 * z[2] * z[2]);
+            sumX     += x;
+            sumY     += y;
+            m.sumSqX += x * x;
+            m.sumSqY += y * y;
+        }
+        m.samples  += size;
+        m.sumX     += sumX;
+        m.sumY     += sumY;
+        m.chunkSqX += (sumX * sumX) / size;
+        m.chunkSqY += (sumY * sumY) / size;
+        ++m.chunks;
+    }
+    return m;
+}
+
+} // namespace
+
+// A Latin hypercube chunk puts one sample in each of its equal probability
+// strata of every input, and antithetic pairs mirror each other. Both leave
+// the chunk means of a smooth response with less spread than independent
+// samples, which estimatedVarianceReduction() should see: antithetic pairs
+// cancel the linear part and Latin hypercubes every part in one input.
+void testSampler()
+{
+    ThreadParams params;
+    params.seed = 5;
+
+    params.sampling = LATIN_HYPERCUBE_SAMPLING;
+    const int size = 500;
+    const size_t dims = 4;
+    ChunkSampler lhs(params, 1000, 1000 + size, dims);
+    std::vector<std::vector<int> > counts(dims, std::vector<int>(size, 0));
+    for(int i = 0; i < size; ++i)
+    {
+        double z[dims];
+        lhs.next(z);
+        for(size_t j = 0; j < dims; ++j)
+        {
+            double u = 0.5 * erfc(-z[j] / sqrt(2.0));
+            int stratum = std::min(int(u * size), size - 1);
+            ++counts[j][stratum];
+        }
+    }
+    bool stratified = true;
+    for(size_t j = 0; j < dims; ++j)
+    {
+        for(int s = 0; s < size; ++s)
+        {
+            stratified = stratified && (counts[j][s] == 1);
+        }
+    }
+    check(stratified, "Latin hypercube strata");
+
+    params.sampling = ANTITHETIC_SAMPLING;
+    ChunkSampler anti(params, 0, 100, dims);
+    bool mirrored = true;
+    bool moved    = false;
+    for(int i = 0; i < 50; ++i)
+    {
+        double a[dims];
+        double b[dims];
+        anti.next(a);
+        anti.next(b);
+        for(size_t j = 0; j < dims; ++j)
+        {
+            mirrored = mirrored && (a[j] == -b[j]);
+            moved    = moved || (a[j] != 0.0);
+        }
+    }
+    check(mirrored && moved, "antithetic pairs");
+
+    double random = estimatedVarianceReduction(linearMoments(RANDOM_SAMPLING));
+    check((random > 0.5) && (random < 2.0), "no variance reduction from random sampling");
+    check(estimatedVarianceReduction(linearMoments(LATIN_HYPERCUBE_SAMPLING)) > 20.0, "variance reduction from Latin hypercube sampling");
+    check(estimatedVarianceReduction(linearMoments(ANTITHETIC_SAMPLING)) > 2.0, "variance reduction from antithetic sampling");
+
+    ChunkMoments few = linearMoments(RANDOM_SAMPLING);
+    few.chunks = 5;
+    check(estimatedVarianceReduction(few) == 0.0, "too few chunks to estimate the variance reduction");
+}
@@ -0,0 +1,181 @@
+#include "tests.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "searchplan.h"
+#include "units.h"
+
+namespace
+{
+
+bool parseFails(const std::string& spec)
+{
+    SearchSettings settings;
+    try
+    {
+        parseSearchSettings(spec, settings);
+    }
+    catch(const std::runtime_error&)
+    {
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+// Search plans against the worked answer for two cells, the conditions that
+// make a plan the best one on a larger grid, the sharing of the cells
+// between units, and the reading of the settings.
+void testSearchPlan()
+{
+    // Cells of 100 m^2 swept 100 m wide, so coverage is metres of track.
+    // Searching the cell with three times the probability brings it down to
+    // the other's return after ln 3 m; after that both are searched.
+    const double two[] = { 0.75, 0.25 };
+    SearchPlan plan;
+    planSearch(std::vector<double>(two, two + 2), 2, 1, 10.0, std::vector<double>(1, 100.0), RANDOM_SEARCH_DETECTION, 1.0, 1, 1, plan);
+    check((plan.cellsSearched == 1) && near(plan.coverage[0], 1.0, 1e-9) && (plan.coverage[1] == 0.0), "search of the likelier cell alone");
+    planSearch(std::vector<double>(two, two + 2), 2, 1, 10.0, std::vector<double>(1, 100.0), RANDOM_SEARCH_DETECTION, 3.0, 1, 1, plan);
+    const double c0 = 0.5 * (3.0 + log(3.0));
+    const double c1 = 3.0 - c0;
+    check((plan.cellsSearched == 2) && near(plan.coverage[0], c0, 1e-9) && near(plan.coverage[1], c1, 1e-9), "search of both cells");
+    check(near(plan.success, (0.75 * (1.0 - exp(-c0))) + (0.25 * (1.0 - exp(-c1))), 1e-9), "search success");
+
+    // A grid with sweep widths varying by cell. Every searched cell returns
+    // the same on one more metre, no unsearched cell would return more, and
+    // moving track between cells only loses.
+    const int cellsX = 120;
+    const int cellsY = 100;
+    const double metresPerCell = 1000.0;
+    std::mt19937 rng(2);
+    std::normal_distribution<> norm(0.0, 15.0);
+    std::uniform_real_distribution<> uniform(500.0, 2000.0);
+    std::vector<double> grid(cellsX * cellsY, 0.0);
+    std::vector<double> widths(grid.size());
+    for(int i = 0; i < 100000; ++i)
+    {
+        int col = int(floor((cellsX / 2) + norm(rng)));
+        int row = int(floor((cellsY / 2) + norm(rng)));
+        if((col >= 0) && (row >= 0) && (col < cellsX) && (row < cellsY))
+        {
+            grid[(row * cellsX) + col] += 1.0;
+        }
+    }
+    double total = 0.0;
+    for(size_t i = 0; i < grid.size(); ++i)
+    {
+        widths[i] = uniform(rng);
+        total    += grid[i];
+    }
+
+    const DetectionModel models[] = { RANDOM_SEARCH_DETECTION, INVERSE_CUBE_DETECTION };
+    const double trackLength = 2e6;
+    for(int m = 0; m < 2; ++m)
+    {
+        planSearch(grid, cellsX, cellsY, metresPerCell, widths, models[m], trackLength, 3, 4, plan);
+        SearchPlan single;
+        planSearch(grid, cellsX, cellsY, metresPerCell, widths, models[m], trackLength, 3, 1, single);
+        bool same = true;
+        for(size_t i = 0; i < grid.size(); ++i)
+        {
+            same = same && near(single.coverage[i], plan.coverage[i], 1e-9);
+        }
+        check(same, "search plan on one thread and several");
+
+        // Probability found per metre of track: p f'(c) w / a.
+        auto slope = [&](double c)
+        {
+            return (models[m] == RANDOM_SEARCH_DETECTION) ? exp(-c) : exp(-M_PI * c * c / 4.0);
+        };
+        double low   = HUGE_VAL;
+        double high  = 0.0;
+        double best  = 0.0;
+        double flown = 0.0;
+        double found = 0.0;
+        for(size_t i = 0; i < grid.size(); ++i)
+        {
+            double gain = (grid[i] / total) * widths[i] / (metresPerCell * metresPerCell);
+            if(plan.coverage[i] > 0.0)
+            {
+                low   = std::min(low, gain * slope(plan.coverage[i]));
+                high  = std::max(high, gain * slope(plan.coverage[i]));
+                flown += plan.track[i];
+                found += (grid[i] / total) * plan.detection[i];
+            }
+            else
+            {
+                best = std::max(best, gain);
+            }
+        }
+        check((plan.cellsSearched > 100) && (high - low < 1e-6 * high) && (best <= high * (1.0 + 1e-6)), "search returns equal across the searched cells");
+        check(near(flown, trackLength, 1e-6 * trackLength) && near(plan.trackLength, trackLength, 0.0), "search track length");
+        check(near(found, plan.success, 1e-12), "search success sums the cells");
+
+        bool better = true;
+        for(int trial = 0; trial < 100; ++trial)
+        {
+            size_t from = rng() % grid.size();
+            size_t to   = rng() % grid.size();
+            if((from == to) || (plan.track[from] <= 0.0) || (grid[to] <= 0.0))
+                continue;
+
+            double moved = 0.5 * plan.track[from];
+            auto detection = [&](size_t i, double track)
+            {
+                double c = track * widths[i] / (metresPerCell * metresPerCell);
+                return (models[m] == RANDOM_SEARCH_DETECTION) ? 1.0 - exp(-c) : erf(c * sqrt(M_PI) / 2.0);
+            };
+            double before = (grid[from] * detection(from, plan.track[from])) + (grid[to] * detection(to, plan.track[to]));
+            double after  = (grid[from] * detection(from, plan.track[from] - moved)) + (grid[to] * detection(to, plan.track[to] + moved));
+            better = better && (after <= before * (1.0 + 1e-12));
+        }
+        check(better, "search plan can't be bettered by moving track");
+
+        // The cells are dealt out in rows, alternately east and west, each
+        // unit taking a third of the track.
+        std::vector<double> shares(3, 0.0);
+        int last = 0;
+        bool ordered = true;
+        for(int row = 0; row < cellsY; ++row)
+        {
+            for(int step = 0; step < cellsX; ++step)
+            {
+                int col = ((row % 2) == 0) ? step : cellsX - 1 - step;
+                size_t idx = (row * cellsX) + col;
+                if(plan.coverage[idx] <= 0.0)
+                {
+                    ordered = ordered && (plan.unit[idx] == -1);
+                    continue;
+                }
+                ordered = ordered && (plan.unit[idx] >= last);
+                last = plan.unit[idx];
+                shares[last] += plan.track[idx];
+            }
+        }
+        bool even = true;
+        for(int u = 0; u < 3; ++u)
+        {
+            even = even && near(shares[u], trackLength / 3.0, 0.02 * trackLength);
+        }
+        check(ordered && even, "search units");
+    }
+
+    SearchSettings settings;
+    parseSearchSettings("units=3; hours=4; speed=120; width=1500; detection=inverseCube", settings);
+    check((settings.units == 3) && (settings.hoursPerUnit == 4.0) && (settings.speed == 120.0) &&
+          (settings.sweepWidth == 1500.0) && (settings.detection == INVERSE_CUBE_DETECTION), "search settings");
+    check(near(settings.trackLength(), 3 * 4 * 3600.0 * KnotsToMPS(120.0), 1e-6), "search settings track length");
+    parseSearchSettings("width=1500;speed=120;hours=4;units=3", settings);
+    check(settings.detection == RANDOM_SEARCH_DETECTION, "search settings default detection");
+    check(parseFails("units=3; hours=4; speed=120"), "search settings without a width");
+    check(parseFails("units=2.5; hours=4; speed=120; width=1500"), "search settings with part of a unit");
+    check(parseFails("units=3; hours=-4; speed=120; width=1500"), "search settings with negative hours");
+    check(parseFails("units=3; hours=4; speed=120; width=1500; detection=sonar"), "search settings with an unknown detection");
+    check(parseFails("units=3; hours=4; speed=120; width=1500; height=2"), "search settings with an unknown setting");
+}
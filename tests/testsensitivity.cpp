@@ -0,0 +1,96 @@
+#include "tests.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "sensitivity.h"
+
+// Indices estimated from chunk sums built the way sensitivityThread() builds
+// them, for responses whose indices are known: an easting of 2 z0 + z1 and a
+// northing of z2 z3, which depends on z2 and z3 only together.
+void testSensitivity()
+{
+    ThreadParams params;
+    params.seed = 9;
+    const size_t numInputs = 6; // no flight or wind profile rows
+
+    auto response = [](const double* z, double* f)
+    {
+        f[0] = (2.0 * z[0]) + z[1];
+        f[1] = z[2] * z[3];
+    };
+
+    std::mt19937 rng(4);
+    std::normal_distribution<> norm;
+    for(int c = 0; c < 40; ++c)
+    {
+        SensitivityChunk chunk;
+        chunk.samples = 0.0;
+        for(int k = 0; k < 2; ++k)
+        {
+            chunk.sum[k]   = 0.0;
+            chunk.sumSq[k] = 0.0;
+        }
+        chunk.first.assign(2 * numInputs, 0.0);
+        chunk.total.assign(2 * numInputs, 0.0);
+        for(int i = 0; i < 1000; ++i)
+        {
+            double a[numInputs];
+            double b[numInputs];
+            for(size_t j = 0; j < numInputs; ++j)
+            {
+                a[j] = norm(rng);
+                b[j] = norm(rng);
+            }
+            double fa[2];
+            double fb[2];
+            response(a, fa);
+            response(b, fb);
+            chunk.samples += 1.0;
+            for(int k = 0; k < 2; ++k)
+            {
+                chunk.sum[k]   += fa[k] + fb[k];
+                chunk.sumSq[k] += (fa[k] * fa[k]) + (fb[k] * fb[k]);
+            }
+            for(size_t j = 0; j < numInputs; ++j)
+            {
+                double mixed[numInputs];
+                std::copy(a, a + numInputs, mixed);
+                mixed[j] = b[j];
+                double fab[2];
+                response(mixed, fab);
+                for(int k = 0; k < 2; ++k)
+                {
+                    size_t idx = (k * numInputs) + j;
+                    chunk.first[idx] += fb[k] * (fab[k] - fa[k]);
+                    chunk.total[idx] += (fa[k] - fab[k]) * (fa[k] - fab[k]);
+                }
+            }
+        }
+        params.sensitivityChunks.push_back(chunk);
+    }
+
+    std::vector<SobolIndex> indices;
+    sobolIndices(params, indices);
+    check((indices.size() == numInputs) && (indices[0].name == "Fix range"), "sensitivity inputs");
+
+    const double first[2][numInputs] = { { 0.8, 0.2, 0.0, 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 } };
+    const double total[2][numInputs] = { { 0.8, 0.2, 0.0, 0.0, 0.0, 0.0 }, { 0.0, 0.0, 1.0, 1.0, 0.0, 0.0 } };
+    bool estimates = true;
+    bool intervals = true;
+    for(size_t j = 0; j < indices.size(); ++j)
+    {
+        const SobolIndex& index = indices[j];
+        for(int k = 0; k < 2; ++k)
+        {
+            estimates = estimates && near(index.first[k], first[k][j], 0.05) && near(index.total[k], total[k][j], 0.05);
+            intervals = intervals &&
+                        (index.firstLow[k] <= index.first[k]) && (index.first[k] <= index.firstHigh[k]) &&
+                        (index.totalLow[k] <= index.total[k]) && (index.total[k] <= index.totalHigh[k]) &&
+                        (index.firstHigh[k] - index.firstLow[k] < 0.2) && (index.totalHigh[k] - index.totalLow[k] < 0.2);
+        }
+    }
+    check(estimates, "sensitivity indices");
+    check(intervals, "sensitivity intervals");
+}
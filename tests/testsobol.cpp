@@ -0,0 +1,70 @@
+#include "tests.h"
+
+#include <vector>
+
+#include "sobol.h"
+
+// The first points of the unscrambled sequence, its one-dimensional
+// stratification (which needs valid direction numbers, scrambled or not) and
+// starting part way through.
+void testSobol()
+{
+    SobolSequence plain;
+    plain.init(2, 0);
+    SobolGenerator gen(plain, 0);
+    const double expected[4][2] = { { 0.0, 0.0 }, { 0.5, 0.5 }, { 0.75, 0.25 }, { 0.25, 0.75 } };
+    const double halfCell = 0.5 / 4294967296.0;
+    for(int i = 0; i < 4; ++i)
+    {
+        double u[2];
+        gen.next(u);
+        check(near(u[0], expected[i][0] + halfCell, 1e-15) && near(u[1], expected[i][1] + halfCell, 1e-15), "Sobol first points");
+    }
+
+    const unsigned seeds[] = { 0, 12345 };
+    const int levels = 10;
+    for(int s = 0; s < 2; ++s)
+    {
+        SobolSequence seq;
+        seq.init(SobolSequence::maxDimensions, seeds[s]);
+        std::vector<double> points((1 << levels) * seq.dimensions());
+        SobolGenerator all(seq, 0);
+        for(int i = 0; i < (1 << levels); ++i)
+        {
+            all.next(&points[i * seq.dimensions()]);
+        }
+
+        // The first 2^m points put one in each of 2^m equal intervals.
+        bool stratified = true;
+        for(size_t d = 0; d < seq.dimensions(); ++d)
+        {
+            for(int m = 1; m <= levels; ++m)
+            {
+                std::vector<int> counts(1 << m, 0);
+                for(int i = 0; i < (1 << m); ++i)
+                {
+                    ++counts[int(points[(i * seq.dimensions()) + d] * (1 << m))];
+                }
+                for(int c = 0; c < (1 << m); ++c)
+                {
+                    stratified = stratified && (counts[c] == 1);
+                }
+            }
+        }
+        check(stratified, "Sobol stratification in every dimension");
+
+        const unsigned start = 37;
+        SobolGenerator part(seq, start);
+        std::vector<double> u(seq.dimensions());
+        bool same = true;
+        for(unsigned i = start; i < start + 100; ++i)
+        {
+            part.next(u.data());
+            for(size_t d = 0; d < seq.dimensions(); ++d)
+            {
+                same = same && (u[d] == points[(i * seq.dimensions()) + d]);
+            }
+        }
+        check(same, "Sobol generator started part way through");
+    }
+}
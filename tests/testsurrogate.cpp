@@ -0,0 +1,75 @@
+#include "tests.h"
+
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "surrogate.h"
+#include "util.h"
+
+// Fits of the surrogate: the degree chosen for the tracks there are, how
+// closely it follows tracks that depend smoothly on the inputs, that its check
+// rejects a fit to the full data set (whose crash position is far from
+// polynomial), and that a batch of samples evaluates as they would one by
+// one.
+void testSurrogate()
+{
+    ThreadParams params;
+    setupScenario(params);
+    params.gridCellsX    = 100;
+    params.gridCellsY    = 100;
+    params.metresPerCell = 1000.0;
+    params.gridOrigin    = Point2D(5000.0, -8000.0);
+
+    ThreadParams narrow = params;
+    narrowScenario(narrow, 0.05);
+    Surrogate surrogate;
+    surrogate.build(narrow, 2000, 4);
+    const size_t dims = inputCount(narrow);
+    check((surrogate.dimensions() == dims) && (surrogate.degree() == 3) &&
+          (surrogate.terms() == 1 + (3 * dims) + (3 * dims * (dims - 1) / 2)), "surrogate terms");
+    check((surrogate.successFraction() == 1.0) && (surrogate.check().samples == 400), "surrogate check tracks");
+    check(surrogate.acceptable() && (surrogate.check().rmsError < 25.0), "surrogate accuracy");
+
+    Surrogate small;
+    small.build(narrow, 300, 4);
+    check((small.degree() == 1) && (small.terms() == 1 + dims), "surrogate degree for few tracks");
+
+    bool threw = false;
+    try
+    {
+        Surrogate tiny;
+        tiny.build(narrow, 10, 4);
+    }
+    catch(const std::runtime_error&)
+    {
+        threw = true;
+    }
+    check(threw, "surrogate with too few tracks");
+
+    Surrogate full;
+    full.build(params, 2000, 4);
+    check(!full.acceptable(), "surrogate check of a poor fit");
+
+    const int count = 37;
+    std::mt19937 rng(6);
+    std::normal_distribution<> norm;
+    std::vector<double> z(count * dims);
+    for(size_t i = 0; i < z.size(); ++i)
+    {
+        z[i] = norm(rng);
+    }
+    std::vector<double> x(count);
+    std::vector<double> y(count);
+    std::vector<double> scratch;
+    surrogate.evaluate(z.data(), count, x.data(), y.data(), scratch);
+    bool same = true;
+    for(int i = 0; i < count; ++i)
+    {
+        double xi;
+        double yi;
+        surrogate.evaluate(&z[i * dims], 1, &xi, &yi, scratch);
+        same = same && near(xi, x[i], 1e-6) && near(yi, y[i], 1e-6);
+    }
+    check(same, "surrogate batch evaluation");
+}
@@ -0,0 +1,80 @@
+#include "tests.h"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "sweep.h"
+#include "units.h"
+
+namespace
+{
+
+bool expandFails(const ThreadParams& params, const std::string& spec)
+{
+    std::vector<SweepVariant> variants;
+    try
+    {
+        expandSweep(params, spec, variants);
+    }
+    catch(const std::runtime_error&)
+    {
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+// The variants a sweep expands to, the last setting varying fastest, and the
+// specifications it rejects.
+void testSweep()
+{
+    ThreadParams params;
+    params.fixRange        = Distribution(10000.0, 100.0);
+    params.fixBearing      = Distribution(0.5, 0.01);
+    params.aircraftHeading = Distribution(1.0, 0.1);
+    params.initialBankRate = Distribution(0.0, 0.001);
+    params.bankRateAccel   = Distribution(0.0, 0.0001);
+    params.windDirection   = Distribution(2.0, 0.1);
+    params.windProfile.addPoint(1000.0, 10.0, 2.0);
+    params.windProfile.addPoint(3000.0, 15.0, 3.0);
+    params.windProfile.setCorrelationLength(1500.0);
+    params.timeStep   = 1.0;
+    params.gridCellsX = 3;
+    params.gridCellsY = 2;
+
+    std::vector<SweepVariant> variants;
+    expandSweep(params, "fixBearing=-2,0,2; timeStep=0.5,1", variants);
+    check(variants.size() == 6, "sweep variant count");
+    bool ok = true;
+    for(size_t v = 0; v < variants.size(); ++v)
+    {
+        const SweepVariant& variant = variants[v];
+        double bearing = DEG2RAD(-2.0 + (2.0 * (v / 2)));
+        ok = ok && near(variant.scenario.fixBearing.mean(), 0.5 + bearing, 1e-12);
+        ok = ok && (variant.scenario.fixBearing.stdDev() == 0.01);
+        ok = ok && (variant.timeStep == ((v % 2 == 0) ? 0.5 : 1.0));
+        ok = ok && (variant.scenario.fixRange.mean() == 10000.0);
+        ok = ok && (variant.grid.size() == 6);
+    }
+    check(ok, "sweep variant settings");
+    check((variants[0].name == "fixBearing=-2 timeStep=0.5") && (variants[5].name == "fixBearing=2 timeStep=1"), "sweep variant names");
+
+    // Every row of the wind profile moves, keeping its spread and the
+    // correlation between the rows.
+    expandSweep(params, "windSpeed=10", variants);
+    const DistributionSet& wind = variants[0].scenario.windProfile;
+    check((wind.size() == 2) &&
+          near(wind[0].mean(), 10.0 + KnotsToMPS(10.0), 1e-12) &&
+          near(wind[1].mean(), 15.0 + KnotsToMPS(10.0), 1e-12) &&
+          (wind[1].stdDev() == 3.0) && (wind.x(1) == 3000.0) &&
+          (wind.correlationLength() == 1500.0), "swept wind speed");
+
+    check(expandFails(params, ""), "empty sweep");
+    check(expandFails(params, "altitude=1,2"), "sweep of an unknown setting");
+    check(expandFails(params, "fixRange=1,x"), "sweep value that isn't a number");
+    check(expandFails(params, "timeStep=0"), "sweep of a time step that isn't positive");
+    check(expandFails(params, "fixRange"), "sweep setting without values");
+    check(expandFails(params, "fixRange=1,2,3,4,5,6,7,8,9,10; heading=1,2,3,4,5,6,7,8,9,10; bankRate=1,2,3,4,5,6,7,8,9,10,11"), "sweep with too many variants");
+}
@@ -0,0 +1,61 @@
+#include "tests.h"
+
+#include <cmath>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "trackpath.h"
+
+// The cells a chain of segments passes over, against points taken densely
+// along it.
+void testTrackPath()
+{
+    const double metresPerCell = 1000.0;
+    const int cells = 50;
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<> start(-3000.0, 53000.0);
+    std::uniform_real_distribution<> move(-2500.0, 2500.0);
+    bool ok = true;
+    for(int trial = 0; trial < 300; ++trial)
+    {
+        TrackPath path;
+        path.setGrid(Point2D(0.0, 0.0), metresPerCell, cells, cells);
+        std::set<int> expected;
+        auto add = [&](double px, double py)
+        {
+            int col = int(floor((px / metresPerCell) + 0.5));
+            int row = int(floor((py / metresPerCell) + 0.5));
+            if((col >= 0) && (row >= 0) && (col < cells) && (row < cells))
+            {
+                expected.insert(col + (row * cells));
+            }
+        };
+
+        double x = start(rng);
+        double y = start(rng);
+        path.begin(x, y);
+        add(x, y);
+        for(int s = 0; s < 10; ++s)
+        {
+            // Some chains are nearly or exactly along the grid lines.
+            double nx = x + move(rng) * ((trial % 3 == 0) ? 0.05 : 1.0);
+            double ny = y + move(rng) * ((trial % 5 == 0) ? 0.0 : 1.0);
+            if(trial % 7 == 0)
+            {
+                nx = x;
+            }
+            path.addSegment(x, y, nx, ny);
+            const int samples = 20000;
+            for(int k = 1; k <= samples; ++k)
+            {
+                add(x + ((nx - x) * k / samples), y + ((ny - y) * k / samples));
+            }
+            x = nx;
+            y = ny;
+        }
+        path.finish();
+        ok = ok && (std::vector<int>(expected.begin(), expected.end()) == path.cells());
+    }
+    check(ok, "swept path cells");
+}
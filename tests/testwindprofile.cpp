@@ -0,0 +1,53 @@
+#include "tests.h"
+
+#include <cmath>
+#include <vector>
+
+#include "distributionset.h"
+#include "pointset.h"
+
+// The correlation factor of a wind profile, recovered column by column from
+// unit deviates, multiplies out to the correlation matrix.
+void testCholesky()
+{
+    const double length   = 2000.0;
+    const double x[]      = { 0.0, 1000.0, 2500.0, 3000.0, 4000.0, 9000.0 };
+    const double stdDev[] = { 1.0, 2.0,    0.5,    0.0,    1.0,    3.0 };
+    const size_t n        = sizeof(x) / sizeof(x[0]);
+    DistributionSet set;
+    for(size_t i = 0; i < n; ++i)
+    {
+        set.addPoint(x[i], 10.0 * i, stdDev[i]);
+    }
+    set.setCorrelationLength(length);
+
+    // Column j of the factor, scaled by the standard deviations.
+    std::vector<std::vector<double> > columns(n, std::vector<double>(n));
+    for(size_t j = 0; j < n; ++j)
+    {
+        std::vector<double> z(n, 0.0);
+        z[j] = 1.0;
+        PointSet points;
+        set.fromNormals(z.data(), points);
+        for(size_t i = 0; i < n; ++i)
+        {
+            columns[j][i] = points[i].y_ - (10.0 * i);
+        }
+    }
+
+    bool ok = true;
+    for(size_t a = 0; a < n; ++a)
+    {
+        for(size_t b = 0; b < n; ++b)
+        {
+            double cov = 0.0;
+            for(size_t j = 0; j < n; ++j)
+            {
+                cov += columns[j][a] * columns[j][b];
+            }
+            double expected = stdDev[a] * stdDev[b] * exp(-fabs(x[a] - x[b]) / length);
+            ok = ok && near(cov, expected, 1e-12);
+        }
+    }
+    check(ok, "Cholesky factor of the wind correlation");
+}
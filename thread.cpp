@@ -1,69 +1,330 @@
 #include "thread.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "units.h"
 #include "util.h"
 #include "point3d.h"
+#include "sampler.h"
+#include "multilevel.h"
+#include "ensemble.h"
+
+namespace
+{
+
+struct BinJob
+{
+    const ThreadParams* params;
+    size_t              begin;
+    size_t              end;
+    std::vector<double> grid;
+};
+
+void* binThread(void* param)
+{
+    BinJob* job = reinterpret_cast<BinJob*>(param);
+    const ThreadParams& tp = *job->params;
+
+    const bool weighted = !tp.sampleWeights.empty();
+    job->grid.assign(tp.gridCellsX * tp.gridCellsY, 0.0);
+    for(size_t i = job->begin; i < job->end; ++i)
+    {
+        int idx = gridIndex(tp, tp.crashPoints[i]);
+        if(idx >= 0)
+        {
+            job->grid[idx] += weighted ? tp.sampleWeights[i] : 1.0;
+        }
+    }
+    return NULL;
+}
+
+} // namespace
+
+int gridIndex(const ThreadParams& params, const Point2D& pos)
+{
+    int col = std::round((pos.x_ - params.gridOrigin.x_) / params.metresPerCell);
+    int row = std::round((pos.y_ - params.gridOrigin.y_) / params.metresPerCell);
+    if((col >= 0) && (row >= 0) && (col < params.gridCellsX) && (row < params.gridCellsY))
+    {
+        return col + (row * params.gridCellsX);
+    }
+    return -1;
+}
+
+void publishChanges(ThreadParams& params, std::vector<GridChange>& changes)
+{
+    if(params.previewChanges && !changes.empty())
+    {
+        pthread_mutex_lock(&params.previewMutex);
+        params.gridChanges.insert(params.gridChanges.end(), changes.begin(), changes.end());
+        pthread_mutex_unlock(&params.previewMutex);
+    }
+    changes.clear();
+}
+
+void takeChanges(ThreadParams& params, std::vector<GridChange>& changes)
+{
+    changes.clear();
+    pthread_mutex_lock(&params.previewMutex);
+    changes.swap(params.gridChanges);
+    pthread_mutex_unlock(&params.previewMutex);
+}
+
+void runChunks(
+        ThreadParams&                                        params,
+        CrashStats&                                          stats,
+        const std::function<void(int, int)>&                 runChunk,
+        const std::function<void(std::vector<GridChange>&)>& mergeChunk
+        )
+{
+    // Help with the standard deviation tracks before starting on the
+    // samples.
+    if(params.stdTracks)
+    {
+        runStdTrackJobs(params, *params.stdTracks, params.mutex);
+    }
+
+    std::vector<GridChange> changes;
+    int count = 0;
+    for(;;)
+    {
+        pthread_mutex_lock(&params.mutex);
+
+        // Merge the results of the last chunk.
+        if(count > 0)
+        {
+            mergeChunk(changes);
+        }
+        params.completed += count;
+
+        // Claim the next one.
+        int begin = params.nextIteration;
+        int end   = std::min(begin + chunkSize, params.totalIterations);
+        bool done = params.cancelRequested || (begin >= end);
+        if(done)
+        {
+            params.stats.merge(stats);
+            --params.threadsRunning;
+        }
+        params.nextIteration = end;
+
+        pthread_mutex_unlock(&params.mutex);
+        publishChanges(params, changes);
+
+        if(done)
+            break;
+
+        runChunk(begin, end);
+        count = end - begin;
+    }
+}
 
 void* workerThread(void* params)
 {
     ThreadParams* tp = reinterpret_cast<ThreadParams*>(params);
 
-    PointSet altitudeTrack;
-    PointSet planeSpeeds;
+    // The wind field and terrain caches belong to one scenario, so each
+    // scenario has its own scratch space.
+    std::vector<SampleProfiles> scenarioProfiles(std::max<size_t>(1, tp->scenarios.size()));
+    std::vector<double> z(runInputCount(*tp));
+    std::vector<Point2D> crashes;
+    std::vector<Point2D> coarseCrashes;
+    std::vector<Point2D> snapshots; // snapshotTimes.size() per sample
+    std::vector<int> pathCells;
+    const size_t numSnapshots = tp->snapshotTimes.size();
+    std::vector<float> inputs;
+    CrashStats stats(tp->stats.centre(), tp->stats.halfWidth());
+    crashes.reserve(chunkSize);
+    if(tp->storeInputs)
+    {
+        inputs.reserve(chunkSize * z.size());
+    }
 
-    bool abort = tp->cancelRequested;
     int count = 0;
-    for(int i = 0; i < tp->iterationsPerThread; ++i, ++count)
+    int level = 0;
+    int scenario = -1;
+    auto runChunk = [&](int begin, int end)
     {
-        Point3D crashPos;
-        try
+        // The levels and scenarios of the chunks are fixed for the run.
+        if(tp->mlmcLevels > 0)
         {
-            double time = createPointSets(*tp, true, 0.0, altitudeTrack, planeSpeeds);
-            crashPos = CalcTrack(
-                        tp->towerLocation,
-                        tp->timeStep,
-                        altitudeTrack,
-                        tp->fixRange.sample(),
-                        tp->fixBearing.sample(),
-                        time,
-                        tp->aircraftHeading.sample(),
-                        tp->initialBankRate.sample(),
-                        tp->bankRateAccel.sample(),
-                        tp->windDirection.sample(),
-                        tp->windProfile.sample(),
-                        planeSpeeds
-                        );
+            level = tp->chunkLevels[begin / chunkSize];
         }
-        catch(...)
+        else if(!tp->chunkScenarios.empty())
         {
-            continue;
+            scenario = tp->chunkScenarios[begin / chunkSize];
         }
 
-        pthread_mutex_lock(&tp->mutex);
-
-        int col = std::round((crashPos.x_ - tp->gridOrigin.x_) / tp->metresPerCell);
-        int row = std::round((crashPos.y_ - tp->gridOrigin.y_) / tp->metresPerCell);
-        if((col >= 0) && (row >= 0) && (col < tp->gridCellsX) && (row < tp->gridCellsY))
+        ChunkSampler sampler(*tp, begin, end);
+        const Scenario& model    = chunkScenario(*tp, begin);
+        SampleProfiles& profiles = scenarioProfiles[std::max(0, scenario)];
+        if(level == 0)
         {
-            int idx = col + (row * tp->gridCellsX);
-            tp->grid[idx] += 1.0;
+            profiles.snapshots.times = tp->snapshotTimes;
+            profiles.path.setGrid(tp->gridOrigin, tp->metresPerCell, tp->sweptPath ? tp->gridCellsX : 0, tp->gridCellsY);
         }
-        if(count >= 100)
+        else
         {
-            tp->completed += count;
-            count          = 0;
+            profiles.snapshots.times.clear();
+            profiles.path.setGrid(tp->gridOrigin, tp->metresPerCell, 0, 0);
         }
-        abort = tp->cancelRequested;
+        double fineStep   = (tp->mlmcLevels > 0) ? levelTimeStep(*tp, level) : tp->timeStep;
+        double coarseStep = 2.0 * fineStep;
+        double weight     = (scenario >= 0) ? tp->scenarioSampleWeights[scenario] : 1.0;
 
-        pthread_mutex_unlock(&tp->mutex);
+        crashes.clear();
+        coarseCrashes.clear();
+        snapshots.clear();
+        pathCells.clear();
+        inputs.clear();
+        count = end - begin;
+        for(int i = begin; i < end; ++i)
+        {
+            sampler.next(z.data());
 
-        if(abort)
-            break;
-    }
+            Point3D crashPos;
+            Point3D coarsePos;
+            try
+            {
+                crashPos = CalcSample(model, tp->integrator, z.data(), profiles, fineStep);
+                if(level > 0)
+                {
+                    coarsePos = CalcSample(model, tp->integrator, z.data(), profiles, coarseStep);
+                }
+            }
+            catch(...)
+            {
+                continue;
+            }
+            crashes.push_back(crashPos);
+            if(level == 0)
+            {
+                stats.add(crashPos, weight);
+                snapshots.insert(snapshots.end(), profiles.snapshots.positions.begin(), profiles.snapshots.positions.end());
+                pathCells.insert(pathCells.end(), profiles.path.cells().begin(), profiles.path.cells().end());
+            }
+            if(level > 0)
+            {
+                coarseCrashes.push_back(coarsePos);
+            }
+            if(tp->storeInputs)
+            {
+                inputs.insert(inputs.end(), z.begin(), z.end());
+            }
+        }
+    };
 
-    pthread_mutex_lock(&tp->mutex);
-    tp->completed += count;
-    pthread_mutex_unlock(&tp->mutex);
+    auto mergeChunk = [&](std::vector<GridChange>& changes)
+    {
+        if(tp->mlmcLevels > 0)
+        {
+            // A finer level adds its crash positions and takes away those at
+            // the coarser step.
+            std::vector<double>& grid = tp->levelGrids[level];
+            for(size_t i = 0; i < crashes.size(); ++i)
+            {
+                int idx = gridIndex(*tp, crashes[i]);
+                if(idx >= 0)
+                {
+                    grid[idx] += 1.0;
+                    changes.push_back(GridChange{ level, idx, 1.0 });
+                }
+                if(level > 0)
+                {
+                    idx = gridIndex(*tp, coarseCrashes[i]);
+                    if(idx >= 0)
+                    {
+                        grid[idx] -= 1.0;
+                        changes.push_back(GridChange{ level, idx, -1.0 });
+                    }
+                }
+            }
+            tp->levelCompleted[level] += count;
+        }
+        else
+        {
+            // The samples of an ensemble run are weighted by scenario.
+            double weight = (scenario >= 0) ? tp->scenarioSampleWeights[scenario] : 1.0;
+            double sumX = 0.0;
+            double sumY = 0.0;
+            for(auto i = crashes.begin(); i != crashes.end(); ++i)
+            {
+                int idx = gridIndex(*tp, *i);
+                if(idx >= 0)
+                {
+                    tp->grid[idx] += weight;
+                    changes.push_back(GridChange{ 0, idx, weight });
+                }
+
+                double x = i->x_ - tp->gridOrigin.x_;
+                double y = i->y_ - tp->gridOrigin.y_;
+                sumX += x;
+                sumY += y;
+                tp->moments.sumSqX += x * x;
+                tp->moments.sumSqY += y * y;
+            }
+            if(!crashes.empty())
+            {
+                ChunkMoments& m = tp->moments;
+                m.samples  += crashes.size();
+                m.sumX     += sumX;
+                m.sumY     += sumY;
+                m.chunkSqX += (sumX * sumX) / crashes.size();
+                m.chunkSqY += (sumY * sumY) / crashes.size();
+                ++m.chunks;
+            }
+            if(tp->storeInputs)
+            {
+                tp->crashPoints.insert(tp->crashPoints.end(), crashes.begin(), crashes.end());
+                tp->sampleInputs.insert(tp->sampleInputs.end(), inputs.begin(), inputs.end());
+            }
+            if(scenario >= 0)
+            {
+                tp->scenarioCompleted[scenario] += count;
+            }
+        }
 
+        // The snapshot positions and path cells of the samples, if wanted.
+        double sampleWeight = (scenario >= 0) ? tp->scenarioSampleWeights[scenario] : 1.0;
+        for(size_t i = 0; i < snapshots.size(); ++i)
+        {
+            int idx = gridIndex(*tp, snapshots[i]);
+            if(idx >= 0)
+            {
+                tp->snapshotGrids[i % numSnapshots][idx] += sampleWeight;
+            }
+        }
+        for(size_t i = 0; i < pathCells.size(); ++i)
+        {
+            tp->pathGrid[pathCells[i]] += sampleWeight;
+        }
+    };
+
+    runChunks(*tp, stats, runChunk, mergeChunk);
     return NULL;
 }
+
+void binCrashPoints(ThreadParams& params, int numThreads)
+{
+    const size_t numPoints = params.crashPoints.size();
+    std::vector<BinJob> jobs(numThreads);
+    std::vector<pthread_t> ids(numThreads);
+    for(int i = 0; i < numThreads; ++i)
+    {
+        jobs[i].params = &params;
+        jobs[i].begin  = (numPoints * i) / numThreads;
+        jobs[i].end    = (numPoints * (i + 1)) / numThreads;
+        pthread_create(&ids[i], NULL, binThread, &jobs[i]);
+    }
+
+    params.grid.assign(params.gridCellsX * params.gridCellsY, 0.0);
+    for(int i = 0; i < numThreads; ++i)
+    {
+        pthread_join(ids[i], NULL);
+        for(size_t c = 0; c < params.grid.size(); ++c)
+        {
+            params.grid[c] += jobs[i].grid[c];
+        }
+    }
+}
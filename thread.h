@@ -1,10 +1,32 @@
 #ifndef THREAD_H
 #define THREAD_H
 
+#include <functional>
+#include <memory>
+#include <string>
 #include <vector>
 #include <pthread.h>
 #include "pointset.h"
 #include "distributionset.h"
+#include "sobol.h"
+#include "windfield.h"
+#include "terrain.h"
+#include "crashstats.h"
+
+struct StdTracks;
+class Surrogate;
+
+// Number of iterations a worker claims at a time.
+const int chunkSize = 1000;
+
+// A change a chunk made to the grid, or to levelGrids[level] in a multilevel
+// run.
+struct GridChange
+{
+    int    level;
+    int    idx;
+    double weight;
+};
 
 struct FlightPoint
 {
@@ -13,13 +35,44 @@ struct FlightPoint
     Distribution speed;
 };
 
-struct ThreadParams
+// How the random inputs of the iterations are chosen.
+enum Sampling
 {
-    int          totalIterations;
-    int          iterationsPerThread;
-    Point2D      towerLocation;
-    double       timeStep;
+    RANDOM_SAMPLING,          // independent pseudo-random draws
+    SOBOL_SAMPLING,           // scrambled Sobol low-discrepancy sequence
+    LATIN_HYPERCUBE_SAMPLING, // each input stratified within each chunk
+    ANTITHETIC_SAMPLING       // pairs of iterations with mirrored inputs
+};
+
+// How CalcTrack advances the aircraft over each time step.
+enum Integrator
+{
+    EULER_INTEGRATOR, // heading then position, using the values at the end of the step
+    RK4_INTEGRATOR,   // fourth order Runge-Kutta with the exact heading
+    ARC_INTEGRATOR    // circular arc at the step's average turn rate
+};
 
+// Sums of the crash positions (relative to the grid origin) over all samples
+// and over the means of each chunk. Comparing the spread of the chunk means
+// with that expected from independent samples estimates the variance
+// reduction achieved by the sampling scheme.
+struct ChunkMoments
+{
+    double samples;
+    double sumX;
+    double sumY;
+    double sumSqX;
+    double sumSqY;
+    double chunkSqX; // sum over chunks of n * mean^2
+    double chunkSqY;
+    int    chunks;
+};
+
+// The model of one data set: where the aircraft was seen and the
+// distributions of everything that happened afterwards.
+struct Scenario
+{
+    Point2D      towerLocation;
     Distribution fixRange;
     Distribution fixBearing;
     Distribution aircraftHeading;
@@ -29,16 +82,190 @@ struct ThreadParams
     DistributionSet windProfile;
     std::vector<FlightPoint> flightProfile;
 
+    // Replaces the wind profile if set (see WindField).
+    std::shared_ptr<WindField> windField;
+
+    // Ends the tracks where they reach the ground if set.
+    std::shared_ptr<Terrain> terrain;
+};
+
+// Sums over the samples of one variant of a sweep: the crash positions
+// (relative to the grid origin) and their differences from the first variant
+// on the same inputs.
+struct SweepMoments
+{
+    double samples;
+    double sumX;
+    double sumY;
+    double sumSqX;
+    double sumSqY;
+    double diffX;
+    double diffY;
+    double diffSqX;
+    double diffSqY;
+};
+
+// One combination of the swept settings (see expandSweep()).
+struct SweepVariant
+{
+    std::string         name;
+    Scenario            scenario;
+    double              timeStep;
+    std::vector<double> grid;
+    SweepMoments        moments;
+};
+
+// Sums over one chunk of a sensitivity run (see sensitivity.h) for the crash
+// easting [0] and northing [1], relative to the centre of the grid. first and
+// total hold the pick-freeze sums for each input, easting then northing.
+struct SensitivityChunk
+{
+    double              samples;
+    double              sum[2];
+    double              sumSq[2];
+    std::vector<double> first;
+    std::vector<double> total;
+};
+
+// The scenario of the current data set, and the settings and progress of a
+// run.
+struct ThreadParams : public Scenario
+{
+    int          totalIterations;
+    double       timeStep;
+    Integrator   integrator;
+
+    // An ensemble run samples a weighted mixture of scenarios instead of the
+    // one above, each chunk of iterations being simulated with the scenario
+    // given by chunkScenarios and each of its samples counting
+    // scenarioSampleWeights in the grid (see setupScenarios()). Empty for a
+    // normal run.
+    std::vector<Scenario> scenarios;
+    std::vector<double>   scenarioWeights;
+    std::vector<double>   scenarioSampleWeights;
+    std::vector<int>      chunkScenarios;
+    std::vector<int>      scenarioCompleted;
+
+    // A sweep runs every variant on each sample's inputs (common random
+    // numbers) so that the differences between the variants aren't swamped by
+    // sampling noise. The workers are sweepThread() rather than workerThread()
+    // and grid follows the first variant. Empty for a normal run.
+    std::vector<SweepVariant> sweepVariants;
+
+    // A sensitivity run estimates the Sobol indices of the crash position
+    // instead. The workers are sensitivityThread() and each iteration costs
+    // inputCount() + 2 tracks.
+    bool                          sensitivity;
+    std::vector<SensitivityChunk> sensitivityChunks;
+
+    // Statistics of the crash positions, merged from each worker as it
+    // finishes. Set up with the centre and extent of the histograms before
+    // the run. Multilevel runs count their coarsest level only.
+    CrashStats stats;
+
+    // Samples a polynomial chaos surrogate of the tracks instead of the
+    // tracks themselves if set (see Surrogate).
+    std::shared_ptr<Surrogate> surrogate;
+
+    // Standard deviation track jobs the workers run before their samples, if
+    // set (see prepareStdTracks()).
+    StdTracks* stdTracks;
+
     pthread_mutex_t mutex;
     bool            cancelRequested;
     int             completed;
+    int             nextIteration;
+    int             threadsRunning;
+    unsigned        seed;
+    Sampling        sampling;
+    SobolSequence   sobol;
+    ChunkMoments    moments;
     int             gridCellsX;
     int             gridCellsY;
     double          metresPerCell;
     Point2D         gridOrigin;
     std::vector<double> grid;
+
+    // With previewChanges the workers also pass the changes each chunk makes
+    // to the grid on to gridChanges, for the preview to apply to its own copy
+    // (see takeChanges()). gridChanges has its own lock so that the preview
+    // never holds mutex, which the workers need to merge their chunks.
+    bool                    previewChanges;
+    pthread_mutex_t         previewMutex;
+    std::vector<GridChange> gridChanges;
+
+    // Where the aircraft was at each of snapshotTimes (s after the fix,
+    // ascending): snapshotGrids holds a grid like grid for each time,
+    // filled in by workerThread() from the same tracks. A sample that has
+    // crashed by a snapshot time counts where it crashed. Multilevel runs
+    // count their coarsest level only. Empty for no snapshots.
+    std::vector<double>               snapshotTimes;
+    std::vector<std::vector<double> > snapshotGrids;
+
+    // With sweptPath, pathGrid counts the samples whose tracks passed over
+    // each cell (see TrackPath), weighted like grid. Multilevel runs count
+    // their coarsest level only.
+    bool                sweptPath;
+    std::vector<double> pathGrid;
+
+    // Multilevel Monte Carlo. With mlmcLevels > 0 the run is split into
+    // levels 0..mlmcLevels, level l integrating with a time step of
+    // timeStep * 2^(mlmcLevels - l). Level 0 simulates every sample at the
+    // coarsest step; each higher level simulates fewer samples at both its own
+    // step and the next coarser one, using the same inputs, and records the
+    // difference. levelGrids holds the sums for each level; they're combined
+    // into grid (see combineLevels()) when the run ends, not as it goes.
+    // chunkLevels gives the level of each chunk of iterations.
+    int                              mlmcLevels;
+    std::vector<int>                 chunkLevels;
+    std::vector<int>                 levelCompleted;
+    std::vector<std::vector<double> > levelGrids;
+
+    // When storeInputs is set the crash position of every sample in the last
+    // run is kept, so that the grid can be rebuilt for new cell settings
+    // without re-simulating, along with its standard normal deviates
+    // (inputCount() per point), so that the samples can be reweighted for
+    // updated distributions. sampleWeights holds one weight per crash point,
+    // or is empty if all samples count equally.
+    bool                 storeInputs;
+    std::vector<Point2D> crashPoints;
+    std::vector<float>   sampleInputs;
+    std::vector<double>  sampleWeights;
 };
 
+// Returns the index of the grid cell containing the given position, or -1 if
+// the position is outside the grid.
+int gridIndex(const ThreadParams& params, const Point2D& pos);
+
+// Adds the changes a chunk made to the grid to gridChanges, if they're
+// wanted, and clears them. Call without holding mutex.
+void publishChanges(ThreadParams& params, std::vector<GridChange>& changes);
+
+// Swaps out the changes published since the last call.
+void takeChanges(ThreadParams& params, std::vector<GridChange>& changes);
+
+// The loop of every kind of worker: the standard deviation track jobs first,
+// then chunks of iterations claimed until the run is complete or cancelled.
+// runChunk(begin, end) simulates a chunk without the lock; mergeChunk then
+// adds its results to params with mutex held, listing the changes it makes
+// to the grid for the preview. When the worker is done, stats is merged into
+// params.stats and threadsRunning is decremented.
+void runChunks(
+        ThreadParams&                                        params,
+        CrashStats&                                          stats,
+        const std::function<void(int, int)>&                 runChunk,
+        const std::function<void(std::vector<GridChange>&)>& mergeChunk
+        );
+
+// Worker threads claim chunks of iterations until the run is complete or
+// cancelled. The results of each chunk are merged into the grid (and the
+// stored samples) as soon as the chunk is done, so the grid can be previewed
+// while the run progresses. threadsRunning must be set to the number of
+// workers before they are started; each decrements it when it exits.
 void* workerThread(void* params);
 
+// Rebuilds the grid from the stored crash points using the current grid
+// origin, size and cell size. The points are binned by several threads.
+void binCrashPoints(ThreadParams& params, int numThreads);
+
 #endif // THREAD_H
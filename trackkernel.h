@@ -0,0 +1,590 @@
+#ifndef TRACKKERNEL_H
+#define TRACKKERNEL_H
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+#include "pointset.h"
+#include "point3d.h"
+#include "track3d.h"
+#include "windfield.h"
+#include "terrain.h"
+#include "trackpath.h"
+
+// The Euler integration loop of CalcTrack, specialised at compile time on the
+// shape of each profile, the source of the wind, whether there is terrain,
+// whether positions at snapshot times or the cells passed over are wanted
+// and whether the track is recorded, so that the Monte Carlo path has no
+// per-step branches on things that are fixed for the whole run. Use
+// eulerTrack() to pick the specialisation for a set of profiles.
+
+// The sine and cosine of an angle, advanced by rotating through another
+// angle's sine and cosine rather than by evaluating sin() and cos() again.
+// Each rotation puts an error of a few parts in 1e16 into the length and the
+// angle. The length is pulled back to one every renormaliseSteps rotations
+// (between times it drifts by less than 1e-13), and the angle error grows
+// linearly, staying below 1e-9 radians after a million rotations.
+struct Rotor
+{
+    double s;
+    double c;
+
+    void set(double angle)
+    {
+        s = sin(angle);
+        c = cos(angle);
+    }
+
+    void rotate(const Rotor& by)
+    {
+        double ns = (s * by.c) + (c * by.s);
+        c         = (c * by.c) - (s * by.s);
+        s         = ns;
+    }
+
+    // One Newton step towards unit length, which is plenty this close to it.
+    void renormalise()
+    {
+        double f = 1.5 - 0.5 * ((s * s) + (c * c));
+        s *= f;
+        c *= f;
+    }
+
+    static const int renormaliseSteps = 64;
+};
+
+// A profile with a single point.
+class ConstantProfile
+{
+public:
+    explicit ConstantProfile(const PointSet& set) : y_(set[0].y_) {}
+
+    double operator () (double) const { return y_; }
+
+private:
+    double y_;
+};
+
+// A profile with two points, extrapolated either side.
+class LinearProfile
+{
+public:
+    explicit LinearProfile(const PointSet& set) :
+        x0_(set[0].x_),
+        y0_(set[0].y_),
+        slope_((set[1].y_ - set[0].y_) / (set[1].x_ - set[0].x_))
+    {
+    }
+
+    double operator () (double x) const { return slope_ * (x - x0_) + y0_; }
+
+private:
+    double x0_;
+    double y0_;
+    double slope_;
+};
+
+// A profile with three or more points, interpolated like
+// PointSet::interpolate(). The slopes are worked out up front, and as
+// successive lookups are close together the segment is found by walking from
+// the last one rather than by searching.
+class TableProfile
+{
+public:
+    static const int maxPoints = 32;
+
+    explicit TableProfile(const PointSet& set) : last_(set.size() - 2), idx_(0)
+    {
+        for(int i = 0; i <= last_; ++i)
+        {
+            x_[i]     = set[i].x_;
+            y_[i]     = set[i].y_;
+            slope_[i] = (set[i + 1].y_ - set[i].y_) / (set[i + 1].x_ - set[i].x_);
+        }
+        x_[last_ + 1] = set[last_ + 1].x_;
+    }
+
+    double operator () (double x)
+    {
+        while((idx_ > 0) && (x < x_[idx_]))
+        {
+            --idx_;
+        }
+        while((idx_ < last_) && (x > x_[idx_ + 1]))
+        {
+            ++idx_;
+        }
+        return slope_[idx_] * (x - x_[idx_]) + y_[idx_];
+    }
+
+private:
+    int  last_;
+    int  idx_;
+    double x_[maxPoints];
+    double y_[maxPoints];
+    double slope_[maxPoints];
+};
+
+// Any other profile.
+class SetProfile
+{
+public:
+    explicit SetProfile(const PointSet& set) : set_(set) {}
+
+    double operator () (double x) const { return set_.interpolate(x); }
+
+private:
+    const PointSet& set_;
+};
+
+// Wind from a speed profile (by altitude) and a single direction.
+template<class Profile>
+class ProfileWind
+{
+public:
+    ProfileWind(const Profile& speed, double sinWind, double cosWind) :
+        speed_(speed),
+        sinWind_(sinWind),
+        cosWind_(cosWind)
+    {
+    }
+
+    void operator () (double, double, double altitude, double, double& wx, double& wy)
+    {
+        double windSpeed = speed_(altitude);
+        wx = windSpeed * cosWind_;
+        wy = windSpeed * sinWind_;
+    }
+
+private:
+    Profile speed_;
+    double  sinWind_;
+    double  cosWind_;
+};
+
+// Wind from a gridded field, turned by the sample's deviation from the mean
+// wind direction. Positions are relative to the fix.
+class FieldWind
+{
+public:
+    FieldWind(const WindField& field, WindFieldCache& cache, double fixX, double fixY, double turn) :
+        field_(field),
+        cache_(cache),
+        fixX_(fixX),
+        fixY_(fixY),
+        sinTurn_(sin(turn)),
+        cosTurn_(cos(turn))
+    {
+    }
+
+    void operator () (double x, double y, double altitude, double time, double& wx, double& wy)
+    {
+        double u;
+        double v;
+        field_.velocity(cache_, fixX_ + x, fixY_ + y, altitude, time, u, v);
+        wx = (u * cosTurn_) + (v * sinTurn_);
+        wy = (v * cosTurn_) - (u * sinTurn_);
+    }
+
+private:
+    const WindField& field_;
+    WindFieldCache&  cache_;
+    double           fixX_;
+    double           fixY_;
+    double           sinTurn_;
+    double           cosTurn_;
+};
+
+// No terrain: tracks run to the end of the flight.
+class NoGround
+{
+public:
+    static const bool enabled = false;
+
+    double operator () (double, double) const { return 0; }
+};
+
+// Ground heights from a terrain model. Positions are relative to the fix.
+class TerrainGround
+{
+public:
+    static const bool enabled = true;
+
+    TerrainGround(const Terrain& terrain, TerrainCache& cache, double fixX, double fixY) :
+        terrain_(terrain),
+        cache_(cache),
+        fixX_(fixX),
+        fixY_(fixY)
+    {
+    }
+
+    double operator () (double x, double y) const { return terrain_.height(cache_, fixX_ + x, fixY_ + y); }
+
+private:
+    const Terrain& terrain_;
+    TerrainCache&  cache_;
+    double         fixX_;
+    double         fixY_;
+};
+
+// The positions of the aircraft at set times after the fix, filled in as the
+// track passes each one. Times after the end of the track get its last
+// position, as the wreck stays where it crashed.
+struct TrackSnapshots
+{
+    std::vector<double>  times;     // s after the fix, ascending
+    std::vector<Point2D> positions;
+};
+
+// Watches nothing.
+class NoObserver
+{
+public:
+    static const bool enabled = false;
+
+    void begin(double, double) {}
+    void step(double, double, double, double, double, double) {}
+    void finish(double, double) {}
+};
+
+// Records the positions at the snapshot times, interpolating within the
+// step that passes each one, and the cells the track passes over, for
+// whichever of the two are given. Positions are relative to the given origin.
+class TrackObserver
+{
+public:
+    static const bool enabled = true;
+
+    TrackObserver(TrackSnapshots* snapshots, TrackPath* path, double originX, double originY) :
+        snapshots_(snapshots),
+        path_(path),
+        originX_(originX),
+        originY_(originY),
+        next_(0)
+    {
+        if(snapshots_ != NULL)
+        {
+            snapshots_->positions.resize(snapshots_->times.size());
+        }
+    }
+
+    void begin(double x, double y)
+    {
+        if(path_ != NULL)
+        {
+            path_->begin(originX_ + x, originY_ + y);
+        }
+    }
+
+    // The aircraft moved from (lastX, lastY) to (x, y) between lastTime and
+    // time.
+    void step(double lastTime, double time, double lastX, double lastY, double x, double y)
+    {
+        if(snapshots_ != NULL)
+        {
+            while((next_ < snapshots_->times.size()) && (snapshots_->times[next_] <= time))
+            {
+                double f = (time > lastTime) ? (snapshots_->times[next_] - lastTime) / (time - lastTime) : 1;
+                snapshots_->positions[next_] = Point2D(originX_ + lastX + f * (x - lastX), originY_ + lastY + f * (y - lastY));
+                ++next_;
+            }
+        }
+        if(path_ != NULL)
+        {
+            path_->addSegment(originX_ + lastX, originY_ + lastY, originX_ + x, originY_ + y);
+        }
+    }
+
+    void finish(double x, double y)
+    {
+        if(snapshots_ != NULL)
+        {
+            for(; next_ < snapshots_->times.size(); ++next_)
+            {
+                snapshots_->positions[next_] = Point2D(originX_ + x, originY_ + y);
+            }
+        }
+        if(path_ != NULL)
+        {
+            path_->finish();
+        }
+    }
+
+private:
+    TrackSnapshots*   snapshots_;
+    TrackPath*        path_;
+    double            originX_;
+    double            originY_;
+    size_t            next_;
+};
+
+// The optional gridded wind and terrain, with the calling thread's caches
+// for looking them up.
+struct TrackEnvironment
+{
+    TrackEnvironment() :
+        windField(NULL),
+        windCache(NULL),
+        windTurn(0.0),
+        terrain(NULL),
+        terrainCache(NULL),
+        snapshots(NULL),
+        path(NULL)
+    {
+    }
+
+    const WindField*  windField;    // replaces the wind profile if set
+    WindFieldCache*   windCache;
+    double            windTurn;     // sampled wind direction less its mean
+    const Terrain*    terrain;      // ends the track at the ground if set
+    TerrainCache*     terrainCache;
+    TrackSnapshots*   snapshots;    // filled in if set
+    TrackPath*        path;         // filled in if set
+};
+
+// The state of the aircraft at the fix.
+struct TrackStart
+{
+    double x;
+    double y;
+    double timeStep;
+    double elapsedTime;
+    double heading;
+    double bankRate;
+    double bankRateAccel;
+    double sinWind;
+    double cosWind;
+};
+
+template<bool RecordTrack, class Altitude, class Speed, class Wind, class Ground, class Observer>
+Point3D eulerLoop(const TrackStart& start, Altitude altitudeAt, Speed speedAt, Wind windAt, Ground groundAt, Observer observer, Track3D* track)
+{
+    const double timeStep    = start.timeStep;
+    const double elapsedTime = start.elapsedTime;
+    const double accel       = start.bankRateAccel;
+    double x        = 0;
+    double y        = 0;
+    double z        = 0;
+    double time     = 0;
+    double heading  = start.heading;
+    double bankRate = start.bankRate;
+
+    // Each whole step turns through bankRate * timeStep, and that angle grows
+    // by bankRateAccel * timeStep^2 each step. Rotating by these keeps sin()
+    // and cos() out of the loop.
+    Rotor direction;
+    Rotor turn;
+    Rotor turnChange;
+    direction.set(heading);
+    turn.set(bankRate * timeStep);
+    turnChange.set(start.bankRateAccel * timeStep * timeStep);
+    int steps = 0;
+
+    double lastAltitude = Ground::enabled ? altitudeAt(time) : 0;
+    double clearance    = Ground::enabled ? (lastAltitude - groundAt(x, y)) : 0;
+    if(Observer::enabled)
+    {
+        observer.begin(x, y);
+    }
+
+    while(time < elapsedTime)
+    {
+        // Get the time for this point.
+        double thisStep = timeStep;
+        double newTime = time + timeStep;
+        bool wholeStep = true;
+        if(newTime > elapsedTime)
+        {
+            // Last step is incomplete.
+            thisStep  = elapsedTime - time;
+            newTime   = elapsedTime;
+            wholeStep = false;
+        }
+        double lastTime = time;
+        time = newTime;
+
+        // Interpolate the plane characteristics at this time.
+        double altitude   = altitudeAt(time);
+        double planeSpeed = speedAt(time);
+        double windX;
+        double windY;
+        windAt(x, y, altitude, time, windX, windY);
+
+        // Update the simulated plane location.
+        heading  += bankRate * thisStep;
+        bankRate += accel * thisStep;
+        if(wholeStep)
+        {
+            direction.rotate(turn);
+            turn.rotate(turnChange);
+            if((++steps % Rotor::renormaliseSteps) == 0)
+            {
+                direction.renormalise();
+                turn.renormalise();
+            }
+        }
+        else
+        {
+            direction.set(heading);
+        }
+        double lastX = x;
+        double lastY = y;
+        z = altitude;
+        x += thisStep * (planeSpeed * direction.s + windX);
+        y += thisStep * (planeSpeed * direction.c + windY);
+
+        if(Ground::enabled)
+        {
+            double lastClearance = clearance;
+            clearance = altitude - groundAt(x, y);
+            if(clearance <= 0)
+            {
+                // Hit the ground during this step. Put the impact where the
+                // clearance reached zero, taking it to change linearly.
+                double f = (lastClearance > 0) ? lastClearance / (lastClearance - clearance) : 0;
+                x = lastX + f * (x - lastX);
+                y = lastY + f * (y - lastY);
+                z = lastAltitude + f * (altitude - lastAltitude);
+                if(Observer::enabled)
+                {
+                    observer.step(lastTime, time, lastX, lastY, x, y);
+                }
+                if(RecordTrack)
+                {
+                    track->addPoint(start.x + x, start.y + y, z);
+                }
+                break;
+            }
+            lastAltitude = altitude;
+        }
+
+        if(Observer::enabled)
+        {
+            observer.step(lastTime, time, lastX, lastY, x, y);
+        }
+        if(RecordTrack)
+        {
+            track->addPoint(start.x + x, start.y + y, z);
+        }
+    }
+
+    if(Observer::enabled)
+    {
+        observer.finish(x, y);
+    }
+    return Point3D(start.x + x, start.y + y, z);
+}
+
+// eulerTrack() chooses the specialisation one profile at a time.
+
+template<class Altitude, class Speed, class Wind, class Ground>
+Point3D eulerTrackGround(const TrackStart& start, const Altitude& altitude, const Speed& speed, const Wind& wind, const Ground& ground, const TrackEnvironment& environment, Track3D* track)
+{
+    if((environment.snapshots != NULL) || (environment.path != NULL))
+    {
+        TrackObserver observer(environment.snapshots, environment.path, start.x, start.y);
+        if(track != NULL)
+        {
+            return eulerLoop<true>(start, altitude, speed, wind, ground, observer, track);
+        }
+        return eulerLoop<false>(start, altitude, speed, wind, ground, observer, NULL);
+    }
+
+    if(track != NULL)
+    {
+        return eulerLoop<true>(start, altitude, speed, wind, ground, NoObserver(), track);
+    }
+    return eulerLoop<false>(start, altitude, speed, wind, ground, NoObserver(), NULL);
+}
+
+template<class Altitude, class Speed, class Wind>
+Point3D eulerTrackShaped(const TrackStart& start, const Altitude& altitude, const Speed& speed, const Wind& wind, const TrackEnvironment& environment, Track3D* track)
+{
+    if(track != NULL)
+    {
+        track->clear();
+    }
+
+    if(environment.terrain != NULL)
+    {
+        TerrainGround ground(*environment.terrain, *environment.terrainCache, start.x, start.y);
+        return eulerTrackGround(start, altitude, speed, wind, ground, environment, track);
+    }
+    return eulerTrackGround(start, altitude, speed, wind, NoGround(), environment, track);
+}
+
+template<class Speed, class Wind>
+Point3D eulerTrackAltitude(const TrackStart& start, const PointSet& altitude, const Speed& speed, const Wind& wind, const TrackEnvironment& environment, Track3D* track)
+{
+    switch(altitude.size())
+    {
+    case 0:
+        throw std::runtime_error("No altitude profile");
+    case 1:
+        return eulerTrackShaped(start, ConstantProfile(altitude), speed, wind, environment, track);
+    case 2:
+        return eulerTrackShaped(start, LinearProfile(altitude), speed, wind, environment, track);
+    default:
+        if(altitude.size() > TableProfile::maxPoints)
+        {
+            return eulerTrackShaped(start, SetProfile(altitude), speed, wind, environment, track);
+        }
+        return eulerTrackShaped(start, TableProfile(altitude), speed, wind, environment, track);
+    }
+}
+
+template<class Wind>
+Point3D eulerTrackSpeed(const TrackStart& start, const PointSet& altitude, const PointSet& speed, const Wind& wind, const TrackEnvironment& environment, Track3D* track)
+{
+    switch(speed.size())
+    {
+    case 0:
+        throw std::runtime_error("No speed profile");
+    case 1:
+        return eulerTrackAltitude(start, altitude, ConstantProfile(speed), wind, environment, track);
+    case 2:
+        return eulerTrackAltitude(start, altitude, LinearProfile(speed), wind, environment, track);
+    default:
+        if(speed.size() > TableProfile::maxPoints)
+        {
+            return eulerTrackAltitude(start, altitude, SetProfile(speed), wind, environment, track);
+        }
+        return eulerTrackAltitude(start, altitude, TableProfile(speed), wind, environment, track);
+    }
+}
+
+// Runs the Euler integration specialised for the given profiles and
+// environment.
+inline Point3D eulerTrack(
+        const TrackStart&       start,
+        const PointSet&         altitude,
+        const PointSet&         speed,
+        const PointSet&         wind,
+        const TrackEnvironment& environment,
+        Track3D*                track
+        )
+{
+    if(environment.windField != NULL)
+    {
+        FieldWind fieldWind(*environment.windField, *environment.windCache, start.x, start.y, environment.windTurn);
+        return eulerTrackSpeed(start, altitude, speed, fieldWind, environment, track);
+    }
+
+    switch(wind.size())
+    {
+    case 0:
+        throw std::runtime_error("No wind profile");
+    case 1:
+        return eulerTrackSpeed(start, altitude, speed, ProfileWind<ConstantProfile>(ConstantProfile(wind), start.sinWind, start.cosWind), environment, track);
+    case 2:
+        return eulerTrackSpeed(start, altitude, speed, ProfileWind<LinearProfile>(LinearProfile(wind), start.sinWind, start.cosWind), environment, track);
+    default:
+        if(wind.size() > TableProfile::maxPoints)
+        {
+            return eulerTrackSpeed(start, altitude, speed, ProfileWind<SetProfile>(SetProfile(wind), start.sinWind, start.cosWind), environment, track);
+        }
+        return eulerTrackSpeed(start, altitude, speed, ProfileWind<TableProfile>(TableProfile(wind), start.sinWind, start.cosWind), environment, track);
+    }
+}
+
+#endif // TRACKKERNEL_H
@@ -0,0 +1,112 @@
+#include "trackpath.h"
+
+#include <algorithm>
+#include <cmath>
+
+TrackPath::TrackPath() :
+    originX_(0.0),
+    originY_(0.0),
+    cellsPerMetre_(0.0),
+    cellsX_(0),
+    cellsY_(0),
+    lastX_(0),
+    lastY_(0),
+    lowX_(0.0),
+    highX_(0.0),
+    lowY_(0.0),
+    highY_(0.0)
+{
+}
+
+void TrackPath::setGrid(const Point2D& origin, double metresPerCell, int cellsX, int cellsY)
+{
+    originX_       = origin.x_;
+    originY_       = origin.y_;
+    cellsPerMetre_ = 1.0 / metresPerCell;
+    cellsX_        = cellsX;
+    cellsY_        = cellsY;
+}
+
+void TrackPath::begin(double x, double y)
+{
+    cells_.clear();
+    setLast(int(floor(((x - originX_) * cellsPerMetre_) + 0.5)), int(floor(((y - originY_) * cellsPerMetre_) + 0.5)));
+    visit(lastX_, lastY_);
+}
+
+void TrackPath::finish()
+{
+    std::sort(cells_.begin(), cells_.end());
+    cells_.erase(std::unique(cells_.begin(), cells_.end()), cells_.end());
+}
+
+void TrackPath::walk(double x0, double y0, double x1, double y1)
+{
+    // In cells, with each cell's centre on a whole number like gridIndex().
+    double fx1 = ((x1 - originX_) * cellsPerMetre_) + 0.5;
+    double fy1 = ((y1 - originY_) * cellsPerMetre_) + 0.5;
+    int col    = lastX_;
+    int row    = lastY_;
+    int endCol = int(floor(fx1));
+    int endRow = int(floor(fy1));
+    int steps  = abs(endCol - col) + abs(endRow - row);
+    if(steps <= 1)
+    {
+        // Into a neighbour, or back into the same cell after rounding.
+        if(steps == 1)
+        {
+            visit(endCol, endRow);
+        }
+        setLast(endCol, endRow);
+        return;
+    }
+    double fx0 = ((x0 - originX_) * cellsPerMetre_) + 0.5;
+    double fy0 = ((y0 - originY_) * cellsPerMetre_) + 0.5;
+
+    // The distance along the segment (0 to 1) to the next column and row
+    // boundaries, and between boundaries.
+    double dx = fx1 - fx0;
+    double dy = fy1 - fy0;
+    int stepX = (dx > 0.0) ? 1 : -1;
+    int stepY = (dy > 0.0) ? 1 : -1;
+    double nextX  = (dx != 0.0) ? ((col + ((dx > 0.0) ? 1 : 0)) - fx0) / dx : HUGE_VAL;
+    double nextY  = (dy != 0.0) ? ((row + ((dy > 0.0) ? 1 : 0)) - fy0) / dy : HUGE_VAL;
+    double deltaX = (dx != 0.0) ? fabs(1.0 / dx) : HUGE_VAL;
+    double deltaY = (dy != 0.0) ? fabs(1.0 / dy) : HUGE_VAL;
+
+    // One step per boundary crossed ends in the last cell, whatever rounding
+    // does to the distances.
+    for(; steps > 0; --steps)
+    {
+        if(((nextX < nextY) && (col != endCol)) || (row == endRow))
+        {
+            col   += stepX;
+            nextX += deltaX;
+        }
+        else
+        {
+            row   += stepY;
+            nextY += deltaY;
+        }
+        visit(col, row);
+    }
+    setLast(endCol, endRow);
+}
+
+void TrackPath::visit(int col, int row)
+{
+    if((col >= 0) && (row >= 0) && (col < cellsX_) && (row < cellsY_))
+    {
+        cells_.push_back(col + (row * cellsX_));
+    }
+}
+
+void TrackPath::setLast(int col, int row)
+{
+    lastX_ = col;
+    lastY_ = row;
+    lowX_  = originX_ + ((col - 0.5) / cellsPerMetre_);
+    highX_ = originX_ + ((col + 0.5) / cellsPerMetre_);
+    lowY_  = originY_ + ((row - 0.5) / cellsPerMetre_);
+    highY_ = originY_ + ((row + 0.5) / cellsPerMetre_);
+}
@@ -0,0 +1,57 @@
+#ifndef TRACKPATH_H
+#define TRACKPATH_H
+
+#include <vector>
+#include "point2d.h"
+
+// The cells of a grid that one track passes over, each listed once. The
+// track is fed in a segment at a time as it is integrated, and the cells
+// along each segment are walked one by one (Amanatides and Woo) so that none
+// is skipped however long the segment. Cells are numbered like gridIndex().
+class TrackPath
+{
+public:
+    TrackPath();
+
+    // Sets the grid; cellsX of zero (the default) turns the path off.
+    void setGrid(const Point2D& origin, double metresPerCell, int cellsX, int cellsY);
+    bool enabled() const { return cellsX_ > 0; }
+
+    // Starts a new track at the given position.
+    void begin(double x, double y);
+
+    // Adds the cells along a segment starting where the last one ended. Most
+    // segments are short enough to stay in one cell, which is checked first.
+    void addSegment(double x0, double y0, double x1, double y1)
+    {
+        if((x1 >= lowX_) && (x1 < highX_) && (y1 >= lowY_) && (y1 < highY_))
+            return;
+        walk(x0, y0, x1, y1);
+    }
+
+    // Sorts the cells and drops repeats, where the track looped back.
+    void finish();
+
+    // The cells passed over, once finish() has been called.
+    const std::vector<int>& cells() const { return cells_; }
+
+private:
+    void walk(double x0, double y0, double x1, double y1);
+    void visit(int col, int row);
+    void setLast(int col, int row);
+
+    double           originX_;
+    double           originY_;
+    double           cellsPerMetre_;
+    int              cellsX_;
+    int              cellsY_;
+    int              lastX_; // cell holding the end of the last segment
+    int              lastY_;
+    double           lowX_;  // edges of that cell, m
+    double           highX_;
+    double           lowY_;
+    double           highY_;
+    std::vector<int> cells_;
+};
+
+#endif // TRACKPATH_H
@@ -1,14 +1,19 @@
 #include "util.h"
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <cstring>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
 
 #include "pointset.h"
 #include "track3d.h"
 #include "point3d.h"
 #include "units.h"
 #include "kmlfile.h"
+#include "trackkernel.h"
 
 Point2D MGRSToUTM(const Point2D& pos, const std::string& InputDatum, const std::string& OutputDatum)
 {
@@ -36,9 +41,217 @@ Point2D AGD66ToWGS84(const Point2D& pos)
     return pos + Point2D(122, 183);
 }
 
+namespace
+{
+
+// The motion of the aircraft after the fix. The bank rate changes at a
+// constant rate so the heading is a known function of time, and the ground
+// velocity depends on time alone.
+struct TrackModel
+{
+    double          heading;
+    double          bankRate;
+    double          bankRateAccel;
+    double          sinWind;
+    double          cosWind;
+    const PointSet& altitudeTrack;
+    const PointSet& windSpeeds;
+    const PointSet& planeSpeeds;
+
+    double headingAt(double t) const
+    {
+        return heading + t * (bankRate + 0.5 * bankRateAccel * t);
+    }
+
+    // Plane and wind speeds at time t.
+    void speeds(double t, double& planeSpeed, double& windSpeed) const
+    {
+        planeSpeed = planeSpeeds.interpolate(t);
+        windSpeed  = windSpeeds.interpolate(altitudeTrack.interpolate(t));
+    }
+
+    // Ground velocity at time t.
+    void velocity(double t, double& vx, double& vy) const
+    {
+        double planeSpeed;
+        double windSpeed;
+        speeds(t, planeSpeed, windSpeed);
+        double hdg = headingAt(t);
+        vx = planeSpeed * sin(hdg) + windSpeed * cosWind;
+        vy = planeSpeed * cos(hdg) + windSpeed * sinWind;
+    }
+};
+
+// The position at the fix and the rest of the initial conditions of a track.
+TrackStart trackStart(
+        const Point2D&  towerPosition,
+        double          timeStep,
+        double          fixRange,
+        double          fixBearing,
+        double          elapsedTime,
+        double          heading,
+        double          initialBankRate,
+        double          bankRateAccel,
+        double          windHeading
+        )
+{
+    windHeading = (M_PI / -2) - windHeading; // reversed as wind direction is where the wind is FROM
+
+    TrackStart start;
+    start.x             = towerPosition.x_ + fixRange * sin(fixBearing);
+    start.y             = towerPosition.y_ + fixRange * cos(fixBearing);
+    start.timeStep      = timeStep;
+    start.elapsedTime   = elapsedTime;
+    start.heading       = heading;
+    start.bankRate      = initialBankRate;
+    start.bankRateAccel = bankRateAccel;
+    start.sinWind       = sin(windHeading);
+    start.cosWind       = cos(windHeading);
+    return start;
+}
+
+// The gridded wind and terrain of the run, looked up through the given caches.
+TrackEnvironment trackEnvironment(const Scenario& params, WindFieldCache& windCache, TerrainCache& terrainCache, double windTurn)
+{
+    TrackEnvironment environment;
+    environment.windField    = params.windField.get();
+    environment.windCache    = &windCache;
+    environment.windTurn     = windTurn;
+    environment.terrain      = params.terrain.get();
+    environment.terrainCache = &terrainCache;
+    return environment;
+}
+
+// The inputs offset by one standard deviation in each of the tracks around
+// the nominal one.
+const struct
+{
+    double range;
+    double bearing;
+    double time;
+    double windSpeed;
+    double heading;
+    double bankRate;
+    double bankAccel;
+    double startSpeed;
+    double endSpeed;
+    double windDir;
+    const char* name;
+}
+stdDevTracks[] =
+{
+    { 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, "Tower range +/-1 STD" } ,
+    { 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, "Tower bearing +/-1 STD" } ,
+    { 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, "Elapsed time +/-1 STD" } ,
+    { 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, "Wind speed +/-1 STD" } ,
+    { 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, "Aircraft heading +/-1 STD" } ,
+    { 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, "Bank rate +/-1 STD" } ,
+    { 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, "Bank rate acceleration +/-1 STD" } ,
+    { 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, "Start speed +/-1 STD" } ,
+    { 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, "End speed +/-1 STD" } ,
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, "Wind direction +/-1 STD" }
+};
+const int numStdDevTracks = sizeof(stdDevTracks) / sizeof(stdDevTracks[0]);
+
+// Calculates the track with the inputs of stdDevTracks[idx] offset by sign
+// standard deviations, or the nominal track if idx is -1.
+Point3D stdTrack(const ThreadParams& params, int idx, double sign, Track3D& track)
+{
+    double range     = 0.0;
+    double bearing   = 0.0;
+    double time      = 0.0;
+    double windSpeed = 0.0;
+    double heading   = 0.0;
+    double bankRate  = 0.0;
+    double bankAccel = 0.0;
+    double windDir   = 0.0;
+    if(idx >= 0)
+    {
+        range     = sign * stdDevTracks[idx].range;
+        bearing   = sign * stdDevTracks[idx].bearing;
+        time      = sign * stdDevTracks[idx].time;
+        windSpeed = sign * stdDevTracks[idx].windSpeed;
+        heading   = sign * stdDevTracks[idx].heading;
+        bankRate  = sign * stdDevTracks[idx].bankRate;
+        bankAccel = sign * stdDevTracks[idx].bankAccel;
+        windDir   = sign * stdDevTracks[idx].windDir;
+    }
+
+    PointSet altitudeTrack;
+    PointSet planeSpeeds;
+    WindFieldCache windCache;
+    TerrainCache terrainCache;
+    double elapsed = createPointSets(params, false, time, altitudeTrack, planeSpeeds);
+    return CalcTrack(
+                params.towerLocation,
+                params.timeStep,
+                params.integrator,
+                altitudeTrack,
+                params.fixRange.offsetMean(range),
+                params.fixBearing.offsetMean(bearing),
+                elapsed,
+                params.aircraftHeading.offsetMean(heading),
+                params.initialBankRate.offsetMean(bankRate),
+                params.bankRateAccel.offsetMean(bankAccel),
+                params.windDirection.offsetMean(windDir),
+                params.windProfile.offsetMean(windSpeed),
+                planeSpeeds,
+                trackEnvironment(params, windCache, terrainCache, params.windDirection.offsetMean(windDir) - params.windDirection.mean()),
+                &track
+                );
+}
+
+template<typename T>
+void hashCombine(size_t& seed, const T& value)
+{
+    seed ^= std::hash<T>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+void hashCombine(size_t& seed, const Distribution& dist)
+{
+    hashCombine(seed, dist.mean());
+    hashCombine(seed, dist.stdDev());
+}
+
+struct StdTrackJob
+{
+    const ThreadParams* params;
+    StdTracks*          tracks;
+    pthread_mutex_t     mutex;
+};
+
+void* stdTrackThread(void* params)
+{
+    StdTrackJob* job = reinterpret_cast<StdTrackJob*>(params);
+    runStdTrackJobs(*job->params, *job->tracks, job->mutex);
+    return NULL;
+}
+
+// Largest heading change (radians) in one step of the higher order
+// integrators.
+const double maxStepTurn = 0.25;
+
+// Returns the x value of the first point in the set beyond x, starting the
+// search from idx, or HUGE_VAL if there isn't one. A set of one point is
+// constant, so has no corners.
+double nextCorner(const PointSet& set, double x, size_t& idx)
+{
+    if(set.size() < 2)
+        return HUGE_VAL;
+
+    while((idx < set.size()) && (set[idx].x_ <= x))
+    {
+        ++idx;
+    }
+    return (idx < set.size()) ? set[idx].x_ : HUGE_VAL;
+}
+
+} // namespace
+
 Point3D CalcTrack(
         const Point2D&  towerPosition,
         double          timeStep,
+        Integrator      integrator,
         const PointSet& altitudeTrack,
         double          fixRange,
         double          fixBearing,
@@ -50,23 +263,52 @@ Point3D CalcTrack(
         const PointSet& windSpeeds,
         const PointSet& planeSpeeds,
 
+        const TrackEnvironment& environment,
+
         Track3D*        track
         )
 {
-    if(track != NULL)
+    // Set up the initial conditions.
+    TrackStart start = trackStart(
+                towerPosition, timeStep, fixRange, fixBearing, elapsedTime,
+                heading, initialBankRate, bankRateAccel, windHeading
+                );
+    if((integrator == EULER_INTEGRATOR) || (environment.windField != NULL) || (environment.terrain != NULL))
     {
-        track->clear();
+        return eulerTrack(start, altitudeTrack, planeSpeeds, windSpeeds, environment, track);
     }
 
-    // Set up the initial conditions.
-    double x        = towerPosition.x_ + fixRange * sin(fixBearing);
-    double y        = towerPosition.y_ + fixRange * cos(fixBearing);
+    double x        = start.x;
+    double y        = start.y;
     double z        = 0.0;
     double time     = 0.0;
-    double bankRate = initialBankRate;
-    windHeading     = (M_PI / -2) - windHeading; // reversed as wind direction is where the wind is FROM
-    double sinWind  = sin(windHeading);
-    double cosWind  = cos(windHeading);
+    double sinWind  = start.sinWind;
+    double cosWind  = start.cosWind;
+
+    if(track != NULL)
+    {
+        track->clear();
+    }
+
+    const TrackModel model =
+    {
+        heading, initialBankRate, bankRateAccel, sinWind, cosWind, altitudeTrack, windSpeeds, planeSpeeds
+    };
+    double vx = 0.0;
+    double vy = 0.0;
+    size_t altitudeCorner = 0;
+    size_t speedCorner    = 0;
+    if(integrator == RK4_INTEGRATOR)
+    {
+        model.velocity(0.0, vx, vy);
+    }
+
+    // The arc method reuses the end of each step as the start of the next.
+    Rotor direction;
+    direction.set(heading);
+
+    TrackObserver observer(environment.snapshots, environment.path, 0.0, 0.0);
+    observer.begin(x, y);
 
     while(time < elapsedTime)
     {
@@ -79,20 +321,79 @@ Point3D CalcTrack(
             thisStep = elapsedTime - time;
             newTime  = elapsedTime;
         }
-        time = newTime;
 
-        // Interpolate the plane characteristics at this time.
-        double altitude   = altitudeTrack.interpolate(time);
-        double windSpeed  = windSpeeds.interpolate(altitude);
-        double planeSpeed = planeSpeeds.interpolate(time);
+        // The profiles are only piecewise smooth. Ending a step at each
+        // corner keeps the long steps of the higher order methods accurate.
+        double corner = std::min(
+                    nextCorner(altitudeTrack, time, altitudeCorner),
+                    nextCorner(planeSpeeds, time, speedCorner)
+                    );
+        if(corner < newTime)
+        {
+            thisStep = corner - time;
+            newTime  = corner;
+        }
 
-        // Update the simulated plane location.
-        heading    += bankRate * thisStep;
-        bankRate   += bankRateAccel * thisStep;
-        double hdg = (M_PI / 2) - heading;
-        z          = altitude;
-        x          += thisStep * (planeSpeed * cos(hdg) + windSpeed * cosWind);
-        y          += thisStep * (planeSpeed * sin(hdg) + windSpeed * sinWind);
+        // Shorten steps where the aircraft turns sharply.
+        double turnRate = fabs(model.bankRate + model.bankRateAccel * time);
+        if(turnRate * thisStep > maxStepTurn)
+        {
+            thisStep = maxStepTurn / turnRate;
+            newTime  = time + thisStep;
+        }
+
+        double lastX    = x;
+        double lastY    = y;
+        double lastTime = time;
+        if(integrator == RK4_INTEGRATOR)
+        {
+            // The velocity doesn't depend on the position, so the classic
+            // Runge-Kutta step is Simpson's rule over the step. The velocity
+            // at the end of the step is the start of the next.
+            double midX;
+            double midY;
+            model.velocity(time + 0.5 * thisStep, midX, midY);
+            double endX;
+            double endY;
+            model.velocity(newTime, endX, endY);
+            z  = altitudeTrack.interpolate(newTime);
+            x  += (thisStep / 6.0) * (vx + 4.0 * midX + endX);
+            y  += (thisStep / 6.0) * (vy + 4.0 * midY + endY);
+            vx = endX;
+            vy = endY;
+        }
+        else if(integrator == ARC_INTEGRATOR)
+        {
+            // Fly a circular arc at the average turn rate of the step, with
+            // the speeds at the middle of the step.
+            double planeSpeed;
+            double windSpeed;
+            model.speeds(time + 0.5 * thisStep, planeSpeed, windSpeed);
+            double startHdg = model.headingAt(time);
+            double endHdg   = model.headingAt(newTime);
+            double arcTurn  = endHdg - startHdg;
+            Rotor end;
+            end.set(endHdg);
+            double alongX;
+            double alongY;
+            if(fabs(arcTurn) > 1e-6)
+            {
+                alongX = (direction.c - end.c) / arcTurn;
+                alongY = (end.s - direction.s) / arcTurn;
+            }
+            else
+            {
+                double midHdg = 0.5 * (startHdg + endHdg);
+                alongX = sin(midHdg);
+                alongY = cos(midHdg);
+            }
+            direction = end;
+            z = altitudeTrack.interpolate(newTime);
+            x += thisStep * (planeSpeed * alongX + windSpeed * cosWind);
+            y += thisStep * (planeSpeed * alongY + windSpeed * sinWind);
+        }
+        time = newTime;
+        observer.step(lastTime, time, lastX, lastY, x, y);
 
         if(track != NULL)
         {
@@ -100,18 +401,10 @@ Point3D CalcTrack(
         }
     }
 
+    observer.finish(x, y);
     return Point3D(x, y, z);
 }
 
-//def GetContourPoints(xarray,yarray,m,level):
-//    import matplotlib.pyplot as plt
-//    cs = plt.contour(yarray,xarray,m, [level])
-//    p = cs.collections[0].get_paths()[0]
-//    v = p.vertices
-//    x = v[:,0]
-//    y = v[:,1]
-//    return (x,y)
-
 Point2D utmToLatLng(int zone, const Point2D& en, bool northernHemisphere)
 {
     const double easting = en.x_;
@@ -167,36 +460,125 @@ Point2D utmToLatLng(int zone, const Point2D& en, bool northernHemisphere)
     return Point2D(longitude, latitude);
 }
 
-Point3D createStdTracks(KmlFile& kml, ThreadParams& params)
+size_t stdTracksKey(const ThreadParams& params)
 {
-    Track3D track1;
-    Track3D track2;
+    size_t key = 0;
+    hashCombine(key, params.towerLocation.x_);
+    hashCombine(key, params.towerLocation.y_);
+    hashCombine(key, params.timeStep);
+    hashCombine(key, int(params.integrator));
+    const Distribution* dists[] =
+    {
+        &params.fixRange,
+        &params.fixBearing,
+        &params.aircraftHeading,
+        &params.initialBankRate,
+        &params.bankRateAccel,
+        &params.windDirection
+    };
+    for(size_t i = 0; i < sizeof(dists) / sizeof(dists[0]); ++i)
+    {
+        hashCombine(key, *dists[i]);
+    }
+    for(auto i = params.flightProfile.begin(); i != params.flightProfile.end(); ++i)
+    {
+        hashCombine(key, i->time);
+        hashCombine(key, i->altitude);
+        hashCombine(key, i->speed);
+    }
+    for(size_t i = 0; i < params.windProfile.size(); ++i)
+    {
+        hashCombine(key, params.windProfile.x(i));
+        hashCombine(key, params.windProfile[i]);
+    }
+    hashCombine(key, params.windField ? params.windField->path() : std::string());
+    hashCombine(key, params.windField ? params.windField->startTime() : 0.0);
+    hashCombine(key, params.terrain ? params.terrain->directory() : std::string());
+    return key;
+}
 
-    PointSet altitudeTrack;
-    PointSet planeSpeeds;
-    double elapsed = createPointSets(params, false, 0.0, altitudeTrack, planeSpeeds);
+void prepareStdTracks(const ThreadParams& params, StdTracks& tracks)
+{
+    size_t key = stdTracksKey(params);
+    if((tracks.key == key) && (tracks.jobsDone == 2 * numStdDevTracks) && tracks.error.empty())
+        return;
+
+    tracks.key          = 0; // until the nominal track is made
+    tracks.nominalCrash = stdTrack(params, -1, 1.0, tracks.nominal);
+    tracks.nominal.convertAMG66toWGS84();
+    tracks.key          = key;
+    tracks.plus.resize(numStdDevTracks);
+    tracks.minus.resize(numStdDevTracks);
+    tracks.nextJob  = 0;
+    tracks.jobsDone = 0;
+    tracks.error.clear();
+    std::cout << "Nominal Crash Location: " << tracks.nominalCrash.x_ << " " << tracks.nominalCrash.y_ << std::endl;
+}
 
-    // Nominal Track
-    Point3D nominalCrashPos = CalcTrack(
-                params.towerLocation,
-                params.timeStep,
-                altitudeTrack,
-                params.fixRange.mean(),
-                params.fixBearing.mean(),
-                elapsed,
-                params.aircraftHeading.mean(),
-                params.initialBankRate.mean(),
-                params.bankRateAccel.mean(),
-                params.windDirection.mean(),
-                params.windProfile.mean(),
-                planeSpeeds,
-                &track1
-                );
+void runStdTrackJobs(const ThreadParams& params, StdTracks& tracks, pthread_mutex_t& mutex)
+{
+    for(;;)
+    {
+        pthread_mutex_lock(&mutex);
+        int job = tracks.nextJob;
+        if(job < 2 * numStdDevTracks)
+        {
+            ++tracks.nextJob;
+        }
+        pthread_mutex_unlock(&mutex);
+        if(job >= 2 * numStdDevTracks)
+            break;
+
+        // Even jobs are the +1 standard deviation tracks, odd jobs -1.
+        Track3D& track = (job % 2 == 0) ? tracks.plus[job / 2] : tracks.minus[job / 2];
+        std::string error;
+        try
+        {
+            stdTrack(params, job / 2, (job % 2 == 0) ? 1.0 : -1.0, track);
+            track.convertAMG66toWGS84();
+        }
+        catch(const std::exception& e)
+        {
+            track.clear();
+            error = e.what();
+        }
+
+        pthread_mutex_lock(&mutex);
+        ++tracks.jobsDone;
+        if(tracks.error.empty())
+        {
+            tracks.error = error;
+        }
+        pthread_mutex_unlock(&mutex);
+    }
+}
 
-    std::cout << "Nominal Crash Location: " << nominalCrashPos.x_ << " " << nominalCrashPos.y_ << std::endl;
-    track1.convertAMG66toWGS84();
-    kml.addTrack(track1, "Nominal track", "99ff7777");
-    Point3D end = nominalCrashPos;
+void computeStdTracks(const ThreadParams& params, StdTracks& tracks, int numThreads)
+{
+    prepareStdTracks(params, tracks);
+    if(tracks.nextJob == 2 * numStdDevTracks)
+        return;
+
+    StdTrackJob job;
+    job.params = &params;
+    job.tracks = &tracks;
+    pthread_mutex_init(&job.mutex, NULL);
+    std::vector<pthread_t> ids(numThreads);
+    for(int i = 0; i < numThreads; ++i)
+    {
+        pthread_create(&ids[i], NULL, stdTrackThread, &job);
+    }
+    for(int i = 0; i < numThreads; ++i)
+    {
+        pthread_join(ids[i], NULL);
+    }
+    pthread_mutex_destroy(&job.mutex);
+}
+
+void writeStdTracks(KmlFile& kml, const StdTracks& tracks)
+{
+    kml.addTrack(tracks.nominal, "Nominal track", "99ff7777");
+    Point3D end = tracks.nominalCrash;
     end.convertAMG66toWGS84();
     kml.addPoint(end, "Nominal crash location");
 
@@ -219,82 +601,19 @@ Point3D createStdTracks(KmlFile& kml, ThreadParams& params)
 //    KmlTrack.linestyle.width = 20
 //    KmlTrack.linestyle.color = '99ff7777'
 
-    const struct
-    {
-        double range;
-        double bearing;
-        double time;
-        double windSpeed;
-        double heading;
-        double bankRate;
-        double bankAccel;
-        double startSpeed;
-        double endSpeed;
-        double windDir;
-        const char* name;
-    }
-    stdDevTracks[] =
-    {
-        { 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, "Tower range +/-1 STD" } ,
-        { 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, "Tower bearing +/-1 STD" } ,
-        { 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, "Elapsed time +/-1 STD" } ,
-        { 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, "Wind speed +/-1 STD" } ,
-        { 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, "Aircraft heading +/-1 STD" } ,
-        { 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, "Bank rate +/-1 STD" } ,
-        { 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, "Bank rate acceleration +/-1 STD" } ,
-        { 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, "Start speed +/-1 STD" } ,
-        { 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, "End speed +/-1 STD" } ,
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, "Wind direction +/-1 STD" } ,
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, NULL }
-    };
-
     kml.startFolder("+/-1 STD tracks");
-    for(int i = 0; stdDevTracks[i].name; ++i)
+    for(int i = 0; i < numStdDevTracks; ++i)
     {
-        double elapsed = createPointSets(params, false, stdDevTracks[i].time, altitudeTrack, planeSpeeds);
-        CalcTrack(
-                    params.towerLocation,
-                    params.timeStep,
-                    altitudeTrack,
-                    params.fixRange.offsetMean(stdDevTracks[i].range),
-                    params.fixBearing.offsetMean(stdDevTracks[i].bearing),
-                    elapsed,
-                    params.aircraftHeading.offsetMean(stdDevTracks[i].heading),
-                    params.initialBankRate.offsetMean(stdDevTracks[i].bankRate),
-                    params.bankRateAccel.offsetMean(stdDevTracks[i].bankAccel),
-                    params.windDirection.offsetMean(stdDevTracks[i].windDir),
-                    params.windProfile.offsetMean(stdDevTracks[i].windSpeed),
-                    planeSpeeds,
-                    &track1
-                    );
-
-        elapsed = createPointSets(params, false, -stdDevTracks[i].time, altitudeTrack, planeSpeeds);
-        CalcTrack(
-                    params.towerLocation,
-                    params.timeStep,
-                    altitudeTrack,
-                    params.fixRange.offsetMean(-stdDevTracks[i].range),
-                    params.fixBearing.offsetMean(-stdDevTracks[i].bearing),
-                    elapsed,
-                    params.aircraftHeading.offsetMean(-stdDevTracks[i].heading),
-                    params.initialBankRate.offsetMean(-stdDevTracks[i].bankRate),
-                    params.bankRateAccel.offsetMean(-stdDevTracks[i].bankAccel),
-                    params.windDirection.offsetMean(-stdDevTracks[i].windDir),
-                    params.windProfile.offsetMean(-stdDevTracks[i].windSpeed),
-                    planeSpeeds,
-                    &track2
-                    );
+        if(tracks.plus[i].empty() || tracks.minus[i].empty())
+            continue;
 
-        track1.convertAMG66toWGS84();
-        track2.convertAMG66toWGS84();
-        track2.reverse();
-        kml.addPolygon(track1 + track2, stdDevTracks[i].name, "std_tracks");
+        Track3D minus = tracks.minus[i];
+        minus.reverse();
+        kml.addPolygon(tracks.plus[i] + minus, stdDevTracks[i].name, "std_tracks");
     }
-
-    return nominalCrashPos;
 }
 
-double createPointSets(const ThreadParams& params, bool sample, double stdDev, PointSet& altitude, PointSet& speed)
+double createPointSets(const Scenario& params, bool sample, double stdDev, PointSet& altitude, PointSet& speed)
 {
     double startTime = 0;
     double lastTime  = 0;
@@ -362,3 +681,172 @@ double createPointSets(const ThreadParams& params, bool sample, double stdDev, P
 //    std::cerr << "elapsed=" << lastTime << std::endl;
     return lastTime;
 }
+
+double createPointSets(const Scenario& params, const double* z, PointSet& altitude, PointSet& speed)
+{
+    double startTime = 0;
+    double lastTime  = 0;
+    altitude.clear();
+    speed.clear();
+    for(auto i = params.flightProfile.begin(); i != params.flightProfile.end(); ++i)
+    {
+        double time = i->time.offsetMean(*z++);
+        if(i == params.flightProfile.begin())
+        {
+            startTime = time;
+        }
+        else
+        {
+            lastTime = time - startTime;
+        }
+
+        if(!i->altitude.isNull())
+        {
+            altitude.addPoint(time, i->altitude.offsetMean(*z++));
+        }
+
+        if(!i->speed.isNull())
+        {
+            speed.addPoint(time, i->speed.offsetMean(*z++));
+        }
+    }
+    return lastTime;
+}
+
+void inputDistributions(const Scenario& params, std::vector<const Distribution*>& dists)
+{
+    dists.clear();
+    dists.push_back(&params.fixRange);
+    dists.push_back(&params.fixBearing);
+    dists.push_back(&params.aircraftHeading);
+    dists.push_back(&params.initialBankRate);
+    dists.push_back(&params.bankRateAccel);
+    dists.push_back(&params.windDirection);
+    for(auto i = params.flightProfile.begin(); i != params.flightProfile.end(); ++i)
+    {
+        dists.push_back(&i->time);
+        if(!i->altitude.isNull())
+        {
+            dists.push_back(&i->altitude);
+        }
+        if(!i->speed.isNull())
+        {
+            dists.push_back(&i->speed);
+        }
+    }
+    for(size_t i = 0; i < params.windProfile.size(); ++i)
+    {
+        dists.push_back(&params.windProfile[i]);
+    }
+}
+
+void inputNames(const Scenario& params, std::vector<std::string>& names)
+{
+    names.clear();
+    names.push_back("Fix range");
+    names.push_back("Fix bearing");
+    names.push_back("Aircraft heading");
+    names.push_back("Bank rate");
+    names.push_back("Bank rate acceleration");
+    names.push_back("Wind direction");
+    for(size_t i = 0; i < params.flightProfile.size(); ++i)
+    {
+        std::ostringstream row;
+        row << "Flight row " << (i + 1);
+        names.push_back(row.str() + " time");
+        if(!params.flightProfile[i].altitude.isNull())
+        {
+            names.push_back(row.str() + " altitude");
+        }
+        if(!params.flightProfile[i].speed.isNull())
+        {
+            names.push_back(row.str() + " speed");
+        }
+    }
+    for(size_t i = 0; i < params.windProfile.size(); ++i)
+    {
+        std::ostringstream row;
+        row << "Wind row " << (i + 1) << " speed";
+        names.push_back(row.str());
+    }
+}
+
+size_t inputCount(const Scenario& params)
+{
+    std::vector<const Distribution*> dists;
+    inputDistributions(params, dists);
+    return dists.size();
+}
+
+size_t runInputCount(const ThreadParams& params)
+{
+    size_t retval = inputCount(params);
+    for(auto i = params.scenarios.begin(); i != params.scenarios.end(); ++i)
+    {
+        retval = std::max(retval, inputCount(*i));
+    }
+    return retval;
+}
+
+Point3D CalcSample(const Scenario& params, Integrator integrator, const double* z, SampleProfiles& profiles, double timeStep, Track3D* track)
+{
+    const double* flightZ = z + 6;
+    double elapsed        = createPointSets(params, flightZ, profiles.altitude, profiles.speed);
+    const double* windZ   = flightZ + params.flightProfile.size() + profiles.altitude.size() + profiles.speed.size();
+    params.windProfile.fromNormals(windZ, profiles.wind);
+
+    TrackEnvironment environment = trackEnvironment(
+                params, profiles.windCache, profiles.terrainCache,
+                params.windDirection.offsetMean(z[5]) - params.windDirection.mean()
+                );
+    if(!profiles.snapshots.times.empty())
+    {
+        environment.snapshots = &profiles.snapshots;
+    }
+    if(profiles.path.enabled())
+    {
+        environment.path = &profiles.path;
+    }
+    return CalcTrack(
+                params.towerLocation,
+                timeStep,
+                integrator,
+                profiles.altitude,
+                params.fixRange.offsetMean(z[0]),
+                params.fixBearing.offsetMean(z[1]),
+                elapsed,
+                params.aircraftHeading.offsetMean(z[2]),
+                params.initialBankRate.offsetMean(z[3]),
+                params.bankRateAccel.offsetMean(z[4]),
+                params.windDirection.offsetMean(z[5]),
+                profiles.wind,
+                profiles.speed,
+                environment,
+                track
+                );
+}
+
+std::string trim(const std::string& s)
+{
+    size_t begin = s.find_first_not_of(" \t");
+    if(begin == std::string::npos)
+        return std::string();
+    size_t end = s.find_last_not_of(" \t");
+    return s.substr(begin, end - begin + 1);
+}
+
+std::vector<std::string> split(const std::string& s, char separator)
+{
+    std::vector<std::string> retval;
+    std::istringstream is(s);
+    std::string part;
+    while(std::getline(is, part, separator))
+    {
+        part = trim(part);
+        if(!part.empty())
+        {
+            retval.push_back(part);
+        }
+    }
+    return retval;
+}
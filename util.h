@@ -4,12 +4,13 @@
 #include <string>
 #include <vector>
 #include "thread.h"
+#include "pointset.h"
+#include "point3d.h"
+#include "track3d.h"
+#include "trackkernel.h"
 #ifndef M_PI
 #define M_PI 3.14159265359
 #endif // M_PI
-class PointSet;
-class Track3D;
-class Point3D;
 class Point2D;
 class KmlFile;
 
@@ -21,6 +22,7 @@ Point3D CalcTrack(
         // Fixed parameters
         const Point2D&  towerPosition,
         double          timeStep,
+        Integrator      integrator,
         const PointSet& altitudeTrack, // x=time     y=altitude
         // Varying parameters
         double          fixRange,
@@ -32,14 +34,100 @@ Point3D CalcTrack(
         double          windHeading,
         const PointSet& windSpeeds,    // x=altitude y=wind speed
         const PointSet& planeSpeeds,   // x=time     y=speed
+        // Gridded wind (used instead of windSpeeds) and terrain (ending the
+        // track at the ground), if given. Either forces the Euler method.
+        const TrackEnvironment& environment,
         // Returned values
         Track3D*        track = NULL
         );
 
 Point2D utmToLatLng(int zone, const Point2D& en, bool northernHemisphere = true);
 
-Point3D createStdTracks(KmlFile& kml, ThreadParams& params);
+// Strips leading and trailing spaces and tabs.
+std::string trim(const std::string& s);
 
-double createPointSets(const ThreadParams& params, bool sample, double stdDev, PointSet& altitude, PointSet& speed);
+// Splits s at each separator, trimming the parts and dropping empty ones.
+std::vector<std::string> split(const std::string& s, char separator);
+
+// The nominal track and the tracks with one input at +/-1 standard deviation
+// that are drawn in the KML file, in WGS84. The nominal track is computed
+// straight away (its crash position places the grid) while the others are
+// queued as jobs for the worker threads. They are kept for as long as the
+// parameters they depend on (see stdTracksKey()) stay the same. A job that
+// fails leaves its track empty and its message in error, for the caller to
+// report.
+struct StdTracks
+{
+    StdTracks() : key(0), nextJob(0), jobsDone(0) {}
+
+    size_t               key;
+    Point3D              nominalCrash; // AMG
+    Track3D              nominal;
+    std::vector<Track3D> plus;
+    std::vector<Track3D> minus;
+    int                  nextJob;
+    int                  jobsDone;
+    std::string          error; // from the first job that failed
+};
+
+// A hash of the parameters the standard deviation tracks depend on.
+size_t stdTracksKey(const ThreadParams& params);
+
+// Computes the nominal track and queues the others, unless the tracks were
+// already made for these parameters. Throws std::runtime_error if the
+// nominal track can't be computed.
+void prepareStdTracks(const ThreadParams& params, StdTracks& tracks);
+
+// Runs queued standard deviation track jobs until there are none left. Any
+// number of threads can share the work; mutex guards the queue.
+void runStdTrackJobs(const ThreadParams& params, StdTracks& tracks, pthread_mutex_t& mutex);
+
+// Prepares the tracks and runs the jobs on numThreads threads. Throws like
+// prepareStdTracks().
+void computeStdTracks(const ThreadParams& params, StdTracks& tracks, int numThreads);
+
+// Adds the tracks to the KML file. All the jobs must have run; the pairs
+// with a failed track are left out.
+void writeStdTracks(KmlFile& kml, const StdTracks& tracks);
+
+double createPointSets(const Scenario& params, bool sample, double stdDev, PointSet& altitude, PointSet& speed);
+
+// Creates the flight profile point sets from one standard normal deviate per
+// distribution, in the order described for inputDistributions().
+double createPointSets(const Scenario& params, const double* z, PointSet& altitude, PointSet& speed);
+
+// Every random input of a sample is described by a standard normal deviate.
+// The inputs are ordered: fix range, fix bearing, aircraft heading, initial
+// bank rate, bank rate acceleration and wind direction; then the time,
+// altitude and speed of each flight profile row (skipping blank altitudes and
+// speeds); then each wind profile row.
+void inputDistributions(const Scenario& params, std::vector<const Distribution*>& dists);
+size_t inputCount(const Scenario& params);
+
+// Names the inputs, in the same order.
+void inputNames(const Scenario& params, std::vector<std::string>& names);
+
+// The largest number of inputs of the scenarios of a run, i.e. the number of
+// deviates to draw for each sample.
+size_t runInputCount(const ThreadParams& params);
+
+// Scratch point sets reused between calls to CalcSample, the positions at
+// the snapshot times of each sample if any times are set, and the cells it
+// passes over if the path has a grid.
+struct SampleProfiles
+{
+    PointSet         altitude;
+    PointSet         speed;
+    PointSet         wind;
+    WindFieldCache   windCache;
+    TerrainCache     terrainCache;
+    TrackSnapshots   snapshots;
+    TrackPath        path;
+};
+
+// Calculates the track of the scenario for the sample described by the
+// standard normal deviates z (see inputDistributions()), integrating with the
+// given method and time step.
+Point3D CalcSample(const Scenario& params, Integrator integrator, const double* z, SampleProfiles& profiles, double timeStep, Track3D* track = NULL);
 
 #endif // UTIL_H
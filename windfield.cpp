@@ -0,0 +1,176 @@
+#include "windfield.h"
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <stdint.h>
+#include <QFile>
+
+namespace
+{
+
+struct Header
+{
+    char    magic[4];
+    int32_t version;
+    int32_t size[4];
+    double  lon0;
+    double  dlon;
+    double  lat0;
+    double  dlat;
+    double  alt0;
+    double  dalt;
+    double  t0;
+    double  dt;
+};
+
+// Splits a fractional grid coordinate into the index of the grid point below
+// it and the weight of the one above, holding the value beyond the edges.
+void locate(double f, int n, int& idx, double& weight)
+{
+    if((n < 2) || !(f > 0.0))
+    {
+        idx    = 0;
+        weight = 0.0;
+    }
+    else if(f >= n - 1)
+    {
+        idx    = n - 2;
+        weight = 1.0;
+    }
+    else
+    {
+        idx    = int(f);
+        weight = f - idx;
+    }
+}
+
+} // namespace
+
+WindField::WindField() :
+    u_(NULL),
+    v_(NULL),
+    startTime_(0.0),
+    sinConvergence_(0.0),
+    cosConvergence_(1.0)
+{
+}
+
+WindField::~WindField()
+{
+}
+
+void WindField::load(const std::string& path)
+{
+    path_ = path;
+    file_.reset(new QFile(QString::fromStdString(path)));
+    if(!file_->open(QIODevice::ReadOnly))
+        throw std::runtime_error("Unable to open wind field " + path);
+
+    const uchar* data = file_->map(0, file_->size());
+    if((data == NULL) || (file_->size() < qint64(sizeof(Header))))
+        throw std::runtime_error("Unable to read wind field " + path);
+
+    Header header;
+    memcpy(&header, data, sizeof(header));
+    if((memcmp(header.magic, "PSWF", 4) != 0) || (header.version != 1))
+        throw std::runtime_error("Not a wind field: " + path);
+
+    qint64 points = 1;
+    for(int i = 0; i < 4; ++i)
+    {
+        if(header.size[i] < 1)
+            throw std::runtime_error("Bad wind field dimensions in " + path);
+        size_[i] = header.size[i];
+        points   *= size_[i];
+    }
+    if(file_->size() < qint64(sizeof(Header) + 2 * points * sizeof(float)))
+        throw std::runtime_error("Wind field is truncated: " + path);
+
+    stride_[0] = 1;
+    for(int i = 1; i < 4; ++i)
+    {
+        stride_[i] = stride_[i - 1] * size_[i - 1];
+    }
+    for(int i = 0; i < 4; ++i)
+    {
+        step_[i] = (size_[i] > 1) ? stride_[i] : 0;
+    }
+
+    lon0_ = header.lon0;
+    dlon_ = header.dlon;
+    lat0_ = header.lat0;
+    dlat_ = header.dlat;
+    alt0_ = header.alt0;
+    dalt_ = header.dalt;
+    t0_   = header.t0;
+    dt_   = header.dt;
+    u_    = reinterpret_cast<const float*>(data + sizeof(Header));
+    v_    = u_ + points;
+}
+
+void WindField::prepare(const Point2D& origin, double startTime)
+{
+    projection_.setOrigin(origin);
+    startTime_ = startTime;
+
+    // The field's winds are relative to true north and the tracks to grid
+    // north.
+    sinConvergence_ = sin(projection_.convergence());
+    cosConvergence_ = cos(projection_.convergence());
+}
+
+void WindField::velocity(WindFieldCache& cache, double easting, double northing, double altitude, double time, double& u, double& v) const
+{
+    int idx[4];
+    double weight[4];
+    locate((projection_.longitude(easting, northing) - lon0_) / dlon_, size_[0], idx[0], weight[0]);
+    locate((projection_.latitude(easting, northing) - lat0_) / dlat_, size_[1], idx[1], weight[1]);
+    locate((altitude - alt0_) / dalt_, size_[2], idx[2], weight[2]);
+    locate((startTime_ + time - t0_) / dt_, size_[3], idx[3], weight[3]);
+
+    long cell = (idx[0] * stride_[0]) + (idx[1] * stride_[1]) + (idx[2] * stride_[2]) + (idx[3] * stride_[3]);
+    if(cell != cache.cell)
+    {
+        // Fetch the corners of the new cell, x varying fastest. Dimensions
+        // with a single point use it for both ends.
+        for(int c = 0; c < 16; ++c)
+        {
+            long offset = cell;
+            for(int d = 0; d < 4; ++d)
+            {
+                if(c & (1 << d))
+                {
+                    offset += step_[d];
+                }
+            }
+            cache.u[c] = u_[offset];
+            cache.v[c] = v_[offset];
+        }
+        cache.cell = cell;
+    }
+
+    // Interpolate along each dimension in turn.
+    double u16[16];
+    double v16[16];
+    for(int c = 0; c < 16; ++c)
+    {
+        u16[c] = cache.u[c];
+        v16[c] = cache.v[c];
+    }
+    for(int d = 0, n = 16; d < 4; ++d)
+    {
+        n /= 2;
+        for(int c = 0; c < n; ++c)
+        {
+            u16[c] = u16[2 * c] + weight[d] * (u16[(2 * c) + 1] - u16[2 * c]);
+            v16[c] = v16[2 * c] + weight[d] * (v16[(2 * c) + 1] - v16[2 * c]);
+        }
+    }
+    double east  = u16[0];
+    double north = v16[0];
+
+    // Turn from true to grid directions.
+    u = (east * cosConvergence_) - (north * sinConvergence_);
+    v = (north * cosConvergence_) + (east * sinConvergence_);
+}
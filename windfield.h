@@ -0,0 +1,83 @@
+#ifndef WINDFIELD_H
+#define WINDFIELD_H
+
+#include <memory>
+#include <string>
+#include "point2d.h"
+#include "localprojection.h"
+
+class QFile;
+
+// Remembers the grid cell of the last wind field lookup and the wind at its
+// corners, so that successive lookups along a track only need the weights.
+// Each thread needs its own.
+struct WindFieldCache
+{
+    WindFieldCache() : cell(-1) {}
+
+    long  cell;
+    float u[16];
+    float v[16];
+};
+
+// A gridded wind field, memory mapped from a binary file of the form (all
+// little endian):
+//
+//   char    magic[4]    "PSWF"
+//   int32   version     1
+//   int32   nx, ny, nz, nt
+//   float64 lon0, dlon  longitude of the first column and spacing (deg WGS84)
+//   float64 lat0, dlat  latitude of the first row and spacing (deg WGS84)
+//   float64 alt0, dalt  altitude of the first level and spacing (m)
+//   float64 t0, dt      time of the first snapshot and spacing (seconds of the
+//                       day, as in the flight profile)
+//   float32 u[nt][nz][ny][nx]  wind towards the east (m/s)
+//   float32 v[nt][nz][ny][nx]  wind towards the north (m/s)
+//
+// The wind between grid points is interpolated linearly in all four
+// dimensions and held constant beyond the edges of the grid.
+class WindField
+{
+public:
+    WindField();
+    ~WindField();
+
+    // Maps the given file. Throws std::runtime_error if the file can't be
+    // read or isn't a valid wind field.
+    void load(const std::string& path);
+
+    // Relates the field to a run: positions are AMG eastings and northings
+    // near origin and times are seconds after startTime (seconds of the day).
+    void prepare(const Point2D& origin, double startTime);
+
+    // The wind towards grid east (u) and grid north (v) at the given
+    // position, altitude and time.
+    void velocity(WindFieldCache& cache, double easting, double northing, double altitude, double time, double& u, double& v) const;
+
+    const std::string& path() const { return path_; }
+    double startTime() const { return startTime_; }
+
+private:
+    std::string            path_;
+    std::shared_ptr<QFile> file_;
+    const float*           u_;
+    const float*           v_;
+    int                    size_[4]; // x, y, z, t
+    long                   stride_[4];
+    long                   step_[4];   // to the next point, or 0 if only one
+    double                 lon0_;
+    double                 dlon_;
+    double                 lat0_;
+    double                 dlat_;
+    double                 alt0_;
+    double                 dalt_;
+    double                 t0_;
+    double                 dt_;
+
+    LocalProjection        projection_;
+    double                 startTime_;
+    double                 sinConvergence_;
+    double                 cosConvergence_;
+};
+
+#endif // WINDFIELD_H